@@ -0,0 +1,533 @@
+// Headless benchmark for the display pipeline. Synthetic beat buffers are fed through the curve building
+// the plugin display uses at several beat lengths, zoom levels and source counts, reporting the CPU time
+// per frame and the vertex bytes each frame uploads. The software rasteriser is timed at full editor size.
+// With --gl the strip meshes are also uploaded and drawn through an OpenGL context, for a software context
+// run with LIBGL_ALWAYS_SOFTWARE=1 on Mesa. With --max-frame-us the process fails when any curve building
+// case averages more than the given number of microseconds, so it can gate display performance.
+// The phase rotator is timed on stereo noise in host sized blocks to give its cost per sample, and the
+// partitioned convolver the same way from 64 to 4096 taps at a few partition sizes. The summation meter is
+// timed per reading and per newly captured beat at a few beat lengths.
+
+#include "JuceHeader.h"
+#include "../../Source/WaveformBuilder.h"
+#include "../../Source/PhaseRotator.h"
+#include "../../Source/PartitionedConvolver.h"
+#include "../../Source/SummationMeter.h"
+#include "../../Source/Renderer/WaveformRasteriser.h"
+#include "../../Source/Renderer/Mesh.h"
+#include "../../Source/Renderer/SharedRenderResources.h"
+#include "../../Source/Renderer/DisplayShaders.h"
+#include <vector>
+
+
+#define BENCHMARK_NUM_QUADS 500
+#define BENCHMARK_NUM_POINTS (BENCHMARK_NUM_QUADS + 1)
+#define BENCHMARK_NUM_STRIP_VERTS (2 * BENCHMARK_NUM_POINTS)
+#define BENCHMARK_NUM_FRAMES 500
+#define BENCHMARK_SAMPLE_RATE 48000
+#define BENCHMARK_WIDTH 1680
+#define BENCHMARK_HEIGHT 1200
+#define BENCHMARK_GL_TIMEOUT_MS 60000
+#define BENCHMARK_ROTATOR_SECONDS 20
+#define BENCHMARK_CONVOLVER_SECONDS 10
+#define BENCHMARK_CONVOLVER_HOST_BLOCK 512
+#define BENCHMARK_SUMMATION_READINGS 1000
+
+
+
+typedef WaveformBuilder::StripVertex WaveVert;
+
+
+struct BenchmarkCase
+{
+	int m_numBeatSamples;
+	float m_viewWidth;
+	int m_numSources;
+};
+
+
+struct BenchmarkResult
+{
+	double m_frameMicroseconds;
+	int64 m_bytesUploaded;
+};
+
+
+static void fillBeatBuffer(std::vector<float>& beatBuffer, int numBeatSamples, int sourceIndex)
+{
+	// a decaying kick with a little noise, each source slightly detuned and offset
+	Random random(sourceIndex + 1);
+	beatBuffer.resize(numBeatSamples);
+	const double frequency = 50.0 + 5.0 * sourceIndex;
+	for(int i = 0; i < numBeatSamples; ++i)
+	{
+		const double time = (double)i / BENCHMARK_SAMPLE_RATE;
+		const double envelope = exp(-time * 8.0);
+		beatBuffer[i] = (float)(0.9 * envelope * sin(2.0 * double_Pi * frequency * time)) + 0.02f * (random.nextFloat() - 0.5f);
+	}
+}
+
+
+static double getMicroseconds(int64 startTicks, int64 endTicks)
+{
+	return 1000000.0 * Time::highResolutionTicksToSeconds(endTicks - startTicks);
+}
+
+
+
+
+class FrameBuilder
+{
+public:
+	FrameBuilder(const BenchmarkCase& benchmarkCase)
+		: m_case(benchmarkCase)
+		, m_frame(0)
+	{
+		m_beatBuffers.resize(m_case.m_numSources);
+		m_sources.resize(m_case.m_numSources);
+		m_curves.resize(m_case.m_numSources + 1);
+		for(int i = 0; i < m_case.m_numSources; ++i)
+		{
+			fillBeatBuffer(m_beatBuffers[i], m_case.m_numBeatSamples, i);
+			m_sources[i].m_pBeatBuffer = m_beatBuffers[i].data();
+			m_sources[i].m_numBeatSamples = m_case.m_numBeatSamples;
+			m_sources[i].m_delaySamples = 37 * i;
+			m_sources[i].m_sampleSign = (i % 2 == 0) ? 1.0f : -1.0f;
+		}
+		for(int i = 0; i < m_curves.size(); ++i)
+			m_curves[i].assign(BENCHMARK_NUM_POINTS, 0.0f);
+	}
+
+	int getNumLayers() const
+	{
+		// the combined layer is only drawn when there is more than one source
+		return m_case.m_numSources > 1 ? m_case.m_numSources + 1 : m_case.m_numSources;
+	}
+
+	const std::vector<float>& getCurve(int layerIndex) const
+	{
+		return m_curves[layerIndex];
+	}
+
+	void buildFrame()
+	{
+		// drift the view and delays a little every frame as dragging would
+		const float viewStart = (1.0f - m_case.m_viewWidth) * 0.5f * (1.0f + sinf(0.01f * m_frame));
+		for(int i = 0; i < m_case.m_numSources; ++i)
+			m_sources[i].m_delaySamples = 37 * i + (m_frame % 64);
+
+		for(int i = 0; i < m_case.m_numSources; ++i)
+			WaveformBuilder::buildCurve(m_sources[i], viewStart, viewStart + m_case.m_viewWidth, m_curves[i].data(), BENCHMARK_NUM_POINTS);
+		if(m_case.m_numSources > 1)
+		{
+			const WaveformBuilder::Source summedSource = WaveformBuilder::sumSources(m_sources.data(), m_case.m_numSources, m_summedSamples);
+			WaveformBuilder::buildCurve(summedSource, viewStart, viewStart + m_case.m_viewWidth, m_curves[m_case.m_numSources].data(), BENCHMARK_NUM_POINTS);
+		}
+
+		++m_frame;
+	}
+
+private:
+	BenchmarkCase m_case;
+	std::vector<std::vector<float>> m_beatBuffers;
+	std::vector<WaveformBuilder::Source> m_sources;
+	std::vector<std::vector<float>> m_curves;
+	std::vector<float> m_summedSamples;
+	int m_frame;
+};
+
+
+
+
+static BenchmarkResult runMeshBenchmark(const BenchmarkCase& benchmarkCase)
+{
+	FrameBuilder frameBuilder(benchmarkCase);
+	std::vector<WaveVert> vertices(BENCHMARK_NUM_STRIP_VERTS);
+	const float edgeOffset = 2.0f / BENCHMARK_HEIGHT;
+
+	BenchmarkResult result;
+	result.m_bytesUploaded = (int64)frameBuilder.getNumLayers() * BENCHMARK_NUM_STRIP_VERTS * sizeof(WaveVert);
+
+	const int64 startTicks = Time::getHighResolutionTicks();
+	for(int frame = 0; frame < BENCHMARK_NUM_FRAMES; ++frame)
+	{
+		frameBuilder.buildFrame();
+		for(int layer = 0; layer < frameBuilder.getNumLayers(); ++layer)
+			WaveformBuilder::buildStripVertices(frameBuilder.getCurve(layer).data(), BENCHMARK_NUM_POINTS, edgeOffset, layer, vertices.data());
+	}
+	result.m_frameMicroseconds = getMicroseconds(startTicks, Time::getHighResolutionTicks()) / BENCHMARK_NUM_FRAMES;
+
+	return result;
+}
+
+
+static double runRasteriserBenchmark(const BenchmarkCase& benchmarkCase, bool moveEveryFrame)
+{
+	FrameBuilder frameBuilder(benchmarkCase);
+	WaveformRasteriser rasteriser;
+
+	const float curveSpacing = 2.0f / BENCHMARK_NUM_QUADS;
+	const Colour layerColour = Colour::fromFloatRGBA(0.3f, 0.3f, 0.3f, 1.0f);
+	frameBuilder.buildFrame();
+
+	const int64 startTicks = Time::getHighResolutionTicks();
+	for(int frame = 0; frame < BENCHMARK_NUM_FRAMES; ++frame)
+	{
+		if(moveEveryFrame)
+			frameBuilder.buildFrame();
+
+		rasteriser.beginFrame(BENCHMARK_WIDTH, BENCHMARK_HEIGHT, Colour::greyLevel(0.1f));
+		for(int bar = 0; bar < 3; ++bar)
+			rasteriser.addTimeBar(0.25f * (bar + 1), 1.0f / BENCHMARK_WIDTH, Colour::greyLevel(0.2f));
+		for(int layer = 0; layer < frameBuilder.getNumLayers(); ++layer)
+			rasteriser.addWaveform(frameBuilder.getCurve(layer).data(), BENCHMARK_NUM_POINTS, -1.0f - curveSpacing, curveSpacing, layerColour);
+		rasteriser.endFrame();
+	}
+	return getMicroseconds(startTicks, Time::getHighResolutionTicks()) / BENCHMARK_NUM_FRAMES;
+}
+
+
+
+
+static double runPhaseRotatorBenchmark(int blockSize, float angleDegrees)
+{
+	PhaseRotator rotator;
+	rotator.prepareToPlay(BENCHMARK_SAMPLE_RATE);
+
+	Random random(1);
+	AudioSampleBuffer buffer(2, blockSize);
+	for(int channel = 0; channel < 2; ++channel)
+		for(int i = 0; i < blockSize; ++i)
+			buffer.setSample(channel, i, random.nextFloat() - 0.5f);
+
+	// the rotator works in place, so the same block is fed back through it
+	const int numBlocks = BENCHMARK_ROTATOR_SECONDS * BENCHMARK_SAMPLE_RATE / blockSize;
+	const int64 startTicks = Time::getHighResolutionTicks();
+	for(int block = 0; block < numBlocks; ++block)
+		rotator.process(buffer.getWritePointer(0), buffer.getWritePointer(1), blockSize, angleDegrees);
+
+	return 1000.0 * getMicroseconds(startTicks, Time::getHighResolutionTicks()) / ((double)numBlocks * blockSize);
+}
+
+
+static double runConvolverBenchmark(int numTaps, int partitionSize)
+{
+	PartitionedConvolver convolver;
+	convolver.prepare(numTaps, partitionSize, BENCHMARK_SAMPLE_RATE);
+
+	// a dense filter, the cost doesn't depend on the taps but it keeps the output from settling to zero
+	Random random(1);
+	std::vector<float> impulse(numTaps);
+	for(int i = 0; i < numTaps; ++i)
+		impulse[i] = (random.nextFloat() - 0.5f) / numTaps;
+
+	std::vector<FFT::Complex> spectra;
+	convolver.buildFilter(impulse.data(), numTaps, spectra);
+	convolver.submitFilter(spectra);
+
+	AudioSampleBuffer buffer(2, BENCHMARK_CONVOLVER_HOST_BLOCK);
+	for(int channel = 0; channel < 2; ++channel)
+		for(int i = 0; i < BENCHMARK_CONVOLVER_HOST_BLOCK; ++i)
+			buffer.setSample(channel, i, random.nextFloat() - 0.5f);
+
+	// the first second crossfades to the filter, it's left out of the timing
+	const int numWarmupBlocks = BENCHMARK_SAMPLE_RATE / BENCHMARK_CONVOLVER_HOST_BLOCK;
+	for(int block = 0; block < numWarmupBlocks; ++block)
+		convolver.process(buffer.getWritePointer(0), buffer.getWritePointer(1), BENCHMARK_CONVOLVER_HOST_BLOCK);
+
+	const int numBlocks = BENCHMARK_CONVOLVER_SECONDS * BENCHMARK_SAMPLE_RATE / BENCHMARK_CONVOLVER_HOST_BLOCK;
+	const int64 startTicks = Time::getHighResolutionTicks();
+	for(int block = 0; block < numBlocks; ++block)
+		convolver.process(buffer.getWritePointer(0), buffer.getWritePointer(1), BENCHMARK_CONVOLVER_HOST_BLOCK);
+
+	return 1000.0 * getMicroseconds(startTicks, Time::getHighResolutionTicks()) / ((double)numBlocks * BENCHMARK_CONVOLVER_HOST_BLOCK);
+}
+
+
+static void runSummationMeterBenchmark(int numBeatSamples, double& readingMicroseconds, double& beatMicroseconds)
+{
+	std::vector<float> localBeat, remoteBeat;
+	fillBeatBuffer(localBeat, numBeatSamples, 0);
+	fillBeatBuffer(remoteBeat, numBeatSamples, 1);
+
+	SummationMeter meter;
+	meter.prepare(BENCHMARK_SAMPLE_RATE);
+
+	// every beat number is new, so each update filters the beat again
+	int64 startTicks = Time::getHighResolutionTicks();
+	for(int reading = 0; reading < BENCHMARK_SUMMATION_READINGS; ++reading)
+		meter.updateBeat(0, 0, reading, localBeat.data(), numBeatSamples);
+	beatMicroseconds = getMicroseconds(startTicks, Time::getHighResolutionTicks()) / BENCHMARK_SUMMATION_READINGS;
+	meter.updateBeat(1, 1, 0, remoteBeat.data(), numBeatSamples);
+
+	// the delay moves every reading so the runs split the beats somewhere different each time
+	const SummationMeter::Placement local = { 0, 0, 1.0f };
+	SummationMeter::Placement remote = { 1, 0, 1.0f };
+	float summationDecibels = 0.0f;
+	startTicks = Time::getHighResolutionTicks();
+	for(int reading = 0; reading < BENCHMARK_SUMMATION_READINGS; ++reading)
+	{
+		remote.m_delaySamples = (reading * 7) % numBeatSamples;
+		summationDecibels += meter.measure(local, remote).m_summationDecibels;
+	}
+	readingMicroseconds = getMicroseconds(startTicks, Time::getHighResolutionTicks()) / BENCHMARK_SUMMATION_READINGS;
+
+	// used so the readings can't be optimised away
+	if(summationDecibels == 1.0e30f)
+		printf("%f\n", summationDecibels);
+}
+
+
+
+
+class GLBenchmarkComponent : public Component, private OpenGLRenderer
+{
+public:
+	GLBenchmarkComponent(const Array<BenchmarkCase>& cases)
+		: m_cases(cases)
+		, m_pShaderProgram(nullptr)
+	{
+		setOpaque(true);
+		m_openGLContext.setComponentPaintingEnabled(false);
+		m_openGLContext.setContinuousRepainting(false);
+		m_openGLContext.setRenderer(this);
+	}
+
+	~GLBenchmarkComponent()
+	{
+		m_openGLContext.detach();
+	}
+
+	bool run(Array<double>& frameMicroseconds)
+	{
+		// rendering only starts once the context is attached to a visible window
+		setBounds(0, 0, BENCHMARK_WIDTH, BENCHMARK_HEIGHT);
+		addToDesktop(ComponentPeer::windowIsTemporary);
+		setVisible(true);
+		m_openGLContext.attachTo(*this);
+
+		// give up if no context turns up, e.g. when there is no display
+		const uint32 startTime = Time::getMillisecondCounter();
+		while(!m_finished.wait(0) && Time::getMillisecondCounter() - startTime < BENCHMARK_GL_TIMEOUT_MS)
+			MessageManager::getInstance()->runDispatchLoopUntil(10);
+		m_openGLContext.detach();
+
+		frameMicroseconds = m_frameMicroseconds;
+		return m_frameMicroseconds.size() == m_cases.size();
+	}
+
+private:
+	void newOpenGLContextCreated() override
+	{
+		SharedRenderResources::addContext(m_openGLContext.getRawContext(), -1);
+
+		// the display's own wave shader, so the timings include picking each vertex's colour by layer
+		m_pShaderProgram = new ShaderProgram();
+		m_pShaderProgram->load(gQuadMeshVertexShaderSource, gQuadMeshFragmentShaderSource);
+		m_colourUniforms.resize(DISPLAYSHADERS_NUM_COLOURS);
+		for(int i = 0; i < DISPLAYSHADERS_NUM_COLOURS; ++i)
+			m_colourUniforms[i] = m_pShaderProgram->getUniformIndex("layerColours[" + String(i) + "]");
+	}
+
+	void renderOpenGL() override
+	{
+		if(m_finished.wait(0))
+			return;
+
+		std::vector<Attribute> attributes;
+		attributes.resize(3);
+		attributes[0].m_name = "v_position";
+		attributes[0].m_numFloats = 2;
+		attributes[0].m_floatOffset = 0;
+		attributes[1].m_name = "v_edge";
+		attributes[1].m_numFloats = 1;
+		attributes[1].m_floatOffset = 2;
+		attributes[2].m_name = "v_layer";
+		attributes[2].m_numFloats = 1;
+		attributes[2].m_floatOffset = 3;
+
+		const double renderingScale = m_openGLContext.getRenderingScale();
+		const float edgeOffset = (float)(2.0 / (renderingScale * getHeight()));
+		glViewport(0, 0, roundToInt(renderingScale * getWidth()), roundToInt(renderingScale * getHeight()));
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+
+		// each frame is finished before the next so the time covers curve building, upload and drawing
+		for(int caseIndex = 0; caseIndex < m_cases.size() && m_pShaderProgram->isLoaded(); ++caseIndex)
+		{
+			// every layer goes in one strip drawn at once, joined by two repeated vertices as the display does
+			FrameBuilder frameBuilder(m_cases[caseIndex]);
+			const GLuint numStripVertices = frameBuilder.getNumLayers() * (BENCHMARK_NUM_STRIP_VERTS + 2) - 2;
+			DynamicStripMesh<WaveVert> mesh(numStripVertices, attributes);
+
+			std::vector<WaveVert> vertices(BENCHMARK_NUM_STRIP_VERTS);
+			const int64 startTicks = Time::getHighResolutionTicks();
+			for(int frame = 0; frame < BENCHMARK_NUM_FRAMES; ++frame)
+			{
+				OpenGLHelpers::clear(Colour::greyLevel(0.1f));
+				m_pShaderProgram->useProgram();
+				for(int i = 0; i < m_colourUniforms.size(); ++i)
+					m_openGLContext.extensions.glUniform4f(m_colourUniforms[i], 0.3f, 0.3f, 0.3f, 1.0f);
+
+				frameBuilder.buildFrame();
+				GLuint numVertices = 0;
+				WaveVert prevLastVertex;
+				for(int layer = 0; layer < frameBuilder.getNumLayers(); ++layer)
+				{
+					WaveformBuilder::buildStripVertices(frameBuilder.getCurve(layer).data(), BENCHMARK_NUM_POINTS, edgeOffset, layer, vertices.data());
+					if(layer > 0)
+					{
+						mesh.setVertex(numVertices, prevLastVertex);
+						mesh.setVertex(numVertices + 1, vertices[0]);
+						numVertices += 2;
+					}
+					mesh.setVertices(numVertices, vertices.data(), BENCHMARK_NUM_STRIP_VERTS);
+					numVertices += BENCHMARK_NUM_STRIP_VERTS;
+					prevLastVertex = vertices.back();
+				}
+				mesh.draw(m_pShaderProgram, 0, numVertices - 1);
+				glFinish();
+			}
+			m_frameMicroseconds.add(getMicroseconds(startTicks, Time::getHighResolutionTicks()) / BENCHMARK_NUM_FRAMES);
+		}
+
+		m_finished.signal();
+	}
+
+	void openGLContextClosing() override
+	{
+		m_pShaderProgram = nullptr;
+		SharedRenderResources::removeContext(m_openGLContext.getRawContext());
+	}
+
+	void paint(Graphics& g) override
+	{
+	}
+
+	OpenGLContext m_openGLContext;
+	Array<BenchmarkCase> m_cases;
+	ScopedPointer<ShaderProgram> m_pShaderProgram;
+	std::vector<int> m_colourUniforms;
+	Array<double> m_frameMicroseconds;
+	WaitableEvent m_finished;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GLBenchmarkComponent)
+};
+
+
+
+
+int main(int argc, char* argv[])
+{
+	StringArray args(argv + 1, argc - 1);
+	const bool runGL = args.contains("--gl");
+	const int maxFrameIndex = args.indexOf("--max-frame-us");
+	const double maxFrameMicroseconds = (maxFrameIndex >= 0) ? args[maxFrameIndex + 1].getDoubleValue() : 0.0;
+
+	const int beatLengths[] = { BENCHMARK_SAMPLE_RATE / 4, BENCHMARK_SAMPLE_RATE / 2, BENCHMARK_SAMPLE_RATE, 2 * BENCHMARK_SAMPLE_RATE };
+	const float viewWidths[] = { 1.0f, 0.25f, 0.01f };
+	const int sourceCounts[] = { 1, 2, 4, 8 };
+
+	Array<BenchmarkCase> cases;
+	for(int beatLength : beatLengths)
+	{
+		for(float viewWidth : viewWidths)
+		{
+			for(int numSources : sourceCounts)
+			{
+				BenchmarkCase benchmarkCase;
+				benchmarkCase.m_numBeatSamples = beatLength;
+				benchmarkCase.m_viewWidth = viewWidth;
+				benchmarkCase.m_numSources = numSources;
+				cases.add(benchmarkCase);
+			}
+		}
+	}
+
+	// curve building and vertex writing
+	bool passed = true;
+	printf("curve building, %d points per layer, %d frames per case\n", BENCHMARK_NUM_POINTS, BENCHMARK_NUM_FRAMES);
+	printf("%12s %10s %8s %14s %14s\n", "beat samples", "view", "sources", "us / frame", "bytes / frame");
+	for(int i = 0; i < cases.size(); ++i)
+	{
+		const BenchmarkCase& benchmarkCase = cases.getReference(i);
+		const BenchmarkResult result = runMeshBenchmark(benchmarkCase);
+		printf("%12d %10.2f %8d %14.2f %14lld\n", benchmarkCase.m_numBeatSamples, benchmarkCase.m_viewWidth, benchmarkCase.m_numSources,
+			result.m_frameMicroseconds, (long long)result.m_bytesUploaded);
+
+		if(maxFrameMicroseconds > 0.0 && result.m_frameMicroseconds > maxFrameMicroseconds)
+			passed = false;
+	}
+
+	// software compositing at full editor size
+	printf("\nsoftware rasteriser, %dx%d\n", BENCHMARK_WIDTH, BENCHMARK_HEIGHT);
+	printf("%8s %16s %16s\n", "sources", "steady us", "moving us");
+	for(int numSources : sourceCounts)
+	{
+		BenchmarkCase benchmarkCase;
+		benchmarkCase.m_numBeatSamples = BENCHMARK_SAMPLE_RATE / 2;
+		benchmarkCase.m_viewWidth = 1.0f;
+		benchmarkCase.m_numSources = numSources;
+		printf("%8d %16.2f %16.2f\n", numSources, runRasteriserBenchmark(benchmarkCase, false), runRasteriserBenchmark(benchmarkCase, true));
+	}
+
+	// phase rotation per stereo sample, 0 degrees plays the delayed input but still runs the cascade
+	PhaseRotator preparedRotator;
+	preparedRotator.prepareToPlay(BENCHMARK_SAMPLE_RATE);
+	printf("\nphase rotator, %d seconds of stereo at %d Hz, %d samples latency\n", BENCHMARK_ROTATOR_SECONDS, BENCHMARK_SAMPLE_RATE, preparedRotator.getLatencySamples());
+	printf("%8s %16s %16s\n", "block", "ns at 0 deg", "ns at 45 deg");
+	const int blockSizes[] = { 64, 512, 2048 };
+	for(int blockSize : blockSizes)
+		printf("%8d %16.2f %16.2f\n", blockSize, runPhaseRotatorBenchmark(blockSize, 0.0f), runPhaseRotatorBenchmark(blockSize, 45.0f));
+
+	// convolution per stereo sample, latency is the partition plus half the taps
+	printf("\npartitioned convolver, %d seconds of stereo at %d Hz in %d sample blocks, ns per sample by partition\n",
+		BENCHMARK_CONVOLVER_SECONDS, BENCHMARK_SAMPLE_RATE, BENCHMARK_CONVOLVER_HOST_BLOCK);
+	const int partitionSizes[] = { 64, 256, 1024 };
+	printf("%8s", "taps");
+	for(int partitionSize : partitionSizes)
+		printf(" %10d", partitionSize);
+	printf("\n");
+	for(int numTaps = 64; numTaps <= 4096; numTaps *= 2)
+	{
+		printf("%8d", numTaps);
+		for(int partitionSize : partitionSizes)
+			printf(" %10.2f", runConvolverBenchmark(numTaps, partitionSize));
+		printf("\n");
+	}
+
+	// a reading is one dot product over the beat, filtering only happens when a beat has been captured again
+	printf("\nsummation meter, %d readings at %d Hz\n", BENCHMARK_SUMMATION_READINGS, BENCHMARK_SAMPLE_RATE);
+	printf("%8s %16s %16s\n", "samples", "us per reading", "us per new beat");
+	const int summationBeatLengths[] = { BENCHMARK_SAMPLE_RATE / 4, BENCHMARK_SAMPLE_RATE / 2, BENCHMARK_SAMPLE_RATE * 2 };
+	for(int numBeatSamples : summationBeatLengths)
+	{
+		double readingMicroseconds = 0.0, beatMicroseconds = 0.0;
+		runSummationMeterBenchmark(numBeatSamples, readingMicroseconds, beatMicroseconds);
+		printf("%8d %16.2f %16.2f\n", numBeatSamples, readingMicroseconds, beatMicroseconds);
+	}
+
+	// upload and draw through a real context
+	if(runGL)
+	{
+		ScopedJuceInitialiser_GUI juceInitialiser;
+		Array<double> frameMicroseconds;
+		ScopedPointer<GLBenchmarkComponent> pGLBenchmark = new GLBenchmarkComponent(cases);
+		if(pGLBenchmark->run(frameMicroseconds))
+		{
+			printf("\nopengl, curve building, upload and draw with glFinish per frame\n");
+			printf("%12s %10s %8s %14s\n", "beat samples", "view", "sources", "us / frame");
+			for(int i = 0; i < cases.size(); ++i)
+				printf("%12d %10.2f %8d %14.2f\n", cases[i].m_numBeatSamples, cases[i].m_viewWidth, cases[i].m_numSources, frameMicroseconds[i]);
+		}
+		else
+		{
+			printf("\nopengl benchmark failed, no usable context\n");
+		}
+		pGLBenchmark = nullptr;
+	}
+
+	if(!passed)
+		printf("\nfailed, a case exceeded %.2f us per frame\n", maxFrameMicroseconds);
+	return passed ? 0 : 1;
+}
\ No newline at end of file
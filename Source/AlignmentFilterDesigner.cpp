@@ -0,0 +1,168 @@
+#include "AlignmentFilterDesigner.h"
+#include "Math.h"
+#include <complex>
+
+
+#define ALIGNMENTFILTERDESIGNER_STOP_TIMEOUT_MS 2000
+#define ALIGNMENTFILTERDESIGNER_RESOLUTION_HZ 24.0
+#define ALIGNMENTFILTERDESIGNER_CUTOFF_HZ 150.0
+
+
+
+AlignmentFilterDesigner::AlignmentFilterDesigner(PartitionedConvolver& convolver)
+	: Thread("AlignmentFilterDesigner")
+	, m_convolver(convolver)
+	, m_hasPendingRequest(false)
+{
+	startThread();
+}
+
+
+AlignmentFilterDesigner::~AlignmentFilterDesigner()
+{
+	// the worker sleeps until it has a request, so wake it to see the exit flag
+	signalThreadShouldExit();
+	notify();
+	stopThread(ALIGNMENTFILTERDESIGNER_STOP_TIMEOUT_MS);
+}
+
+
+void AlignmentFilterDesigner::submitRequest(Request& request)
+{
+	{
+		const ScopedLock lock(m_requestLock);
+		std::swap(m_pendingRequest, request);
+		m_hasPendingRequest = true;
+	}
+
+	notify();
+}
+
+
+int AlignmentFilterDesigner::getNumTaps(double sampleRate)
+{
+	int numTaps = 2;
+	while(numTaps < sampleRate / ALIGNMENTFILTERDESIGNER_RESOLUTION_HZ)
+		numTaps *= 2;
+	return numTaps;
+}
+
+
+void AlignmentFilterDesigner::designImpulse(const Request& request, int numTaps, std::vector<float>& impulse)
+{
+	impulse.assign(numTaps, 0.0f);
+	impulse[numTaps / 2] = 1.0f;
+
+	const Beat& localBeat = request.m_localBeat;
+	const Beat& remoteBeat = request.m_remoteBeat;
+	const int numSamples = (int)localBeat.m_samples.size();
+	if(numSamples <= 0 || remoteBeat.m_samples.empty() || request.m_sampleRate <= 0.0)
+		return;
+
+	// both beats are laid out the way their delay lines play them over the local beat, under one window
+	int order = 1;
+	while((1 << order) < jmax(numSamples, numTaps))
+		++order;
+
+	const int analysisSize = 1 << order;
+	const FFT::Complex zero = { 0.0f, 0.0f };
+	std::vector<FFT::Complex> localSamples(analysisSize, zero);
+	std::vector<FFT::Complex> remoteSamples(analysisSize, zero);
+	for(int i = 0; i < numSamples; ++i)
+	{
+		const float window = 0.5f - 0.5f * cosf(2.0f * float_Pi * (float)i / (float)numSamples);
+		const int localIndex = Math::positiveModulo(i - localBeat.m_delaySamples, numSamples);
+		const int remoteIndex = Math::positiveModulo(i - remoteBeat.m_delaySamples, (int)remoteBeat.m_samples.size());
+		localSamples[i].r = window * localBeat.m_sampleSign * localBeat.m_samples[localIndex];
+		remoteSamples[i].r = window * remoteBeat.m_sampleSign * remoteBeat.m_samples[remoteIndex];
+	}
+
+	FFT forwardFFT(order, false);
+	std::vector<FFT::Complex> localSpectrum(analysisSize);
+	std::vector<FFT::Complex> remoteSpectrum(analysisSize);
+	forwardFFT.perform(localSamples.data(), localSpectrum.data());
+	forwardFFT.perform(remoteSamples.data(), remoteSpectrum.data());
+
+	// each filter bin takes the phase of the cross-spectrum summed over the analysis bins it covers, unwrapped
+	// upwards from the first bin and faded out above the cutoff. The rest is the centre tap's linear phase.
+	int filterOrder = 1;
+	while((1 << filterOrder) < numTaps)
+		++filterOrder;
+
+	const double binsPerFilterBin = (double)analysisSize / (double)numTaps;
+	const double filterBinHz = request.m_sampleRate / (double)numTaps;
+	std::vector<FFT::Complex> response(numTaps, zero);
+	response[0].r = 1.0f;
+	double unwrappedPhase = 0.0;
+	for(int bin = 1; bin <= numTaps / 2; ++bin)
+	{
+		const double frequency = bin * filterBinHz;
+		double weight = 0.0;
+		if(frequency <= ALIGNMENTFILTERDESIGNER_CUTOFF_HZ)
+			weight = 1.0;
+		else if(frequency < 2.0 * ALIGNMENTFILTERDESIGNER_CUTOFF_HZ)
+			weight = 0.5 + 0.5 * cos(double_Pi * (frequency - ALIGNMENTFILTERDESIGNER_CUTOFF_HZ) / ALIGNMENTFILTERDESIGNER_CUTOFF_HZ);
+
+		if(weight > 0.0)
+		{
+			const int firstBin = jmax(1, roundDoubleToInt((bin - 0.5) * binsPerFilterBin));
+			const int lastBin = jmax(firstBin, jmin(analysisSize / 2, roundDoubleToInt((bin + 0.5) * binsPerFilterBin) - 1));
+			std::complex<double> crossSpectrum(0.0, 0.0);
+			for(int b = firstBin; b <= lastBin; ++b)
+			{
+				const std::complex<double> local(localSpectrum[b].r, localSpectrum[b].i);
+				const std::complex<double> remote(remoteSpectrum[b].r, remoteSpectrum[b].i);
+				crossSpectrum += remote * std::conj(local);
+			}
+
+			const double phase = std::arg(crossSpectrum);
+			unwrappedPhase += remainder(phase - unwrappedPhase, 2.0 * double_Pi);
+		}
+
+		const std::complex<double> value = std::polar(1.0, weight * unwrappedPhase - double_Pi * bin);
+		response[bin].r = (float)value.real();
+		response[bin].i = (bin == numTaps / 2) ? 0.0f : (float)value.imag();
+		if(bin < numTaps / 2)
+		{
+			response[numTaps - bin].r = response[bin].r;
+			response[numTaps - bin].i = -response[bin].i;
+		}
+	}
+
+	// a Hann window over the taps keeps the truncated tails from rippling, it's 1 at the centre tap
+	FFT inverseFFT(filterOrder, true);
+	std::vector<FFT::Complex> filter(numTaps);
+	inverseFFT.perform(response.data(), filter.data());
+	for(int i = 0; i < numTaps; ++i)
+	{
+		const float window = 0.5f - 0.5f * cosf(2.0f * float_Pi * (float)i / (float)numTaps);
+		impulse[i] = window * filter[i].r / (float)numTaps;
+	}
+}
+
+
+void AlignmentFilterDesigner::run()
+{
+	while(!threadShouldExit())
+	{
+		wait(-1);
+
+		{
+			const ScopedLock lock(m_requestLock);
+			if(!m_hasPendingRequest)
+				continue;
+
+			std::swap(m_pendingRequest, m_designRequest);
+			m_hasPendingRequest = false;
+		}
+
+		// the tap count is read again here since the convolver may have been prepared for a new sample rate
+		const int numTaps = m_convolver.getNumTaps();
+		if(numTaps <= 0)
+			continue;
+
+		designImpulse(m_designRequest, numTaps, m_impulse);
+		m_convolver.buildFilter(m_impulse.data(), (int)m_impulse.size(), m_spectra);
+		m_convolver.submitFilter(m_spectra);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+
+#include "JuceHeader.h"
+#include "PartitionedConvolver.h"
+#include <vector>
+
+
+// Designs the FIR a PartitionedConvolver uses to line the local instance's low end up with a remote one. The
+// phase of their cross-spectrum is averaged into the filter's bins and applied below the cutoff, fading to a
+// plain delay to the centre tap an octave above it, so kicks and bass are pulled into phase while everything
+// else passes through linear phase and untouched. Designs run on a worker thread and are handed straight to the
+// convolver, requests made while it's busy replace each other.
+class AlignmentFilterDesigner : private Thread
+{
+public:
+	struct Beat
+	{
+		std::vector<float> m_samples;
+		int m_delaySamples;
+		float m_sampleSign;
+	};
+
+	struct Request
+	{
+		Beat m_localBeat;
+		Beat m_remoteBeat;
+		double m_sampleRate;
+	};
+
+	AlignmentFilterDesigner(PartitionedConvolver& convolver);
+	~AlignmentFilterDesigner();
+
+	// the request is swapped with a spent one, a remote beat with no samples resets the filter to the delay
+	void submitRequest(Request& request);
+
+	// a power of two long enough to resolve the cutoff band into a few bins
+	static int getNumTaps(double sampleRate);
+	static void designImpulse(const Request& request, int numTaps, std::vector<float>& impulse);
+
+private:
+	void run() override;
+
+	PartitionedConvolver& m_convolver;
+
+	CriticalSection m_requestLock;
+	Request m_pendingRequest;
+	Request m_designRequest;
+	bool m_hasPendingRequest;
+
+	std::vector<float> m_impulse;
+	std::vector<FFT::Complex> m_spectra;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AlignmentFilterDesigner)
+};
\ No newline at end of file
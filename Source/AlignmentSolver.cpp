@@ -0,0 +1,375 @@
+#include "AlignmentSolver.h"
+#include "Math.h"
+
+
+#define ALIGNMENTSOLVER_LOW_BAND_HZ 150.0
+#define ALIGNMENTSOLVER_MAX_DESCENT_PASSES 32
+#define ALIGNMENTSOLVER_MIN_IMPROVEMENT 1.0e-5f
+#define ALIGNMENTSOLVER_POLL_MS 10
+#define ALIGNMENTSOLVER_STOP_TIMEOUT_MS 2000
+
+
+
+class AlignmentSolver::SpectrumJob : public ThreadPoolJob
+{
+public:
+	SpectrumJob(AlignmentSolver& solver, int instanceIndex)
+		: ThreadPoolJob("AlignmentSpectrum")
+		, m_solver(solver)
+		, m_instanceIndex(instanceIndex)
+	{
+	}
+
+	JobStatus runJob() override
+	{
+		m_solver.buildSpectra(m_instanceIndex);
+		return jobHasFinished;
+	}
+
+private:
+	AlignmentSolver& m_solver;
+	const int m_instanceIndex;
+};
+
+
+
+class AlignmentSolver::CorrelationJob : public ThreadPoolJob
+{
+public:
+	CorrelationJob(AlignmentSolver& solver, int firstIndex, int secondIndex)
+		: ThreadPoolJob("AlignmentCorrelation")
+		, m_solver(solver)
+		, m_firstIndex(firstIndex)
+		, m_secondIndex(secondIndex)
+	{
+	}
+
+	JobStatus runJob() override
+	{
+		m_solver.buildCorrelation(m_firstIndex, m_secondIndex);
+		return jobHasFinished;
+	}
+
+private:
+	AlignmentSolver& m_solver;
+	const int m_firstIndex;
+	const int m_secondIndex;
+};
+
+
+
+class AlignmentSolver::DescentJob : public ThreadPoolJob
+{
+public:
+	DescentJob(AlignmentSolver& solver, int startIndex)
+		: ThreadPoolJob("AlignmentDescent")
+		, m_solver(solver)
+		, m_startIndex(startIndex)
+	{
+	}
+
+	JobStatus runJob() override
+	{
+		m_solver.descend(m_startIndex);
+		return jobHasFinished;
+	}
+
+private:
+	AlignmentSolver& m_solver;
+	const int m_startIndex;
+};
+
+
+
+
+
+AlignmentSolver::AlignmentSolver(int numThreads)
+	: m_threadPool(jmax(numThreads, 1))
+	, m_numJobs(0)
+	, m_numJobsFinished(0)
+	, m_pInstances(nullptr)
+	, m_numInstances(0)
+	, m_numWindowSamples(0)
+	, m_maxDelay(0)
+	, m_maxLag(0)
+	, m_numLowBandBins(0)
+{
+}
+
+
+AlignmentSolver::~AlignmentSolver()
+{
+	m_threadPool.removeAllJobs(true, ALIGNMENTSOLVER_STOP_TIMEOUT_MS);
+}
+
+
+bool AlignmentSolver::solve(std::vector<Instance>& instances, double sampleRate, int maxDelaySamples, Listener* pListener)
+{
+	const int numInstances = (int)instances.size();
+	if(numInstances < 2 || sampleRate <= 0.0 || maxDelaySamples < 0)
+		return false;
+
+	for(int i = 0; i < numInstances; ++i)
+		if(instances[i].m_samples.empty())
+			return false;
+
+	// the window is one beat of the anchor, differences between two delays can be up to twice the range
+	m_pInstances = &instances;
+	m_numInstances = numInstances;
+	m_numWindowSamples = (int)instances[0].m_samples.size();
+	m_maxDelay = maxDelaySamples;
+	m_maxLag = 2 * maxDelaySamples;
+
+	int fftOrder = 1;
+	while((1 << fftOrder) < m_numWindowSamples + 2 * m_maxLag)
+		++fftOrder;
+
+	m_pForwardFFT = new FFT(fftOrder, false);
+	m_pInverseFFT = new FFT(fftOrder, true);
+	m_numLowBandBins = jmax(1, (int)(ALIGNMENTSOLVER_LOW_BAND_HZ * m_pForwardFFT->getSize() / sampleRate));
+
+	m_windowSpectra.resize(numInstances);
+	m_extendedSpectra.resize(numInstances);
+	m_correlations.resize(numInstances * numInstances);
+	m_settings.resize(numInstances + 1);
+
+	// each stage reads what the one before it wrote, so they run one after another with their jobs in parallel
+	const int numPairs = numInstances * (numInstances - 1) / 2;
+	m_numJobs = numInstances + numPairs + (int)m_settings.size();
+	m_numJobsFinished = 0;
+
+	for(int i = 0; i < numInstances; ++i)
+		m_threadPool.addJob(new SpectrumJob(*this, i), true);
+	bool isFinished = waitForJobs(numInstances, pListener);
+
+	if(isFinished)
+	{
+		for(int i = 0; i < numInstances; ++i)
+			for(int j = i + 1; j < numInstances; ++j)
+				m_threadPool.addJob(new CorrelationJob(*this, i, j), true);
+		isFinished = waitForJobs(numPairs, pListener);
+	}
+
+	if(isFinished)
+	{
+		for(int i = 0; i < m_settings.size(); ++i)
+			m_threadPool.addJob(new DescentJob(*this, i), true);
+		isFinished = waitForJobs((int)m_settings.size(), pListener);
+	}
+
+	m_pInstances = nullptr;
+	if(!isFinished)
+		return false;
+
+	int bestSettingIndex = 0;
+	for(int i = 1; i < m_settings.size(); ++i)
+		if(m_settings[i].m_score > m_settings[bestSettingIndex].m_score)
+			bestSettingIndex = i;
+
+	const Setting& bestSetting = m_settings[bestSettingIndex];
+	for(int i = 1; i < numInstances; ++i)
+	{
+		instances[i].m_delaySamples = bestSetting.m_delays[i];
+		instances[i].m_sampleSign = bestSetting.m_signs[i];
+	}
+
+	return true;
+}
+
+
+bool AlignmentSolver::waitForJobs(int numJobs, Listener* pListener)
+{
+	while(m_threadPool.getNumJobs() > 0)
+	{
+		if(pListener && pListener->alignmentShouldStop())
+		{
+			m_threadPool.removeAllJobs(true, ALIGNMENTSOLVER_STOP_TIMEOUT_MS);
+			return false;
+		}
+
+		if(pListener)
+			pListener->alignmentProgressChanged((float)(m_numJobsFinished + numJobs - m_threadPool.getNumJobs()) / m_numJobs);
+
+		Thread::sleep(ALIGNMENTSOLVER_POLL_MS);
+	}
+
+	m_numJobsFinished += numJobs;
+	if(pListener)
+		pListener->alignmentProgressChanged((float)m_numJobsFinished / m_numJobs);
+
+	return true;
+}
+
+
+void AlignmentSolver::buildSpectra(int instanceIndex)
+{
+	const std::vector<float>& samples = (*m_pInstances)[instanceIndex].m_samples;
+	const int numSamples = (int)samples.size();
+	const int fftSize = m_pForwardFFT->getSize();
+	std::vector<FFT::Complex> input(fftSize);
+
+	// one window of the beat padded with silence, every beat wraps at its own length
+	for(int n = 0; n < fftSize; ++n)
+	{
+		input[n].r = (n < m_numWindowSamples) ? samples[n % numSamples] : 0.0f;
+		input[n].i = 0.0f;
+	}
+	m_windowSpectra[instanceIndex].resize(fftSize);
+	m_pForwardFFT->perform(input.data(), m_windowSpectra[instanceIndex].data());
+
+	// the same beat starting maxLag early and running maxLag late, correlating a window against it reads the
+	// beat as if it repeated forever at every lag in range without the transform wrapping round
+	for(int n = 0; n < fftSize; ++n)
+	{
+		input[n].r = (n < m_numWindowSamples + 2 * m_maxLag) ? samples[Math::positiveModulo(n - m_maxLag, numSamples)] : 0.0f;
+		input[n].i = 0.0f;
+	}
+	m_extendedSpectra[instanceIndex].resize(fftSize);
+	m_pForwardFFT->perform(input.data(), m_extendedSpectra[instanceIndex].data());
+}
+
+
+void AlignmentSolver::buildCorrelation(int firstIndex, int secondIndex)
+{
+	const std::vector<FFT::Complex>& window = m_windowSpectra[firstIndex];
+	const std::vector<FFT::Complex>& extended = m_extendedSpectra[secondIndex];
+	const int fftSize = m_pForwardFFT->getSize();
+	std::vector<FFT::Complex> crossSpectrum(fftSize);
+	std::vector<FFT::Complex> correlation(fftSize);
+
+	// conj(window) * extended is the cross-spectrum, keeping only the low bins filters both beats at once
+	for(int bin = 0; bin < fftSize; ++bin)
+	{
+		if(bin <= m_numLowBandBins || bin >= fftSize - m_numLowBandBins)
+		{
+			crossSpectrum[bin].r = window[bin].r * extended[bin].r + window[bin].i * extended[bin].i;
+			crossSpectrum[bin].i = window[bin].r * extended[bin].i - window[bin].i * extended[bin].r;
+		}
+		else
+		{
+			crossSpectrum[bin].r = 0.0f;
+			crossSpectrum[bin].i = 0.0f;
+		}
+	}
+	m_pInverseFFT->perform(crossSpectrum.data(), correlation.data());
+
+	// entry lag + maxLag is the sum of first[m] * second[m + lag] over the window, the reverse pair is the
+	// same table read backwards
+	const int numLags = 2 * m_maxLag + 1;
+	std::vector<float>& forward = m_correlations[firstIndex * m_numInstances + secondIndex];
+	std::vector<float>& reverse = m_correlations[secondIndex * m_numInstances + firstIndex];
+	forward.resize(numLags);
+	reverse.resize(numLags);
+	for(int i = 0; i < numLags; ++i)
+	{
+		forward[i] = correlation[i].r / fftSize;
+		reverse[numLags - 1 - i] = forward[i];
+	}
+}
+
+
+void AlignmentSolver::descend(int startIndex)
+{
+	const std::vector<Instance>& instances = *m_pInstances;
+	const int numInstances = (int)instances.size();
+
+	Setting& setting = m_settings[startIndex];
+	setting.m_delays.resize(numInstances);
+	setting.m_signs.resize(numInstances);
+	for(int i = 0; i < numInstances; ++i)
+	{
+		setting.m_delays[i] = jlimit(-m_maxDelay, m_maxDelay, instances[i].m_delaySamples);
+		setting.m_signs[i] = (instances[i].m_sampleSign < 0.0f) ? -1.0f : 1.0f;
+	}
+
+	// start 0 keeps the current settings, start 1 lines every instance up with the anchor alone and the rest
+	// place instances one at a time against everything placed so far, each beginning with a different one
+	std::vector<float> values;
+	std::vector<bool> isPlaced(numInstances, startIndex == 0);
+	if(startIndex > 0)
+	{
+		isPlaced[0] = true;
+		for(int step = 0; step < numInstances - 1; ++step)
+		{
+			const int instanceIndex = 1 + (startIndex + step) % (numInstances - 1);
+			placeInstance(setting, instanceIndex, isPlaced, values);
+			isPlaced[instanceIndex] = startIndex > 1;
+		}
+		isPlaced.assign(numInstances, true);
+	}
+
+	for(int pass = 0; pass < ALIGNMENTSOLVER_MAX_DESCENT_PASSES; ++pass)
+	{
+		bool hasMoved = false;
+		for(int i = 1; i < numInstances; ++i)
+			hasMoved |= placeInstance(setting, i, isPlaced, values);
+
+		if(!hasMoved)
+			break;
+	}
+
+	setting.m_score = getScore(setting);
+}
+
+
+bool AlignmentSolver::placeInstance(Setting& setting, int instanceIndex, const std::vector<bool>& isPlaced, std::vector<float>& values) const
+{
+	// the instance adds sign * sum(sign_j * R_ij(delay - delay_j)) to the score, so values holds that sum for
+	// every delay in range and the best sign is whichever makes it positive
+	const int numInstances = (int)setting.m_delays.size();
+	const int numDelays = 2 * m_maxDelay + 1;
+	values.resize(numDelays);
+	FloatVectorOperations::clear(values.data(), numDelays);
+
+	bool hasPlacedInstance = false;
+	for(int j = 0; j < numInstances; ++j)
+	{
+		if(j != instanceIndex && isPlaced[j])
+		{
+			FloatVectorOperations::addWithMultiply(values.data(), getCorrelation(instanceIndex, j, -m_maxDelay - setting.m_delays[j]), setting.m_signs[j], numDelays);
+			hasPlacedInstance = true;
+		}
+	}
+
+	if(!hasPlacedInstance)
+		return false;
+
+	// only a clear improvement moves the instance, so descent always finishes
+	const int currentIndex = setting.m_delays[instanceIndex] + m_maxDelay;
+	float bestValue = setting.m_signs[instanceIndex] * values[currentIndex];
+	int bestIndex = -1;
+	for(int i = 0; i < numDelays; ++i)
+	{
+		if(fabsf(values[i]) > bestValue + fabsf(bestValue) * ALIGNMENTSOLVER_MIN_IMPROVEMENT)
+		{
+			bestValue = fabsf(values[i]);
+			bestIndex = i;
+		}
+	}
+
+	if(bestIndex < 0)
+		return false;
+
+	setting.m_delays[instanceIndex] = bestIndex - m_maxDelay;
+	setting.m_signs[instanceIndex] = (values[bestIndex] < 0.0f) ? -1.0f : 1.0f;
+	return true;
+}
+
+
+float AlignmentSolver::getScore(const Setting& setting) const
+{
+	// the energy of each beat alone doesn't depend on the setting, so only the cross terms are scored
+	float score = 0.0f;
+	const int numInstances = (int)setting.m_delays.size();
+	for(int i = 0; i < numInstances; ++i)
+		for(int j = i + 1; j < numInstances; ++j)
+			score += setting.m_signs[i] * setting.m_signs[j] * *getCorrelation(i, j, setting.m_delays[i] - setting.m_delays[j]);
+
+	return score;
+}
+
+
+const float* AlignmentSolver::getCorrelation(int firstIndex, int secondIndex, int lag) const
+{
+	return m_correlations[firstIndex * m_numInstances + secondIndex].data() + lag + m_maxLag;
+}
\ No newline at end of file
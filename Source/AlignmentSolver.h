@@ -0,0 +1,77 @@
+#pragma once
+
+
+#include "JuceHeader.h"
+#include <vector>
+
+
+// Finds the delay and polarity for every instance in a group that leaves the most low band energy once they're
+// summed, which is the same as the least cancellation. The low band correlation of every pair at every lag comes
+// from FFT cross-spectra, then coordinate descent runs from several starting points and the best result is kept.
+// Both stages are spread over a thread pool.
+class AlignmentSolver
+{
+public:
+	class Listener
+	{
+	public:
+		virtual ~Listener() {}
+
+		// both are called on the thread running solve()
+		virtual void alignmentProgressChanged(float progress) = 0;
+		virtual bool alignmentShouldStop() = 0;
+	};
+
+	// instance 0 is the anchor and keeps its settings, every other instance is searched for
+	struct Instance
+	{
+		std::vector<float> m_samples;
+		int m_delaySamples;
+		float m_sampleSign;
+	};
+
+	AlignmentSolver(int numThreads);
+	~AlignmentSolver();
+
+	// delays are searched over +-maxDelaySamples, the instances are only changed if it returns true
+	bool solve(std::vector<Instance>& instances, double sampleRate, int maxDelaySamples, Listener* pListener);
+
+private:
+	class SpectrumJob;
+	class CorrelationJob;
+	class DescentJob;
+
+	struct Setting
+	{
+		std::vector<int> m_delays;
+		std::vector<float> m_signs;
+		float m_score;
+	};
+
+	bool waitForJobs(int numJobs, Listener* pListener);
+	void buildSpectra(int instanceIndex);
+	void buildCorrelation(int firstIndex, int secondIndex);
+	void descend(int startIndex);
+	bool placeInstance(Setting& setting, int instanceIndex, const std::vector<bool>& isPlaced, std::vector<float>& values) const;
+	float getScore(const Setting& setting) const;
+	const float* getCorrelation(int firstIndex, int secondIndex, int lag) const;
+
+	ThreadPool m_threadPool;
+	int m_numJobs;
+	int m_numJobsFinished;
+
+	const std::vector<Instance>* m_pInstances;
+	int m_numInstances;
+	int m_numWindowSamples;
+	int m_maxDelay;
+	int m_maxLag;
+	int m_numLowBandBins;
+	ScopedPointer<FFT> m_pForwardFFT;
+	ScopedPointer<FFT> m_pInverseFFT;
+	std::vector<std::vector<FFT::Complex>> m_windowSpectra;
+	std::vector<std::vector<FFT::Complex>> m_extendedSpectra;
+	std::vector<std::vector<float>> m_correlations;
+	std::vector<Setting> m_settings;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AlignmentSolver)
+};
\ No newline at end of file
@@ -0,0 +1,86 @@
+#include "AlignmentTask.h"
+#include "PluginProcessor.h"
+
+
+#define ALIGNMENTTASK_CANCEL_TIMEOUT_MS 4000
+#define ALIGNMENTTASK_READ_ATTEMPTS 4
+
+
+
+AlignmentTask::AlignmentTask(const std::vector<KickFaceAudioProcessor*>& processors, Component* pComponentToCentreAround)
+	: ThreadWithProgressWindow("Aligning Instances", true, true, ALIGNMENTTASK_CANCEL_TIMEOUT_MS, String(), pComponentToCentreAround)
+	, m_sampleRate(0.0)
+	, m_solver(SystemStats::getNumCpus())
+	, m_isSolved(false)
+{
+	// the newest finished beat of each instance is copied out of its history, which tells when a copy raced the
+	// audio thread pushing another beat so it can be taken again, the solver then works on copies alone
+	for(int i = 0; i < processors.size(); ++i)
+	{
+		KickFaceAudioProcessor* pProcessor = processors[i];
+		AlignmentSolver::Instance instance;
+		bool hasBeat = false;
+		for(int attempt = 0; pProcessor && !hasBeat && attempt < ALIGNMENTTASK_READ_ATTEMPTS; ++attempt)
+		{
+			const BeatHistory& beatHistory = pProcessor->getBeatHistory();
+			int64 beatNumber = -1;
+			hasBeat = beatHistory.readSlot(beatHistory.getNewestSlot(), beatNumber, instance.m_samples);
+		}
+
+		if(!hasBeat)
+		{
+			// without the anchor there is nothing to align to
+			if(i == 0)
+				break;
+			continue;
+		}
+
+		if(m_processors.empty())
+			m_sampleRate = pProcessor->getSampleRate();
+
+		instance.m_delaySamples = roundFloatToInt((float)pProcessor->getDelayValue().getValue());
+		instance.m_sampleSign = (float)pProcessor->getInvertPhaseValue().getValue() > 0.5f ? -1.0f : 1.0f;
+		m_instances.push_back(instance);
+		m_processors.push_back(pProcessor);
+	}
+
+	setStatusMessage("Searching delays and polarities");
+}
+
+
+void AlignmentTask::run()
+{
+	m_isSolved = m_solver.solve(m_instances, m_sampleRate, SAMPLE_DELAY_RANGE, this);
+}
+
+
+void AlignmentTask::threadComplete(bool userPressedCancel)
+{
+	// instances removed while the solver ran are skipped, the anchor is left alone
+	if(m_isSolved && !userPressedCancel)
+	{
+		for(int i = 1; i < m_processors.size(); ++i)
+		{
+			KickFaceAudioProcessor* pProcessor = m_processors[i].get();
+			if(pProcessor)
+			{
+				pProcessor->getDelayValue().setValue((float)m_instances[i].m_delaySamples);
+				pProcessor->getInvertPhaseValue().setValue(m_instances[i].m_sampleSign < 0.0f ? 1.0f : 0.0f);
+			}
+		}
+	}
+
+	delete this;
+}
+
+
+void AlignmentTask::alignmentProgressChanged(float progress)
+{
+	setProgress(progress);
+}
+
+
+bool AlignmentTask::alignmentShouldStop()
+{
+	return threadShouldExit();
+}
\ No newline at end of file
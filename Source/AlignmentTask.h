@@ -0,0 +1,35 @@
+#pragma once
+
+
+#include "JuceHeader.h"
+#include "AlignmentSolver.h"
+#include <vector>
+
+
+class KickFaceAudioProcessor;
+
+
+// Runs the alignment solver for a group of instances behind a progress window. Beats and settings are captured
+// when it's created and the results are written to each instance's delay and invertPhase parameters once the
+// solver completes, both on the message thread. It deletes itself when it's done, so launch it and let it go.
+class AlignmentTask : public ThreadWithProgressWindow, private AlignmentSolver::Listener
+{
+public:
+	// the first processor is the anchor and its settings aren't changed
+	AlignmentTask(const std::vector<KickFaceAudioProcessor*>& processors, Component* pComponentToCentreAround);
+
+private:
+	void run() override;
+	void threadComplete(bool userPressedCancel) override;
+
+	void alignmentProgressChanged(float progress) override;
+	bool alignmentShouldStop() override;
+
+	std::vector<WeakReference<KickFaceAudioProcessor>> m_processors;
+	std::vector<AlignmentSolver::Instance> m_instances;
+	double m_sampleRate;
+	AlignmentSolver m_solver;
+	bool m_isSolved;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AlignmentTask)
+};
\ No newline at end of file
@@ -1,99 +1,121 @@
 #include "AudioDisplayComponent.h"
 #include "PluginProcessor.h"
+#include "GlobalProcessorArray.h"
+#include "AlignmentTask.h"
 #include "Math.h"
+#include "Renderer/DisplayShaders.h"
 
 
 #define AUDIODISPLAY_NEAR 0.0f
 #define AUDIODISPLAY_FAR 1.0f
 #define AUDIODISPLAY_NUM_QUADS 500
-#define AUDIODISPLAY_UPSCALE 1
-
-
-
-const char* gQuadMeshVertexShaderSource = 
-"attribute vec3 v_position;\
-attribute vec4 v_colour;\
-\
-varying vec4 f_colour;\
-\
-void main()\
-{\
-	gl_Position = vec4(v_position, 1.0f);\
-	f_colour = v_colour;\
-}";
-
-
-const char* gQuadMeshFragmentShaderSource = 
-"varying vec4 f_colour;\
-\
-void main()\
-{\
-	gl_FragColor = f_colour;\
-}";
-
-
-
-const char* gTexQuadVertexShaderSource =
-"attribute vec3 v_position;\
-attribute vec2 v_texCoord;\
-\
-varying vec2 f_texCoord;\
-\
-void main()\
-{\
-	gl_Position = vec4(v_position, 1.0f);\
-	f_texCoord = v_texCoord;\
-}";
-
-
-const char* gTexQuadFragmentShaderSource =
-"varying vec2 f_texCoord;\
-\
-uniform sampler2D texture0;\
-\
-void main()\
-{\
-	gl_FragColor = texture2D(texture0, f_texCoord);\
-}";
-
+#define AUDIODISPLAY_NUM_POINTS (AUDIODISPLAY_NUM_QUADS + 1)
+#define AUDIODISPLAY_NUM_STRIP_VERTS (2 * (AUDIODISPLAY_NUM_QUADS + 1))
+#define AUDIODISPLAY_EDGE_PIXELS 1.0f
+#define AUDIODISPLAY_MSAA_LEVEL 0
+#define AUDIODISPLAY_NUM_TIME_BARS 3
+#define AUDIODISPLAY_MAX_REMOTE_SOURCES 6
+#define AUDIODISPLAY_MAX_LAYERS ((int)E_Layer::FirstRemote + AUDIODISPLAY_MAX_REMOTE_SOURCES)
+#define AUDIODISPLAY_TIME_BAR_COLOUR AUDIODISPLAY_MAX_LAYERS
+#define AUDIODISPLAY_HISTORY_COLOUR_START (AUDIODISPLAY_MAX_LAYERS + 1)
+#define AUDIODISPLAY_NUM_COLOURS DISPLAYSHADERS_NUM_COLOURS
+#define AUDIODISPLAY_HISTORY_ALPHA 0.6f
+#define AUDIODISPLAY_MENU_OPENGL_ID 1
+#define AUDIODISPLAY_MENU_SOFTWARE_ID 2
+#define AUDIODISPLAY_MENU_ALIGN_ID 10
+#define AUDIODISPLAY_MENU_MATCH_LOW_END_ID 11
+#define AUDIODISPLAY_MENU_CLEAR_LOW_END_ID 12
+#define AUDIODISPLAY_MENU_PHASE_VIEW_ID 13
+#define AUDIODISPLAY_MENU_HISTORY_VIEW_ID 14
+#define AUDIODISPLAY_MENU_CAPTURE_ID_START 20
+#define AUDIODISPLAY_MENU_CAPTURE_LENGTH_ID_START 30
+#define AUDIODISPLAY_MENU_CAPTURE_OFFSET_ID_START 40
+#define AUDIODISPLAY_MENU_RENDER_BUDGET_ID_START 50
+#define AUDIODISPLAY_MENU_REMOTE_ID_START 100
+
+
+
+const std::array<float, 4> gBackgroundColour = { 0.1f, 0.1f, 0.1f, 1.0f };
+const std::array<float, 4> gCombinedColour = { 0.3f, 0.3f, 0.3f, 1.0f };
+const std::array<float, 4> gLocalColour = { 141.0f / 255.0f, 21.0f / 255.0f, 74.0f / 255.0f, 1.0f };
+const std::array<float, 4> gRemoteColours[AUDIODISPLAY_MAX_REMOTE_SOURCES] = {
+	{ 40.0f / 255.0f, 119.0f / 255.0f, 118.0f / 255.0f, 1.0f },
+	{ 176.0f / 255.0f, 189.0f / 255.0f, 19.0f / 255.0f, 1.0f },
+	{ 60.0f / 255.0f, 90.0f / 255.0f, 190.0f / 255.0f, 1.0f },
+	{ 200.0f / 255.0f, 120.0f / 255.0f, 30.0f / 255.0f, 1.0f },
+	{ 120.0f / 255.0f, 60.0f / 255.0f, 160.0f / 255.0f, 1.0f },
+	{ 50.0f / 255.0f, 150.0f / 255.0f, 70.0f / 255.0f, 1.0f } };
+const std::array<float, 4> gTimeBarColour = { 0.2f, 0.2f, 0.2f, 1.0f };
+const float gPhaseViewBarFrequencies[AUDIODISPLAY_NUM_TIME_BARS] = { 50.0f, 100.0f, 200.0f };
+const int gCaptureLengthsMs[] = { 100, 150, 200, 300, 400, 600, 1000 };
+const int gCaptureOffsetsMs[] = { 0, 10, 20, 50, 100, 200, 300 };
+const int gRenderBudgetsMs[] = { 50, 100, 250, 500, 1000 };
+
+
+static Colour toColour(const std::array<float, 4>& colour)
+{
+	return Colour::fromFloatRGBA(colour[0], colour[1], colour[2], colour[3]);
+}
 
 
 
 AudioDisplayComponent::AudioDisplayComponent(KickFaceAudioProcessor& processor)
-	: m_viewStartRatio(0.0f)
+	: m_pNativeSharedContext(nullptr)
+	, m_sharedGroupId(-1)
+	, m_pQuadMeshShaderProgram(nullptr)
+	, m_numStripVertices(0)
+	, m_pTextureShaderProgram(nullptr)
+	, m_textureUniform(-1)
+	, m_numHistoryVertices(0)
+	, m_historyFrameBufferIndex(0)
+	, m_hasAccumulatedHistory(false)
+	, m_accumulatedNewestBeatNumber(-1)
+	, m_accumulatedViewStartRatio(0.0f)
+	, m_accumulatedViewEndRatio(1.0f)
+	, m_accumulatedDelaySamples(0)
+	, m_accumulatedSampleSign(1.0f)
+	, m_viewStartRatio(0.0f)
 	, m_viewEndRatio(1.0f)
 	, m_zoomLevel(0.0f)
 	, m_dragMode(E_DragMode::None)
 	, m_dragSamples(0)
-	, m_resizeImages(false)
+	, m_producer(AUDIODISPLAY_NUM_POINTS)
+	, m_uploadedFrameNumber(-1)
+	, m_uploadedViewStartRatio(0.0f)
+	, m_uploadedViewEndRatio(1.0f)
+	, m_uploadedIsPhaseView(false)
+	, m_uploadedNewestHistoryBeatNumber(-1)
+	, m_uploadedHistoryDelaySamples(0)
+	, m_uploadedHistorySampleSign(1.0f)
+	, m_displayBackend(E_DisplayBackend::OpenGL)
+	, m_isPhaseView(false)
+	, m_isHistoryView(false)
 {
 	m_localAudioSource.m_processor = &processor;
-	m_localAudioSource.m_pQuadMesh = nullptr;
-	m_localAudioSource.m_prevCache.m_beatBufferPosition = 0;
-	m_localAudioSource.m_prevCache.m_delaySamples = 0;
-	m_localAudioSource.m_prevCache.m_invertPhase = false;
-	m_localAudioSource.m_prevCache.m_listenMode = (int)E_ListenMode::LeftChannelOnly;
-
-	m_remoteAudioSource.m_processor = nullptr;
-	m_remoteAudioSource.m_pQuadMesh = nullptr;
-	m_remoteAudioSource.m_prevCache.m_beatBufferPosition = 0;
-	m_remoteAudioSource.m_prevCache.m_delaySamples = 0;
-	m_remoteAudioSource.m_prevCache.m_invertPhase = false;
-	m_remoteAudioSource.m_prevCache.m_listenMode = (int)E_ListenMode::LeftChannelOnly;
-
-	m_combinedAudioSource.m_audioSources.add(&m_localAudioSource);
-	m_combinedAudioSource.m_audioSources.add(&m_remoteAudioSource);
-	m_combinedAudioSource.m_pQuadMesh = nullptr;
+	m_remoteAudioSources.resize(1);
+	m_producer.startProducing(this);
+
+	// multisampling is optional, the shader already antialiases the waveform edges
+#if AUDIODISPLAY_MSAA_LEVEL > 0
+	OpenGLPixelFormat pixelFormat;
+	pixelFormat.multisamplingLevel = AUDIODISPLAY_MSAA_LEVEL;
+	m_openGLContext.setPixelFormat(pixelFormat);
+	m_openGLContext.setMultisamplingEnabled(true);
+#endif
 
 	m_openGLContext.setComponentPaintingEnabled(false);
-	m_openGLContext.setContinuousRepainting(true);
+	m_openGLContext.setContinuousRepainting(false);
 	m_openGLContext.setRenderer(this);
-	m_openGLContext.attachTo(*this);
+	attachOpenGLContext();
+
+	RenderCoordinator::addClient(this);
 }
 
 
 AudioDisplayComponent::~AudioDisplayComponent()
 {
+	RenderCoordinator::removeClient(this);
+	m_producer.stopProducing();
 	m_openGLContext.detach();
 	m_openGLContext.setRenderer(nullptr);
 }
@@ -101,35 +123,141 @@ AudioDisplayComponent::~AudioDisplayComponent()
 
 void AudioDisplayComponent::setRemoteAudioSource(KickFaceAudioProcessor* pProcessor)
 {
-	m_remoteAudioSource.m_processor = pProcessor;
-	if(pProcessor)
+	// the first remote is the one chosen in the editor, any others were added from the context menu
+	for(int i = 1; i < m_remoteAudioSources.size(); ++i)
 	{
-		m_remoteAudioSource.m_prevCache.m_beatBufferPosition = pProcessor->getBeatBufferPosition();
-		m_remoteAudioSource.m_prevCache.m_delaySamples = (float)pProcessor->getDelayValue().getValue();
-		m_remoteAudioSource.m_prevCache.m_invertPhase = (float)pProcessor->getInvertPhaseValue().getValue() > 0.5f;
-		m_remoteAudioSource.m_prevCache.m_listenMode = roundFloatToInt((float)pProcessor->getListenModeValue().getValue());
+		if(m_remoteAudioSources[i].m_processor.get() == pProcessor)
+		{
+			m_remoteAudioSources.erase(m_remoteAudioSources.begin() + i);
+			break;
+		}
 	}
-	else
+
+	m_remoteAudioSources[0].m_processor = pProcessor;
+}
+
+
+void AudioDisplayComponent::toggleRemoteAudioSource(KickFaceAudioProcessor* pProcessor)
+{
+	if(pProcessor == nullptr || pProcessor == m_localAudioSource.m_processor.get() || pProcessor == m_remoteAudioSources[0].m_processor.get())
+		return;
+
+	for(int i = 1; i < m_remoteAudioSources.size(); ++i)
+	{
+		if(m_remoteAudioSources[i].m_processor.get() == pProcessor)
+		{
+			m_remoteAudioSources.erase(m_remoteAudioSources.begin() + i);
+			return;
+		}
+	}
+
+	if(m_remoteAudioSources.size() < AUDIODISPLAY_MAX_REMOTE_SOURCES)
 	{
-		m_remoteAudioSource.m_prevCache.m_beatBufferPosition = 0;
-		m_remoteAudioSource.m_prevCache.m_delaySamples = 0;
-		m_remoteAudioSource.m_prevCache.m_invertPhase = false;
-		m_remoteAudioSource.m_prevCache.m_listenMode = 0;
+		AudioSource audioSource;
+		audioSource.m_processor = pProcessor;
+		m_remoteAudioSources.push_back(audioSource);
 	}
 }
 
 
+bool AudioDisplayComponent::isRemoteAudioSource(KickFaceAudioProcessor* pProcessor) const
+{
+	for(int i = 0; i < m_remoteAudioSources.size(); ++i)
+		if(pProcessor != nullptr && m_remoteAudioSources[i].m_processor.get() == pProcessor)
+			return true;
+
+	return false;
+}
+
+
+void AudioDisplayComponent::alignRemoteAudioSources()
+{
+	// the local instance anchors the group, so only the remotes are moved
+	std::vector<KickFaceAudioProcessor*> processors;
+	processors.push_back(m_localAudioSource.m_processor.get());
+	for(int i = 0; i < m_remoteAudioSources.size(); ++i)
+		if(m_remoteAudioSources[i].m_processor.get())
+			processors.push_back(m_remoteAudioSources[i].m_processor.get());
+
+	if(processors[0] != nullptr && processors.size() > 1)
+		(new AlignmentTask(processors, this))->launchThread();
+}
+
+
+void AudioDisplayComponent::matchLowEndPhase(bool shouldMatch)
+{
+	// the filter runs on the local instance and matches it to the remote chosen in the editor
+	KickFaceAudioProcessor* pProcessor = m_localAudioSource.m_processor.get();
+	if(pProcessor)
+		pProcessor->designAlignmentFilter(shouldMatch ? m_remoteAudioSources[0].m_processor.get() : nullptr);
+}
+
+
+void AudioDisplayComponent::setDisplayBackend(E_DisplayBackend backend)
+{
+	if(backend == m_displayBackend)
+		return;
+
+	// detaching waits for the render thread, so both backends never draw at once
+	m_displayBackend = backend;
+	if(m_displayBackend == E_DisplayBackend::Software)
+		m_openGLContext.detach();
+	else
+		attachOpenGLContext();
+
+	repaint();
+}
+
+
+AudioDisplayComponent::E_DisplayBackend AudioDisplayComponent::getDisplayBackend() const
+{
+	return m_displayBackend;
+}
+
+
+void AudioDisplayComponent::setPhaseView(bool isPhaseView)
+{
+	// the next snapshot asks the producer for the other view, the current frame stays up until it's built
+	m_isPhaseView = isPhaseView;
+}
+
+
+bool AudioDisplayComponent::isPhaseView() const
+{
+	return m_isPhaseView;
+}
+
+
+void AudioDisplayComponent::setHistoryView(bool isHistoryView)
+{
+	m_isHistoryView = isHistoryView;
+}
+
+
+bool AudioDisplayComponent::isHistoryView() const
+{
+	return m_isHistoryView;
+}
+
+
+void AudioDisplayComponent::attachOpenGLContext()
+{
+	// the native context is created as soon as an attached component is showing, so attaching waits until then
+	// and picks the context to share with right before. One picked earlier could belong to an editor that has
+	// closed since, and every attach picks again.
+	if(m_displayBackend != E_DisplayBackend::OpenGL || !isShowing() || m_openGLContext.isAttached())
+		return;
+
+	m_pNativeSharedContext = SharedRenderResources::pickSharedContext(m_sharedGroupId);
+	m_openGLContext.setNativeSharedContext(m_pNativeSharedContext);
+	m_openGLContext.attachTo(*this);
+}
+
+
 void AudioDisplayComponent::newOpenGLContextCreated()
 {
-	m_pQuadMeshShaderProgram = nullptr;
-	m_pTexQuadShaderProgram = nullptr;
-	m_pQuadMesh = nullptr;
-	m_localAudioSource.m_pQuadMesh = nullptr;
-	m_remoteAudioSource.m_pQuadMesh = nullptr;
-	m_combinedAudioSource.m_pQuadMesh = nullptr;
-	m_localAudioSource.m_pTexQuad = nullptr;
-	m_remoteAudioSource.m_pTexQuad = nullptr;
-	m_combinedAudioSource.m_pTexQuad = nullptr;
+	releaseOpenGL();
+	SharedRenderResources::addContext(m_openGLContext.getRawContext(), m_sharedGroupId);
 }
 
 
@@ -138,99 +266,98 @@ void AudioDisplayComponent::initialiseOpenGL()
 	if(m_pQuadMeshShaderProgram != nullptr)
 		return;
 
-	m_pQuadMeshShaderProgram = new ShaderProgram(m_openGLContext);
-	if(m_pQuadMeshShaderProgram->load(gQuadMeshVertexShaderSource, gQuadMeshFragmentShaderSource))
+	// the colour count is pasted into the shader source so it has to be a plain number
+	static_assert(AUDIODISPLAY_NUM_COLOURS == AUDIODISPLAY_HISTORY_COLOUR_START + BEAT_HISTORY_SIZE, "AUDIODISPLAY_NUM_COLOURS must count every layer colour");
+
+	m_pQuadMeshShaderProgram = acquireShaderProgram(gQuadMeshVertexShaderSource, gQuadMeshFragmentShaderSource);
+	// the colours are shared by every display using the program, which is only safe while they are all
+	// constants, anything that differs between displays has to go in the vertices
+	m_colourUniforms.resize(AUDIODISPLAY_NUM_COLOURS);
+	for(int i = 0; i < AUDIODISPLAY_NUM_COLOURS; ++i)
+		m_colourUniforms[i] = m_pQuadMeshShaderProgram->getUniformIndex("layerColours[" + String(i) + "]");
+
+	if(m_pQuadMeshShaderProgram->isLoaded())
 	{
-		std::vector<Attribute> colQuadAttributes;
-		colQuadAttributes.resize(2);
+		std::vector<Attribute> waveAttributes;
+		waveAttributes.resize(3);
 
-		colQuadAttributes[0].m_name = "v_position";
-		colQuadAttributes[0].m_numFloats = 3;
-		colQuadAttributes[0].m_floatOffset = 0;
+		waveAttributes[0].m_name = "v_position";
+		waveAttributes[0].m_numFloats = 2;
+		waveAttributes[0].m_floatOffset = 0;
 
-		colQuadAttributes[1].m_name = "v_colour";
-		colQuadAttributes[1].m_numFloats = 4;
-		colQuadAttributes[1].m_floatOffset = 3;
+		waveAttributes[1].m_name = "v_edge";
+		waveAttributes[1].m_numFloats = 1;
+		waveAttributes[1].m_floatOffset = 2;
 
-		m_pQuadMesh = new DynamicQuadMesh<ColQuadVert>(m_openGLContext, 3, colQuadAttributes);
-		m_localAudioSource.m_pQuadMesh = new DynamicQuadMesh<ColQuadVert>(m_openGLContext, AUDIODISPLAY_NUM_QUADS, colQuadAttributes);
-		m_remoteAudioSource.m_pQuadMesh = new DynamicQuadMesh<ColQuadVert>(m_openGLContext, AUDIODISPLAY_NUM_QUADS, colQuadAttributes);
-		m_combinedAudioSource.m_pQuadMesh = new DynamicQuadMesh<ColQuadVert>(m_openGLContext, AUDIODISPLAY_NUM_QUADS, colQuadAttributes);
-	}
+		waveAttributes[2].m_name = "v_layer";
+		waveAttributes[2].m_numFloats = 1;
+		waveAttributes[2].m_floatOffset = 3;
 
-	m_pTexQuadShaderProgram = new ShaderProgram(m_openGLContext);
-	if(m_pTexQuadShaderProgram->load(gTexQuadVertexShaderSource, gTexQuadFragmentShaderSource))
-	{
-		std::vector<TexQuadVert> texQuadVerts;
-		texQuadVerts.resize(4);
-
-		texQuadVerts[0].m_position[0] = -1.0f;
-		texQuadVerts[0].m_position[1] = -1.0f;
-		texQuadVerts[0].m_position[2] = 0.5f;
-		texQuadVerts[0].m_texCoord[0] = 0.0f;
-		texQuadVerts[0].m_texCoord[1] = 0.0f;
-
-		texQuadVerts[1].m_position[0] = 1.0f;
-		texQuadVerts[1].m_position[1] = -1.0f;
-		texQuadVerts[1].m_position[2] = 0.5f;
-		texQuadVerts[1].m_texCoord[0] = 1.0f;
-		texQuadVerts[1].m_texCoord[1] = 0.0f;
-
-		texQuadVerts[2].m_position[0] = 1.0f;
-		texQuadVerts[2].m_position[1] = 1.0f;
-		texQuadVerts[2].m_position[2] = 0.5f;
-		texQuadVerts[2].m_texCoord[0] = 1.0f;
-		texQuadVerts[2].m_texCoord[1] = 1.0f;
-
-		texQuadVerts[3].m_position[0] = -1.0f;
-		texQuadVerts[3].m_position[1] = 1.0f;
-		texQuadVerts[3].m_position[2] = 0.5f;
-		texQuadVerts[3].m_texCoord[0] = 0.0f;
-		texQuadVerts[3].m_texCoord[1] = 1.0f;
-
-		std::vector<GLuint> texQuadIndices;
-		texQuadIndices.resize(6);
-		texQuadIndices[0] = 0;
-		texQuadIndices[1] = 1;
-		texQuadIndices[2] = 2;
-		texQuadIndices[3] = 0;
-		texQuadIndices[4] = 2;
-		texQuadIndices[5] = 3;
-
-		std::vector<Attribute> texQuadAttributes;
-		texQuadAttributes.resize(2);
-
-		texQuadAttributes[0].m_name = "v_position";
-		texQuadAttributes[0].m_numFloats = 3;
-		texQuadAttributes[0].m_floatOffset = 0;
-
-		texQuadAttributes[1].m_name = "v_texCoord";
-		texQuadAttributes[1].m_numFloats = 2;
-		texQuadAttributes[1].m_floatOffset = 3;
-
-		m_localAudioSource.m_pTexQuad = new StaticMesh<TexQuadVert>(m_openGLContext, texQuadVerts, texQuadIndices, texQuadAttributes);
-		m_remoteAudioSource.m_pTexQuad = new StaticMesh<TexQuadVert>(m_openGLContext, texQuadVerts, texQuadIndices, texQuadAttributes);
-		m_combinedAudioSource.m_pTexQuad = new StaticMesh<TexQuadVert>(m_openGLContext, texQuadVerts, texQuadIndices, texQuadAttributes);
+		// every waveform goes in one triangle strip, with two extra vertices joining each layer to the next
+		m_pQuadMesh = new DynamicQuadMesh<WaveVert>(AUDIODISPLAY_NUM_TIME_BARS, waveAttributes);
+		m_pStripMesh = new DynamicStripMesh<WaveVert>(AUDIODISPLAY_MAX_LAYERS * (AUDIODISPLAY_NUM_STRIP_VERTS + 2), waveAttributes);
+		m_pHistoryStripMesh = new DynamicStripMesh<WaveVert>(BEAT_HISTORY_SIZE * (AUDIODISPLAY_NUM_STRIP_VERTS + 2), waveAttributes);
 	}
 
-	KickFaceAudioProcessor* pLocalProcessor = m_localAudioSource.m_processor.get();
-	if(pLocalProcessor)
-	{
-		m_localAudioSource.m_prevCache.m_beatBufferPosition = pLocalProcessor->getBeatBufferPosition();
-		m_localAudioSource.m_prevCache.m_delaySamples = (float)pLocalProcessor->getDelayValue().getValue();
-	}
+	m_pTextureShaderProgram = acquireShaderProgram(gTextureVertexShaderSource, gTextureFragmentShaderSource);
+	m_textureUniform = m_pTextureShaderProgram->getUniformIndex("accumulation");
 
-	KickFaceAudioProcessor* pRemoteProcessor = m_remoteAudioSource.m_processor.get();
-	if(pRemoteProcessor)
+	if(m_pTextureShaderProgram->isLoaded())
 	{
-		m_remoteAudioSource.m_prevCache.m_beatBufferPosition = pRemoteProcessor->getBeatBufferPosition();
-		m_remoteAudioSource.m_prevCache.m_delaySamples = (float)pRemoteProcessor->getDelayValue().getValue();
+		std::vector<Attribute> textureAttributes;
+		textureAttributes.resize(3);
+
+		textureAttributes[0].m_name = "v_position";
+		textureAttributes[0].m_numFloats = 2;
+		textureAttributes[0].m_floatOffset = 0;
+
+		textureAttributes[1].m_name = "v_texCoord";
+		textureAttributes[1].m_numFloats = 2;
+		textureAttributes[1].m_floatOffset = 2;
+
+		textureAttributes[2].m_name = "v_fade";
+		textureAttributes[2].m_numFloats = 1;
+		textureAttributes[2].m_floatOffset = 4;
+
+		// the first quad composites the accumulated beats as they are, the second is refilled with each fade
+		m_pTextureQuadMesh = new DynamicQuadMesh<TextureVert>(2, textureAttributes);
+		m_pTextureQuadMesh->setQuad(0, getTextureQuad(1.0f));
 	}
 
-	m_localAudioSource.m_image = Image(Image::ARGB, AUDIODISPLAY_UPSCALE * getWidth(), AUDIODISPLAY_UPSCALE * getHeight(), true, OpenGLImageType());
-	m_remoteAudioSource.m_image = Image(Image::ARGB, AUDIODISPLAY_UPSCALE * getWidth(), AUDIODISPLAY_UPSCALE * getHeight(), true, OpenGLImageType());
-	m_combinedAudioSource.m_image = Image(Image::ARGB, AUDIODISPLAY_UPSCALE * getWidth(), AUDIODISPLAY_UPSCALE * getHeight(), true, OpenGLImageType());
-	m_resizeImages = false;
+	// new meshes are empty so the next frame has to be uploaded whatever its number
+	m_uploadedFrameNumber = -1;
+	m_numStripVertices = 0;
+	m_numHistoryVertices = 0;
+	m_hasAccumulatedHistory = false;
+}
+
+
+void AudioDisplayComponent::releaseOpenGL()
+{
+	m_pQuadMesh = nullptr;
+	m_pStripMesh = nullptr;
+	m_pHistoryStripMesh = nullptr;
+	m_pTextureQuadMesh = nullptr;
+	m_historyFrameBuffers[0].release();
+	m_historyFrameBuffers[1].release();
+	m_hasAccumulatedHistory = false;
+
+	SharedRenderResources::release(m_pQuadMeshShaderProgram);
+	m_pQuadMeshShaderProgram = nullptr;
+	SharedRenderResources::release(m_pTextureShaderProgram);
+	m_pTextureShaderProgram = nullptr;
+}
+
+
+ShaderProgram* AudioDisplayComponent::acquireShaderProgram(const char* pVertexSource, const char* pFragmentSource)
+{
+	const int64 key = SharedRenderResources::hashString(pFragmentSource, SharedRenderResources::hashString(pVertexSource, 0));
+	return SharedRenderResources::acquire<ShaderProgram>(key, [=]()
+	{
+		ShaderProgram* pShaderProgram = new ShaderProgram();
+		pShaderProgram->load(pVertexSource, pFragmentSource);
+		return pShaderProgram;
+	});
 }
 
 
@@ -238,125 +365,80 @@ void AudioDisplayComponent::renderOpenGL()
 {
 	jassert(OpenGLHelpers::isContextActive());
 
+	const double renderStartTime = Time::getMillisecondCounterHiRes();
+
 	// initialise opengl if needed
 	initialiseOpenGL();
 
-	// resize images if needed
-	if(m_resizeImages && m_pQuadMeshShaderProgram != nullptr)
+	// a wave program that failed to build leaves nothing to draw with, without the texture program only the
+	// earlier beats are left out
+	if(!m_pQuadMeshShaderProgram->isLoaded() || m_pQuadMesh == nullptr || m_pStripMesh == nullptr)
 	{
-		m_localAudioSource.m_image = Image(Image::ARGB, AUDIODISPLAY_UPSCALE * getWidth(), AUDIODISPLAY_UPSCALE * getHeight(), true, OpenGLImageType());
-		m_remoteAudioSource.m_image = Image(Image::ARGB, AUDIODISPLAY_UPSCALE * getWidth(), AUDIODISPLAY_UPSCALE * getHeight(), true, OpenGLImageType());
-		m_combinedAudioSource.m_image = Image(Image::ARGB, AUDIODISPLAY_UPSCALE * getWidth(), AUDIODISPLAY_UPSCALE * getHeight(), true, OpenGLImageType());
-		m_resizeImages = false;
+		OpenGLHelpers::clear(toColour(gBackgroundColour));
+		return;
 	}
 
-	// render waveforms to render targets
-	const float desktopScale = (float)m_openGLContext.getRenderingScale();
-	OpenGLHelpers::clear(Colour::greyLevel(0.1f));
+	// vertices were built by the producer, the meshes keep the last frame until a newer one is published
+	uploadPublishedFrame();
 
 	glDisable(GL_DEPTH_TEST);
 	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA_SATURATE, GL_ONE);
 	glDisable(GL_TEXTURE_2D);
 	glDisable(GL_CULL_FACE);
 
-	glEnable(GL_POLYGON_SMOOTH);
-
-	glViewport(0, 0, roundToInt(AUDIODISPLAY_UPSCALE * getWidth()), roundToInt(AUDIODISPLAY_UPSCALE * getHeight()));
-
-	m_pQuadMeshShaderProgram->useProgram();
+	// earlier beats are accumulated off screen before anything is drawn, binding a frame buffer moves the viewport
+	const float desktopScale = (float)m_openGLContext.getRenderingScale();
+	const int viewportWidth = roundToInt(desktopScale * getWidth());
+	const int viewportHeight = roundToInt(desktopScale * getHeight());
+	accumulateBeatHistory(viewportWidth, viewportHeight);
 
-	std::array<float, 4> colour;
-	colour[0] = 0.3f;
-	colour[1] = 0.3f;
-	colour[2] = 0.3f;
-	colour[3] = 1.0f;
-	renderCombinedAudioSource(m_combinedAudioSource, colour);
-	
-	colour[0] = 141.0f / 255.0f;
-	colour[1] = 21.0f / 255.0f;
-	colour[2] = 74.0f / 255.0f;
-	colour[3] = 1.0f;
-	renderAudioSource(m_localAudioSource, colour);
-
-	colour[0] = 40.0f / 255.0f;
-	colour[1] = 119.0f / 255.0f;
-	colour[2] = 118.0f / 255.0f;
-	colour[3] = 1.0f;
-	renderAudioSource(m_remoteAudioSource, colour);
-
-	glViewport(0, 0, roundToInt(desktopScale * getWidth()), roundToInt(desktopScale * getHeight()));
-
-	// render waveform textures
-	glEnable(GL_BLEND);
-	glEnable(GL_TEXTURE_2D);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	// render waveforms
+	OpenGLHelpers::clear(toColour(gBackgroundColour));
+	glViewport(0, 0, viewportWidth, viewportHeight);
 
-	m_pTexQuadShaderProgram->useProgram();
+	// the earlier beats go under everything else, however many there are it's a single textured quad
+	if(m_hasAccumulatedHistory)
+	{
+		glBlendFunc(GL_ONE, GL_ONE);
+		drawHistoryTexture(m_historyFrameBuffers[m_historyFrameBufferIndex], 1.0f);
+	}
 
-	// render audio sources
+	// draw every layer straight into the default framebuffer, the shader antialiases the edges
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE);
 
-	// render local audio sources
-	OpenGLFrameBuffer* pLocalTex = OpenGLImageType::getFrameBufferFrom(m_localAudioSource.m_image);
-	m_openGLContext.extensions.glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, pLocalTex->getTextureID());
-	m_openGLContext.extensions.glUniform1i(m_pTexQuadShaderProgram->getUniformIndex("texture0"), 0);
-	m_localAudioSource.m_pTexQuad->draw(m_pTexQuadShaderProgram);
+	m_pQuadMeshShaderProgram->useProgram();
+	setLayerColours();
 
-	// render remote audio source
-	if(m_remoteAudioSource.m_processor.get())
-	{
-		OpenGLFrameBuffer* pRemoteTex = OpenGLImageType::getFrameBufferFrom(m_remoteAudioSource.m_image);
-		m_openGLContext.extensions.glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, pRemoteTex->getTextureID());
-		m_openGLContext.extensions.glUniform1i(m_pTexQuadShaderProgram->getUniformIndex("texture0"), 0);
-		m_remoteAudioSource.m_pTexQuad->draw(m_pTexQuadShaderProgram);
-
-		// render combined
-		OpenGLFrameBuffer* pCombinedTex = OpenGLImageType::getFrameBufferFrom(m_combinedAudioSource.m_image);
-		m_openGLContext.extensions.glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, pCombinedTex->getTextureID());
-		m_openGLContext.extensions.glUniform1i(m_pTexQuadShaderProgram->getUniformIndex("texture0"), 0);
-		m_combinedAudioSource.m_pTexQuad->draw(m_pTexQuadShaderProgram);
-	}
+	if(m_pStripMesh && m_numStripVertices > 0)
+		m_pStripMesh->draw(m_pQuadMeshShaderProgram, 0, m_numStripVertices - 1);
 
 	// render time bars	
-	m_pQuadMeshShaderProgram->useProgram();
-
 	int numBars = 0;
 	const float timeBarHalfWidth = 1.0f / getWidth();
-	for(int barIndex = 0; barIndex < 3; ++barIndex)
+	for(int barIndex = 0; barIndex < AUDIODISPLAY_NUM_TIME_BARS; ++barIndex)
 	{
-		float xPos = (0.25f * (barIndex + 1) - m_viewStartRatio) / (m_viewEndRatio - m_viewStartRatio);
+		float xPos = getTimeBarPosition(barIndex, m_uploadedViewStartRatio, m_uploadedViewEndRatio, m_uploadedIsPhaseView);
 		if(xPos + timeBarHalfWidth > 0.0f || xPos - timeBarHalfWidth < 1.0f)
 		{
-			std::array<ColQuadVert, 4> verts;
+			// bars are pixel aligned so they are solid all the way to their edges
+			std::array<WaveVert, 4> verts;
+			for(WaveVert& vert : verts)
+			{
+				vert.m_edge = 1.0f;
+				vert.m_layer = AUDIODISPLAY_TIME_BAR_COLOUR;
+			}
 
 			verts[0].m_position[0] = 2.0f * jmax(xPos - timeBarHalfWidth, 0.0f) - 1.0f;
 			verts[0].m_position[1] = 1.0f;
-			verts[0].m_position[2] = 0.1f;
 
 			verts[1].m_position[0] = 2.0f * jmin(xPos + timeBarHalfWidth, 1.0f) - 1.0f;
 			verts[1].m_position[1] = 1.0f;
-			verts[1].m_position[2] = 0.1f;
 
 			verts[2].m_position[0] = 2.0f * jmin(xPos + timeBarHalfWidth, 1.0f) - 1.0f;
 			verts[2].m_position[1] = -1.0f;
-			verts[2].m_position[2] = 0.1f;
 
 			verts[3].m_position[0] = 2.0f * jmax(xPos - timeBarHalfWidth, 0.0f) - 1.0f;
 			verts[3].m_position[1] = -1.0f;
-			verts[3].m_position[2] = 0.1f;
-
-			for(int i = 0; i < 4; ++i)
-			{
-				verts[i].m_colour[0] = 0.2f;
-				verts[i].m_colour[1] = 0.2f;
-				verts[i].m_colour[2] = 0.2f;
-				verts[i].m_colour[3] = 1.0f;
-			}
 
 			m_pQuadMesh->setQuad(numBars, verts);
 			++numBars;
@@ -365,241 +447,420 @@ void AudioDisplayComponent::renderOpenGL()
 
 	if(numBars > 0)
 		m_pQuadMesh->draw(m_pQuadMeshShaderProgram, 0, numBars - 1);
+
+	// report frame cost so the coordinator can keep all open displays within budget
+	reportRenderTime(Time::getMillisecondCounterHiRes() - renderStartTime);
 }
 
 
-void AudioDisplayComponent::renderAudioSource(AudioSource& audioSource, const std::array<float, 4>& colour)
+void AudioDisplayComponent::uploadPublishedFrame()
 {
-	KickFaceAudioProcessor* pProcessor = audioSource.m_processor.get();
-	if(!pProcessor)
+	WaveformProducer::FrameReader reader(m_producer);
+	const WaveformProducer::Frame* pFrame = reader.getFrame();
+	if(pFrame == nullptr || pFrame->m_frameNumber == m_uploadedFrameNumber)
 		return;
 
-	OpenGLFrameBuffer* pRenderTarget = OpenGLImageType::getFrameBufferFrom(audioSource.m_image);
-	pRenderTarget->makeCurrentAndClear();
+	// visible layers are packed into the strip one after another, repeating the last vertex of one and the
+	// first of the next between them so the triangles bridging the gap have no area
+	const WaveVert* pPrevLastVertex = nullptr;
+	GLuint numVertices = 0;
+	for(int i = 0; i < pFrame->m_layers.size() && i < AUDIODISPLAY_MAX_LAYERS && m_pStripMesh; ++i)
+	{
+		const WaveformProducer::Layer& layer = pFrame->m_layers[i];
+		if(!layer.m_isVisible || layer.m_vertices.size() == 0)
+			continue;
+
+		if(pPrevLastVertex != nullptr)
+		{
+			m_pStripMesh->setVertex(numVertices++, *pPrevLastVertex);
+			m_pStripMesh->setVertex(numVertices++, layer.m_vertices[0]);
+		}
+
+		m_pStripMesh->setVertices(numVertices, layer.m_vertices.data(), (GLuint)layer.m_vertices.size());
+		numVertices += (GLuint)layer.m_vertices.size();
+		pPrevLastVertex = &layer.m_vertices.back();
+	}
 
-	int64 nextBeatBufferPosition = pProcessor->getBeatBufferPosition();
-	int nextDelaySamples = (float)pProcessor->getDelayValue().getValue();
-	bool nextInvertPhase = (float)pProcessor->getInvertPhaseValue().getValue() > 0.5f;
-	int nextListenMode = roundFloatToInt((float)pProcessor->getListenModeValue().getValue());
+	m_numStripVertices = numVertices;
 
-	// update mesh
-	AudioSampleBuffer* pBeatBuffer = pProcessor->getBeatBuffer();
-	if(pBeatBuffer && pBeatBuffer->getNumSamples() > 0)
+	// earlier beats get a strip of their own, oldest first so the ones that have just aged in are at the end
+	pPrevLastVertex = nullptr;
+	numVertices = 0;
+	m_historyFirstVertices.clear();
+	m_historyBeatNumbers.clear();
+	for(int i = 0; i < pFrame->m_historyLayers.size() && i < BEAT_HISTORY_SIZE && m_pHistoryStripMesh; ++i)
 	{
-		const int numBeatSamples = pBeatBuffer->getNumSamples();
-		const float sampleScale = (float)numBeatSamples / AUDIODISPLAY_NUM_QUADS;
-		const int beatBufferChangeSampleStart = Math::positiveModulo(audioSource.m_prevCache.m_beatBufferPosition + nextDelaySamples - (int)ceilf(sampleScale), numBeatSamples);
-		const int beatBufferChangeSampleEnd = Math::positiveModulo(nextBeatBufferPosition + nextDelaySamples + (int)ceilf(sampleScale), numBeatSamples);
-
-		const int viewStartBeatSample = (int)floorf(m_viewStartRatio * numBeatSamples);
-		const int viewEndBeatSample = (int)ceilf(m_viewEndRatio * numBeatSamples);
-		const float viewScale = (float)(viewEndBeatSample - viewStartBeatSample) / AUDIODISPLAY_NUM_QUADS;
-
-		int startQuad = 0;
-		int endQuad = AUDIODISPLAY_NUM_QUADS - 1;
-		const float sampleSign = nextInvertPhase ? -1.0f : 1.0f;
-		const float* pReadBuffer = pBeatBuffer->getReadPointer(0);
-
-		const float kVertDepth = 0.5f;
-		float vertXScale = 2.0f / AUDIODISPLAY_NUM_QUADS;
-		float vertXPos = -1.0f;
-		float vertYScale = 1.0f;
-		float vertYPos = 0.0f;
-		std::array<ColQuadVert, 4> verts;
-
-		float startSample = sampleSign * sampleBuffer(pReadBuffer, numBeatSamples, viewStartBeatSample + (startQuad * viewScale) - nextDelaySamples);
-		float endSample = sampleSign * sampleBuffer(pReadBuffer, numBeatSamples, viewStartBeatSample + ((startQuad + 1) * viewScale) - nextDelaySamples);
-		for(int i = startQuad; i <= endQuad; ++i)
+		const WaveformProducer::HistoryLayer& layer = pFrame->m_historyLayers[i];
+		if(layer.m_vertices.size() == 0)
+			continue;
+
+		if(pPrevLastVertex != nullptr)
 		{
-			verts[0].m_position[0] = vertXPos + ((i - 1) * vertXScale);
-			verts[0].m_position[1] = jlimit(-1.0f, 1.0f, vertYPos + (startSample * vertYScale));
-			verts[0].m_position[2] = kVertDepth;
+			m_pHistoryStripMesh->setVertex(numVertices++, *pPrevLastVertex);
+			m_pHistoryStripMesh->setVertex(numVertices++, layer.m_vertices[0]);
+		}
 
-			verts[1].m_position[0] = vertXPos + (i * vertXScale);
-			verts[1].m_position[1] = jlimit(-1.0f, 1.0f, vertYPos + (endSample * vertYScale));
-			verts[1].m_position[2] = kVertDepth;
+		m_historyFirstVertices.push_back(numVertices);
+		m_historyBeatNumbers.push_back(layer.m_beatNumber);
+		m_pHistoryStripMesh->setVertices(numVertices, layer.m_vertices.data(), (GLuint)layer.m_vertices.size());
+		numVertices += (GLuint)layer.m_vertices.size();
+		pPrevLastVertex = &layer.m_vertices.back();
+	}
+
+	m_numHistoryVertices = numVertices;
+	m_uploadedNewestHistoryBeatNumber = pFrame->m_newestHistoryBeatNumber;
+	m_uploadedHistoryDelaySamples = pFrame->m_historyDelaySamples;
+	m_uploadedHistorySampleSign = pFrame->m_historySampleSign;
+	m_uploadedFrameNumber = pFrame->m_frameNumber;
+	m_uploadedViewStartRatio = pFrame->m_viewStartRatio;
+	m_uploadedViewEndRatio = pFrame->m_viewEndRatio;
+	m_uploadedIsPhaseView = pFrame->m_isPhaseView;
+}
 
-			verts[2].m_position[0] = vertXPos + (i * vertXScale);
-			verts[2].m_position[1] = vertYPos;
-			verts[2].m_position[2] = kVertDepth;
 
-			verts[3].m_position[0] = vertXPos + ((i - 1) * vertXScale);
-			verts[3].m_position[1] = vertYPos;
-			verts[3].m_position[2] = kVertDepth;
+void AudioDisplayComponent::accumulateBeatHistory(int width, int height)
+{
+	if(m_numHistoryVertices == 0 || m_pHistoryStripMesh == nullptr || m_pTextureQuadMesh == nullptr || !m_pTextureShaderProgram->isLoaded())
+	{
+		m_hasAccumulatedHistory = false;
+		return;
+	}
 
-			for(int j = 0; j < 4; ++j)
+	// a new size, view or placement draws every earlier beat again, otherwise the accumulated beats are faded
+	// once for each beat captured since and only the beats that have just become earlier ones are drawn
+	bool isRebuild = !m_hasAccumulatedHistory
+		|| m_uploadedNewestHistoryBeatNumber < m_accumulatedNewestBeatNumber
+		|| m_uploadedViewStartRatio != m_accumulatedViewStartRatio
+		|| m_uploadedViewEndRatio != m_accumulatedViewEndRatio
+		|| m_uploadedHistoryDelaySamples != m_accumulatedDelaySamples
+		|| m_uploadedHistorySampleSign != m_accumulatedSampleSign;
+
+	for(int i = 0; i < 2; ++i)
+	{
+		OpenGLFrameBuffer& frameBuffer = m_historyFrameBuffers[i];
+		if(frameBuffer.getWidth() != width || frameBuffer.getHeight() != height)
+		{
+			if(!frameBuffer.initialise(m_openGLContext, width, height))
 			{
-				verts[j].m_colour[0] = colour[0];
-				verts[j].m_colour[1] = colour[1];
-				verts[j].m_colour[2] = colour[2];
-				verts[j].m_colour[3] = colour[3];
+				m_hasAccumulatedHistory = false;
+				return;
 			}
 
-			audioSource.m_pQuadMesh->setQuad(i, verts);
-
-			startSample = endSample;
-			endSample = sampleSign * sampleBuffer(pReadBuffer, numBeatSamples, viewStartBeatSample + ((i + 2) * viewScale) - nextDelaySamples);
+			isRebuild = true;
 		}
 	}
 
-	// render
-	audioSource.m_pQuadMesh->draw(m_pQuadMeshShaderProgram);
-	pRenderTarget->releaseAsRenderingTarget();
+	const int64 numNewBeats = m_uploadedNewestHistoryBeatNumber - m_accumulatedNewestBeatNumber;
+	if(!isRebuild && numNewBeats == 0)
+		return;
+
+	int firstDrawnLayer = 0;
+	while(!isRebuild && firstDrawnLayer < m_historyBeatNumbers.size() && m_historyBeatNumbers[firstDrawnLayer] < m_accumulatedNewestBeatNumber)
+		++firstDrawnLayer;
+
+	// the two frame buffers take turns, one is read while the other is drawn into
+	OpenGLFrameBuffer& target = m_historyFrameBuffers[1 - m_historyFrameBufferIndex];
+	target.makeCurrentAndClear();
+	glViewport(0, 0, width, height);
+
+	if(!isRebuild)
+	{
+		glBlendFunc(GL_ONE, GL_ONE);
+		drawHistoryTexture(m_historyFrameBuffers[m_historyFrameBufferIndex], powf(getHistoryFade(), (float)numNewBeats));
+	}
+
+	if(firstDrawnLayer < m_historyFirstVertices.size())
+	{
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+		m_pQuadMeshShaderProgram->useProgram();
+		setLayerColours();
+		m_pHistoryStripMesh->draw(m_pQuadMeshShaderProgram, m_historyFirstVertices[firstDrawnLayer], m_numHistoryVertices - 1);
+	}
 
-	// cache prev values
-	audioSource.m_prevCache.m_beatBufferPosition = nextBeatBufferPosition;
-	audioSource.m_prevCache.m_delaySamples = nextDelaySamples;
-	audioSource.m_prevCache.m_invertPhase = nextInvertPhase;
-	audioSource.m_prevCache.m_listenMode = nextListenMode;
+	target.releaseAsRenderingTarget();
+
+	m_historyFrameBufferIndex = 1 - m_historyFrameBufferIndex;
+	m_hasAccumulatedHistory = true;
+	m_accumulatedNewestBeatNumber = m_uploadedNewestHistoryBeatNumber;
+	m_accumulatedViewStartRatio = m_uploadedViewStartRatio;
+	m_accumulatedViewEndRatio = m_uploadedViewEndRatio;
+	m_accumulatedDelaySamples = m_uploadedHistoryDelaySamples;
+	m_accumulatedSampleSign = m_uploadedHistorySampleSign;
 }
 
 
-void AudioDisplayComponent::renderCombinedAudioSource(CombinedAudioSource& combinedSource, const std::array<float, 4>& colour)
+void AudioDisplayComponent::drawHistoryTexture(OpenGLFrameBuffer& frameBuffer, float fade)
 {
-	OpenGLFrameBuffer* pRenderTarget = OpenGLImageType::getFrameBufferFrom(combinedSource.m_image);
-	pRenderTarget->makeCurrentAndClear();
+	const GLuint quadIndex = (fade == 1.0f) ? 0 : 1;
+	if(quadIndex != 0)
+		m_pTextureQuadMesh->setQuad(quadIndex, getTextureQuad(fade));
+
+	m_pTextureShaderProgram->useProgram();
+	m_openGLContext.extensions.glUniform1i(m_textureUniform, 0);
+	m_openGLContext.extensions.glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, frameBuffer.getTextureID());
+
+	m_pTextureQuadMesh->draw(m_pTextureShaderProgram, quadIndex, quadIndex);
 
-	m_renderAudioSources.clear();
-	for(int i = 0; i < combinedSource.m_audioSources.size(); ++i)
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+
+std::array<AudioDisplayComponent::TextureVert, 4> AudioDisplayComponent::getTextureQuad(float fade)
+{
+	// covers the viewport, the accumulation texture is always the viewport's size
+	std::array<TextureVert, 4> verts = { {
+		{ { -1.0f, 1.0f }, { 0.0f, 1.0f }, fade },
+		{ { 1.0f, 1.0f }, { 1.0f, 1.0f }, fade },
+		{ { 1.0f, -1.0f }, { 1.0f, 0.0f }, fade },
+		{ { -1.0f, -1.0f }, { 0.0f, 0.0f }, fade } } };
+	return verts;
+}
+
+
+void AudioDisplayComponent::captureSnapshot()
+{
+	// drop extra remotes whose instance has gone away, the first stays as the editor's choice
+	for(int i = (int)m_remoteAudioSources.size() - 1; i > 0; --i)
+		if(m_remoteAudioSources[i].m_processor.get() == nullptr)
+			m_remoteAudioSources.erase(m_remoteAudioSources.begin() + i);
+
+	// submitting hands back whichever snapshot the producer was done with, so size it every time
+	const int numRemoteSources = (int)m_remoteAudioSources.size();
+	m_snapshot.m_beats.resize(1 + numRemoteSources);
+	m_snapshot.m_layerBeats.resize((int)E_Layer::FirstRemote + numRemoteSources);
+
+	// every layer reads its beats from the snapshot, beat 0 is local and the rest are remote
+	std::vector<std::vector<int>>& layerBeats = m_snapshot.m_layerBeats;
+	for(int i = 0; i < layerBeats.size(); ++i)
+		layerBeats[i].clear();
+
+	captureBeat(m_localAudioSource.m_processor.get(), m_snapshot.m_beats[0]);
+	layerBeats[(int)E_Layer::Local].push_back(0);
+
+	// the combined layer sums every source, but is only worth showing when there is something to combine with
+	layerBeats[(int)E_Layer::Combined].push_back(0);
+	bool hasRemoteSource = false;
+	for(int i = 0; i < numRemoteSources; ++i)
 	{
-		AudioSource* pAudioSource = combinedSource.m_audioSources[i];
-		if(pAudioSource && pAudioSource->m_processor.get() && pAudioSource->m_processor->getBeatBuffer() && pAudioSource->m_processor->getBeatBuffer()->getNumSamples() > 0)
+		KickFaceAudioProcessor* pRemoteProcessor = m_remoteAudioSources[i].m_processor.get();
+		captureBeat(pRemoteProcessor, m_snapshot.m_beats[1 + i]);
+		if(pRemoteProcessor)
 		{
-			RenderAudioSource renderSource;
-			renderSource.m_pAudioSource = pAudioSource;
-			renderSource.m_pBeatBuffer = pAudioSource->m_processor->getBeatBuffer();
-			renderSource.m_nextCache.m_beatBufferPosition = pAudioSource->m_processor->getBeatBufferPosition();
-			renderSource.m_nextCache.m_delaySamples = (float)pAudioSource->m_processor->getDelayValue().getValue();
-			renderSource.m_nextCache.m_invertPhase = (float)pAudioSource->m_processor->getInvertPhaseValue().getValue() > 0.5f;
-			renderSource.m_nextCache.m_listenMode = roundFloatToInt((float)pAudioSource->m_processor->getListenModeValue().getValue());
-			m_renderAudioSources.push_back(renderSource);
+			layerBeats[(int)E_Layer::FirstRemote + i].push_back(1 + i);
+			layerBeats[(int)E_Layer::Combined].push_back(1 + i);
+			hasRemoteSource = true;
 		}
 	}
 
-	if(m_renderAudioSources.size() == 0)
-		return;
+	if(!hasRemoteSource)
+		layerBeats[(int)E_Layer::Combined].clear();
 
-	// update mesh
-	const int numBeatSamples = m_renderAudioSources[0].m_pBeatBuffer->getNumSamples();
-	if(numBeatSamples > 0)
+	// earlier beats of the local instance, a slot is only copied again once it holds a new beat
+	KickFaceAudioProcessor* pLocalProcessor = m_localAudioSource.m_processor.get();
+	const int numHistorySlots = (m_isHistoryView && !m_isPhaseView && pLocalProcessor) ? pLocalProcessor->getBeatHistory().getNumSlots() : 0;
+	m_snapshot.m_historyBeats.resize(numHistorySlots);
+	m_snapshot.m_historyLayerStart = AUDIODISPLAY_HISTORY_COLOUR_START;
+	for(int i = 0; i < numHistorySlots; ++i)
 	{
-		const float sampleScale = (float)numBeatSamples / AUDIODISPLAY_NUM_QUADS;
+		WaveformProducer::Beat& beat = m_snapshot.m_historyBeats[i];
+		pLocalProcessor->getBeatHistory().readSlot(i, beat.m_beatNumber, beat.m_samples);
+		beat.m_delaySamples = m_snapshot.m_beats[0].m_delaySamples;
+		beat.m_sampleSign = m_snapshot.m_beats[0].m_sampleSign;
+		beat.m_sourceId = pLocalProcessor->getInstanceId();
+	}
 
-		int beatBufferChangeSampleStart = Math::positiveModulo(m_renderAudioSources[0].m_pAudioSource->m_prevCache.m_beatBufferPosition + m_renderAudioSources[0].m_nextCache.m_delaySamples - (int)ceilf(sampleScale), numBeatSamples);
-		int beatBufferChangeSampleEnd = Math::positiveModulo(m_renderAudioSources[0].m_nextCache.m_beatBufferPosition + m_renderAudioSources[0].m_nextCache.m_delaySamples + (int)ceilf(sampleScale), numBeatSamples);
-		for(int i = 1; i < m_renderAudioSources.size(); ++i)
-		{
-			beatBufferChangeSampleStart = jmin(beatBufferChangeSampleStart, Math::positiveModulo(m_renderAudioSources[i].m_pAudioSource->m_prevCache.m_beatBufferPosition + m_renderAudioSources[i].m_nextCache.m_delaySamples - (int)ceilf(sampleScale), numBeatSamples));
-			beatBufferChangeSampleEnd = jmax(beatBufferChangeSampleEnd, Math::positiveModulo(m_renderAudioSources[i].m_nextCache.m_beatBufferPosition + m_renderAudioSources[i].m_nextCache.m_delaySamples + (int)ceilf(sampleScale), numBeatSamples));
-		}
+	const float desktopScale = (float)m_openGLContext.getRenderingScale();
+	m_snapshot.m_viewStartRatio = m_viewStartRatio;
+	m_snapshot.m_viewEndRatio = m_viewEndRatio;
+	m_snapshot.m_edgeOffset = AUDIODISPLAY_EDGE_PIXELS * 2.0f / jmax(1.0f, desktopScale * getHeight());
+	m_snapshot.m_isPhaseView = m_isPhaseView;
+	m_snapshot.m_sampleRate = m_localAudioSource.m_processor.get() ? m_localAudioSource.m_processor->getSampleRate() : 0.0;
+}
 
-		const int viewStartBeatSample = (int)floorf(m_viewStartRatio * numBeatSamples);
-		const int viewEndBeatSample = (int)ceilf(m_viewEndRatio * numBeatSamples);
-		const float viewScale = (float)(viewEndBeatSample - viewStartBeatSample) / AUDIODISPLAY_NUM_QUADS;
 
-		int startQuad = 0;
-		int endQuad = AUDIODISPLAY_NUM_QUADS - 1;
+void AudioDisplayComponent::captureBeat(KickFaceAudioProcessor* pProcessor, WaveformProducer::Beat& beat)
+{
+	// copying reuses the beat's storage, so after the first few frames this doesn't allocate
+	AudioSampleBuffer* pBeatBuffer = pProcessor ? pProcessor->getBeatBuffer() : nullptr;
+	if(pBeatBuffer && pBeatBuffer->getNumSamples() > 0)
+	{
+		const float* pReadData = pBeatBuffer->getReadPointer(pProcessor->getListenLane());
+		beat.m_samples.assign(pReadData, pReadData + pBeatBuffer->getNumSamples());
+		beat.m_delaySamples = (float)pProcessor->getDelayValue().getValue();
+		beat.m_sampleSign = (float)pProcessor->getInvertPhaseValue().getValue() > 0.5f ? -1.0f : 1.0f;
+		beat.m_sourceId = pProcessor->getInstanceId();
+		beat.m_beatNumber = pProcessor->getBeatNumber();
+	}
+	else
+	{
+		beat.m_samples.clear();
+		beat.m_delaySamples = 0;
+		beat.m_sampleSign = 1.0f;
+		beat.m_sourceId = -1;
+		beat.m_beatNumber = -1;
+	}
+}
 
-		for(int i = 0; i < m_renderAudioSources.size(); ++i)
-		{
-			m_renderAudioSources[i].m_sampleSign = m_renderAudioSources[i].m_nextCache.m_invertPhase ? -1.0f : 1.0f;
-			m_renderAudioSources[i].m_pReadBuffer = m_renderAudioSources[i].m_pBeatBuffer->getReadPointer(0);
-		}
 
-		const float kVertDepth = 0.5f;
-		float vertXScale = 2.0f / AUDIODISPLAY_NUM_QUADS;
-		float vertXPos = -1.0f;
-		float vertYScale = 1.0f;
-		float vertYPos = 0.0f;
-		std::array<ColQuadVert, 4> verts;
+void AudioDisplayComponent::waveformFramePublished(double buildMilliseconds)
+{
+	// building is most of what a frame costs, so it's reported along with the next draw
+	addRenderCost(buildMilliseconds);
 
-		float startSample = m_renderAudioSources[0].m_sampleSign * sampleBuffer(m_renderAudioSources[0].m_pReadBuffer, numBeatSamples, viewStartBeatSample + (startQuad * viewScale) - m_renderAudioSources[0].m_nextCache.m_delaySamples);
-		float endSample = m_renderAudioSources[0].m_sampleSign * sampleBuffer(m_renderAudioSources[0].m_pReadBuffer, numBeatSamples, viewStartBeatSample + ((startQuad + 1) * viewScale) - m_renderAudioSources[0].m_nextCache.m_delaySamples);
-		for(int i = 1; i < m_renderAudioSources.size(); ++i)
-		{
-			startSample += m_renderAudioSources[i].m_sampleSign * sampleBuffer(m_renderAudioSources[i].m_pReadBuffer, numBeatSamples, viewStartBeatSample + (startQuad * viewScale) - m_renderAudioSources[i].m_nextCache.m_delaySamples);
-			endSample += m_renderAudioSources[i].m_sampleSign * sampleBuffer(m_renderAudioSources[i].m_pReadBuffer, numBeatSamples, viewStartBeatSample + ((startQuad + 1) * viewScale) - m_renderAudioSources[i].m_nextCache.m_delaySamples);
-		}
+	// triggering a repaint is safe from any thread, the software backend picks the frame up on its next paint
+	if(m_displayBackend == E_DisplayBackend::OpenGL)
+		m_openGLContext.triggerRepaint();
+}
 
-		for(int q = startQuad; q <= endQuad; ++q)
-		{
-			verts[0].m_position[0] = vertXPos + ((q - 1) * vertXScale);
-			verts[0].m_position[1] = jlimit(-1.0f, 1.0f, vertYPos + (startSample * vertYScale));
-			verts[0].m_position[2] = kVertDepth;
 
-			verts[1].m_position[0] = vertXPos + (q * vertXScale);
-			verts[1].m_position[1] = jlimit(-1.0f, 1.0f, vertYPos + (endSample * vertYScale));
-			verts[1].m_position[2] = kVertDepth;
+const std::array<float, 4>& AudioDisplayComponent::getLayerColour(int layerIndex)
+{
+	if(layerIndex == (int)E_Layer::Combined)
+		return gCombinedColour;
+	if(layerIndex == (int)E_Layer::Local)
+		return gLocalColour;
 
-			verts[2].m_position[0] = vertXPos + (q * vertXScale);
-			verts[2].m_position[1] = vertYPos;
-			verts[2].m_position[2] = kVertDepth;
+	const int remoteIndex = layerIndex - (int)E_Layer::FirstRemote;
+	return gRemoteColours[jlimit(0, AUDIODISPLAY_MAX_REMOTE_SOURCES - 1, remoteIndex)];
+}
 
-			verts[3].m_position[0] = vertXPos + ((q - 1) * vertXScale);
-			verts[3].m_position[1] = vertYPos;
-			verts[3].m_position[2] = kVertDepth;
 
-			for(int j = 0; j < 4; ++j)
-			{
-				verts[j].m_colour[0] = colour[0];
-				verts[j].m_colour[1] = colour[1];
-				verts[j].m_colour[2] = colour[2];
-				verts[j].m_colour[3] = colour[3];
-			}
+float AudioDisplayComponent::getHistoryAlpha(int age)
+{
+	return AUDIODISPLAY_HISTORY_ALPHA * powf(getHistoryFade(), (float)(age - 1));
+}
 
-			combinedSource.m_pQuadMesh->setQuad(q, verts);
 
-			startSample = endSample;
-			endSample = m_renderAudioSources[0].m_sampleSign * sampleBuffer(m_renderAudioSources[0].m_pReadBuffer, numBeatSamples, viewStartBeatSample + ((q + 2) * viewScale) - m_renderAudioSources[0].m_nextCache.m_delaySamples);
-			for(int i = 1; i < m_renderAudioSources.size(); ++i)
-				endSample += m_renderAudioSources[i].m_sampleSign * sampleBuffer(m_renderAudioSources[i].m_pReadBuffer, numBeatSamples, viewStartBeatSample + ((q + 2) * viewScale) - m_renderAudioSources[i].m_nextCache.m_delaySamples);
-		}
+float AudioDisplayComponent::getHistoryFade()
+{
+	// the oldest beat the history holds is drawn with the faintest alpha that still shows, a step older and it's gone
+	return powf(1.0f / (255.0f * AUDIODISPLAY_HISTORY_ALPHA), 1.0f / jmax(1, BEAT_HISTORY_SIZE - 1));
+}
+
+
+float AudioDisplayComponent::getTimeBarPosition(int barIndex, float viewStartRatio, float viewEndRatio, bool isPhaseView)
+{
+	// the phase view always spans its whole frequency range, so its bars mark fixed frequencies instead
+	if(isPhaseView)
+		return PhaseSpectrumAnalyser::getFrequencyPosition(gPhaseViewBarFrequencies[barIndex]);
+
+	return (0.25f * (barIndex + 1) - viewStartRatio) / (viewEndRatio - viewStartRatio);
+}
+
+
+void AudioDisplayComponent::setLayerColours()
+{
+	for(int i = 0; i < m_colourUniforms.size(); ++i)
+	{
+		// earlier beats take the local colour and fade with age
+		std::array<float, 4> colour = (i == AUDIODISPLAY_TIME_BAR_COLOUR) ? gTimeBarColour : (i >= AUDIODISPLAY_HISTORY_COLOUR_START) ? gLocalColour : getLayerColour(i);
+		if(i >= AUDIODISPLAY_HISTORY_COLOUR_START)
+			colour[3] = getHistoryAlpha(i - AUDIODISPLAY_HISTORY_COLOUR_START);
+
+		m_openGLContext.extensions.glUniform4f(m_colourUniforms[i], colour[0], colour[1], colour[2], colour[3]);
 	}
-	
-	// render
-	m_combinedAudioSource.m_pQuadMesh->draw(m_pQuadMeshShaderProgram);
-	pRenderTarget->releaseAsRenderingTarget();
 }
 
 
 void AudioDisplayComponent::openGLContextClosing()
 {
-	m_localAudioSource.m_pQuadMesh = nullptr;
-	m_remoteAudioSource.m_pQuadMesh = nullptr;
-	m_combinedAudioSource.m_pQuadMesh = nullptr;
-	m_localAudioSource.m_image = Image::null;
-	m_remoteAudioSource.m_image = Image::null;
-	m_combinedAudioSource.m_pQuadMesh = nullptr;
-	m_pQuadMesh = nullptr;
-	m_pQuadMeshShaderProgram = nullptr;
+	releaseOpenGL();
+	SharedRenderResources::removeContext(m_openGLContext.getRawContext());
 }
 
 
-void AudioDisplayComponent::paint(Graphics& g)
+void AudioDisplayComponent::triggerRender()
 {
+	// frames are only granted while showing, which catches a parent becoming visible without telling this
+	attachOpenGLContext();
+
+	// the opengl backend is repainted once the producer has published the frame
+	const double captureStartTime = Time::getMillisecondCounterHiRes();
+	captureSnapshot();
+	m_producer.submitSnapshot(m_snapshot);
+	addRenderCost(Time::getMillisecondCounterHiRes() - captureStartTime);
+
+	if(m_displayBackend == E_DisplayBackend::Software)
+		repaint();
 }
 
 
-void AudioDisplayComponent::resized() 
+bool AudioDisplayComponent::isRenderVisible() const
+{
+	return isShowing();
+}
+
+
+bool AudioDisplayComponent::hasRenderPriority() const
 {
-	m_resizeImages = true;
+	ComponentPeer* pPeer = getPeer();
+	return isMouseOver(true) || (pPeer != nullptr && pPeer->isFocused());
 }
 
 
-float AudioDisplayComponent::sampleBuffer(const float* pReadBuffer, int bufferSize, float samplePosition) const
+void AudioDisplayComponent::paint(Graphics& g)
 {
-	if(bufferSize > 0)
+	if(m_displayBackend != E_DisplayBackend::Software)
+		return;
+
+	const double renderStartTime = Time::getMillisecondCounterHiRes();
+
+	// rasterise at the physical resolution so the image maps one to one onto the screen
+	const float pixelScale = g.getInternalContext().getPhysicalPixelScaleFactor();
+	m_rasteriser.beginFrame(roundToInt(pixelScale * getWidth()), roundToInt(pixelScale * getHeight()), toColour(gBackgroundColour));
+
+	// curve points are laid out as the strip meshes of the OpenGL path
+	const float timeBarHalfWidth = 1.0f / getWidth();
+	const float curveSpacing = 2.0f / AUDIODISPLAY_NUM_QUADS;
+	const float curveStart = -1.0f - curveSpacing;
 	{
-		int sampleIndex = (int)floorf(samplePosition);
-		float sampleRatio = samplePosition - sampleIndex;
-		return (pReadBuffer[Math::positiveModulo(sampleIndex, bufferSize)] * (1.0f - sampleRatio))
-			+ (pReadBuffer[Math::positiveModulo(sampleIndex + 1, bufferSize)] * sampleRatio);
+		WaveformProducer::FrameReader reader(m_producer);
+		const WaveformProducer::Frame* pFrame = reader.getFrame();
+		const float viewStartRatio = pFrame ? pFrame->m_viewStartRatio : m_viewStartRatio;
+		const float viewEndRatio = pFrame ? pFrame->m_viewEndRatio : m_viewEndRatio;
+		const bool isFramePhaseView = pFrame ? pFrame->m_isPhaseView : m_isPhaseView;
+		for(int barIndex = 0; barIndex < AUDIODISPLAY_NUM_TIME_BARS; ++barIndex)
+			m_rasteriser.addTimeBar(getTimeBarPosition(barIndex, viewStartRatio, viewEndRatio, isFramePhaseView), timeBarHalfWidth, toColour(gTimeBarColour));
+
+		// the software path draws every earlier beat each frame, there are never more than the history holds
+		for(int i = 0; pFrame && i < pFrame->m_historyLayers.size(); ++i)
+		{
+			const WaveformProducer::HistoryLayer& layer = pFrame->m_historyLayers[i];
+			m_rasteriser.addWaveform(layer.m_curve.data(), (int)layer.m_curve.size(), curveStart, curveSpacing, toColour(gLocalColour).withMultipliedAlpha(getHistoryAlpha(layer.m_age)));
+		}
+
+		for(int i = 0; pFrame && i < pFrame->m_layers.size(); ++i)
+		{
+			const WaveformProducer::Layer& layer = pFrame->m_layers[i];
+			if(layer.m_isVisible)
+				m_rasteriser.addWaveform(layer.m_curve.data(), (int)layer.m_curve.size(), curveStart, curveSpacing, toColour(getLayerColour(i)));
+		}
 	}
 
-#if USE_LOGGING
-	Logger::writeToLog(String("AudioDisplayComponent::sampleBuffer - buffer size zero"));
-#endif
-	return 0.0f;
+	m_rasteriser.endFrame();
+
+	const Image& image = m_rasteriser.getImage();
+	g.drawImage(image, 0, 0, getWidth(), getHeight(), 0, 0, image.getWidth(), image.getHeight());
+
+	reportRenderTime(Time::getMillisecondCounterHiRes() - renderStartTime);
+}
+
+
+void AudioDisplayComponent::resized() 
+{
+}
+
+
+void AudioDisplayComponent::visibilityChanged()
+{
+	attachOpenGLContext();
+}
+
+
+void AudioDisplayComponent::parentHierarchyChanged()
+{
+	attachOpenGLContext();
 }
 
 
@@ -644,6 +905,77 @@ void AudioDisplayComponent::mouseWheelMove(const MouseEvent& event, const MouseW
 
 void AudioDisplayComponent::mouseDown(const MouseEvent& event)
 {
+	if(event.mods.isPopupMenu())
+	{
+		m_dragMode = E_DragMode::None;
+
+		PopupMenu menu;
+		menu.addItem(AUDIODISPLAY_MENU_OPENGL_ID, "OpenGL Renderer", true, m_displayBackend == E_DisplayBackend::OpenGL);
+		menu.addItem(AUDIODISPLAY_MENU_SOFTWARE_ID, "Software Renderer", true, m_displayBackend == E_DisplayBackend::Software);
+		menu.addItem(AUDIODISPLAY_MENU_PHASE_VIEW_ID, "Phase Difference View", true, m_isPhaseView);
+		menu.addItem(AUDIODISPLAY_MENU_HISTORY_VIEW_ID, "Show Earlier Beats", !m_isPhaseView, m_isHistoryView);
+
+		// the budget is shared by every display in the process, as a share of one core's time
+		PopupMenu renderBudgetMenu;
+		for(int i = 0; i < numElementsInArray(gRenderBudgetsMs); ++i)
+			renderBudgetMenu.addItem(AUDIODISPLAY_MENU_RENDER_BUDGET_ID_START + i, String(gRenderBudgetsMs[i] / 10) + "% Of A Core", true, roundToInt(RenderCoordinator::getRenderBudget()) == gRenderBudgetsMs[i]);
+
+		menu.addSubMenu("Display Budget", renderBudgetMenu);
+
+		// how the local instance fills its beat buffer
+		PopupMenu captureMenu;
+		KickFaceAudioProcessor* pLocalProcessor = m_localAudioSource.m_processor.get();
+		const int captureMode = pLocalProcessor ? roundFloatToInt((float)pLocalProcessor->getCaptureModeValue().getValue()) : -1;
+		captureMenu.addItem(AUDIODISPLAY_MENU_CAPTURE_ID_START + (int)E_CaptureMode::TempoGrid, "Every Beat Of The Host Tempo", pLocalProcessor != nullptr, captureMode == (int)E_CaptureMode::TempoGrid);
+		captureMenu.addItem(AUDIODISPLAY_MENU_CAPTURE_ID_START + (int)E_CaptureMode::TempoGridWindow, "Part Of Every Beat Of The Host Tempo", pLocalProcessor != nullptr, captureMode == (int)E_CaptureMode::TempoGridWindow);
+		captureMenu.addItem(AUDIODISPLAY_MENU_CAPTURE_ID_START + (int)E_CaptureMode::Onsets, "Around Kick Onsets In This Track", pLocalProcessor != nullptr, captureMode == (int)E_CaptureMode::Onsets);
+		captureMenu.addItem(AUDIODISPLAY_MENU_CAPTURE_ID_START + (int)E_CaptureMode::MidiNotes, "After Midi Note-Ons", pLocalProcessor != nullptr, captureMode == (int)E_CaptureMode::MidiNotes);
+		captureMenu.addItem(AUDIODISPLAY_MENU_CAPTURE_ID_START + (int)E_CaptureMode::FollowTriggers, "Along With Another Track's Captures", pLocalProcessor != nullptr, captureMode == (int)E_CaptureMode::FollowTriggers);
+
+		// every mode but the whole beat takes a window, starting the offset after its beat or trigger
+		PopupMenu captureLengthMenu;
+		const int captureLength = pLocalProcessor ? roundFloatToInt((float)pLocalProcessor->getCaptureLengthValue().getValue()) : -1;
+		for(int i = 0; i < numElementsInArray(gCaptureLengthsMs); ++i)
+			captureLengthMenu.addItem(AUDIODISPLAY_MENU_CAPTURE_LENGTH_ID_START + i, String(gCaptureLengthsMs[i]) + "ms", pLocalProcessor != nullptr, captureLength == gCaptureLengthsMs[i]);
+
+		PopupMenu captureOffsetMenu;
+		const int captureOffset = pLocalProcessor ? roundFloatToInt((float)pLocalProcessor->getCaptureOffsetValue().getValue()) : -1;
+		for(int i = 0; i < numElementsInArray(gCaptureOffsetsMs); ++i)
+			captureOffsetMenu.addItem(AUDIODISPLAY_MENU_CAPTURE_OFFSET_ID_START + i, String(gCaptureOffsetsMs[i]) + "ms", pLocalProcessor != nullptr, captureOffset == gCaptureOffsetsMs[i]);
+
+		captureMenu.addSeparator();
+		captureMenu.addSubMenu("Window Length", captureLengthMenu, captureMode != (int)E_CaptureMode::TempoGrid);
+		captureMenu.addSubMenu("Window Offset", captureOffsetMenu, captureMode != (int)E_CaptureMode::TempoGrid);
+		menu.addSubMenu("Capture", captureMenu);
+
+		// any other instance can be overlaid, the one chosen in the editor is always shown. items are numbered by
+		// their place in the list kept for the callback since instance ids keep growing as instances are created
+		PopupMenu compareMenu;
+		m_compareMenuProcessors.clear();
+		const std::vector<WeakReference<KickFaceAudioProcessor>>& processors = GlobalProcessorArray::getProcessors();
+		for(int i = 0; i < processors.size(); ++i)
+		{
+			KickFaceAudioProcessor* pProcessor = processors[i].get();
+			if(pProcessor && pProcessor != m_localAudioSource.m_processor.get())
+			{
+				const bool isPrimary = pProcessor == m_remoteAudioSources[0].m_processor.get();
+				const bool isShown = isRemoteAudioSource(pProcessor);
+				const bool canAdd = isShown || m_remoteAudioSources.size() < AUDIODISPLAY_MAX_REMOTE_SOURCES;
+				compareMenu.addItem(AUDIODISPLAY_MENU_REMOTE_ID_START + (int)m_compareMenuProcessors.size(),
+					pProcessor->getGivenName().length() ? pProcessor->getGivenName() : ".", !isPrimary && canAdd, isShown);
+				m_compareMenuProcessors.push_back(processors[i]);
+			}
+		}
+
+		menu.addSeparator();
+		menu.addSubMenu("Compare With", compareMenu, compareMenu.getNumItems() > 0);
+		menu.addItem(AUDIODISPLAY_MENU_ALIGN_ID, "Align Compared Instances", m_remoteAudioSources[0].m_processor.get() != nullptr || m_remoteAudioSources.size() > 1);
+		menu.addItem(AUDIODISPLAY_MENU_MATCH_LOW_END_ID, "Match Low End Phase", m_remoteAudioSources[0].m_processor.get() != nullptr);
+		menu.addItem(AUDIODISPLAY_MENU_CLEAR_LOW_END_ID, "Clear Low End Phase Match");
+		menu.showMenuAsync(PopupMenu::Options(), ModalCallbackFunction::forComponent(contextMenuCallback, this));
+		return;
+	}
+
 	m_dragMode = juce::ModifierKeys::getCurrentModifiers().isShiftDown() ? E_DragMode::Local : 
 		juce::ModifierKeys::getCurrentModifiers().isAltDown() ? E_DragMode::Remote : E_DragMode::View;
 	m_dragSamples = 0;
@@ -651,6 +983,55 @@ void AudioDisplayComponent::mouseDown(const MouseEvent& event)
 }
 
 
+void AudioDisplayComponent::contextMenuCallback(int result, AudioDisplayComponent* pComponent)
+{
+	if(result <= 0 || pComponent == nullptr)
+		return;
+
+	if(result >= AUDIODISPLAY_MENU_REMOTE_ID_START)
+	{
+		// the instance may have gone while the menu was open, which leaves a null reference
+		const int index = result - AUDIODISPLAY_MENU_REMOTE_ID_START;
+		if(index < pComponent->m_compareMenuProcessors.size())
+			pComponent->toggleRemoteAudioSource(pComponent->m_compareMenuProcessors[index].get());
+	}
+	else if(result == AUDIODISPLAY_MENU_ALIGN_ID)
+		pComponent->alignRemoteAudioSources();
+	else if(result == AUDIODISPLAY_MENU_MATCH_LOW_END_ID)
+		pComponent->matchLowEndPhase(true);
+	else if(result == AUDIODISPLAY_MENU_CLEAR_LOW_END_ID)
+		pComponent->matchLowEndPhase(false);
+	else if(result == AUDIODISPLAY_MENU_PHASE_VIEW_ID)
+		pComponent->setPhaseView(!pComponent->isPhaseView());
+	else if(result == AUDIODISPLAY_MENU_HISTORY_VIEW_ID)
+		pComponent->setHistoryView(!pComponent->isHistoryView());
+	else if(result >= AUDIODISPLAY_MENU_CAPTURE_ID_START && result < AUDIODISPLAY_MENU_CAPTURE_ID_START + (int)E_CaptureMode::Max)
+	{
+		KickFaceAudioProcessor* pProcessor = pComponent->m_localAudioSource.m_processor.get();
+		if(pProcessor)
+			pProcessor->getCaptureModeValue().setValue((float)(result - AUDIODISPLAY_MENU_CAPTURE_ID_START));
+	}
+	else if(result >= AUDIODISPLAY_MENU_CAPTURE_LENGTH_ID_START && result < AUDIODISPLAY_MENU_CAPTURE_LENGTH_ID_START + numElementsInArray(gCaptureLengthsMs))
+	{
+		KickFaceAudioProcessor* pProcessor = pComponent->m_localAudioSource.m_processor.get();
+		if(pProcessor)
+			pProcessor->getCaptureLengthValue().setValue((float)gCaptureLengthsMs[result - AUDIODISPLAY_MENU_CAPTURE_LENGTH_ID_START]);
+	}
+	else if(result >= AUDIODISPLAY_MENU_CAPTURE_OFFSET_ID_START && result < AUDIODISPLAY_MENU_CAPTURE_OFFSET_ID_START + numElementsInArray(gCaptureOffsetsMs))
+	{
+		KickFaceAudioProcessor* pProcessor = pComponent->m_localAudioSource.m_processor.get();
+		if(pProcessor)
+			pProcessor->getCaptureOffsetValue().setValue((float)gCaptureOffsetsMs[result - AUDIODISPLAY_MENU_CAPTURE_OFFSET_ID_START]);
+	}
+	else if(result >= AUDIODISPLAY_MENU_RENDER_BUDGET_ID_START && result < AUDIODISPLAY_MENU_RENDER_BUDGET_ID_START + numElementsInArray(gRenderBudgetsMs))
+		RenderCoordinator::setRenderBudget(gRenderBudgetsMs[result - AUDIODISPLAY_MENU_RENDER_BUDGET_ID_START]);
+	else if(result == AUDIODISPLAY_MENU_OPENGL_ID)
+		pComponent->setDisplayBackend(E_DisplayBackend::OpenGL);
+	else if(result == AUDIODISPLAY_MENU_SOFTWARE_ID)
+		pComponent->setDisplayBackend(E_DisplayBackend::Software);
+}
+
+
 void AudioDisplayComponent::mouseUp(const MouseEvent& event)
 {
 	m_dragMode = E_DragMode::None;
@@ -688,7 +1069,7 @@ void AudioDisplayComponent::mouseDrag(const MouseEvent& event)
 
 		case E_DragMode::Remote:
 			{
-				KickFaceAudioProcessor* pRemoteProcessor = m_remoteAudioSource.m_processor.get();
+				KickFaceAudioProcessor* pRemoteProcessor = m_remoteAudioSources[0].m_processor.get();
 				if(pRemoteProcessor)
 				{
 					int nextDragSamples = roundFloatToInt(dragDistanceRatio * pRemoteProcessor->getBeatBuffer()->getNumSamples());
@@ -1,68 +1,67 @@
 #pragma once
 
 
-#include "../JuceLibraryCode/JuceHeader.h"
+#include "JuceHeader.h"
 #include "Renderer/ShaderProgram.h"
 #include "Renderer/Mesh.h"
+#include "Renderer/SharedRenderResources.h"
+#include "Renderer/WaveformRasteriser.h"
+#include "RenderCoordinator.h"
+#include "WaveformBuilder.h"
+#include "WaveformProducer.h"
 #include <vector>
 
 
 class KickFaceAudioProcessor;
 
 
-class AudioDisplayComponent : public Component, private OpenGLRenderer
+class AudioDisplayComponent : public Component, private OpenGLRenderer, private RenderCoordinator::Client, private WaveformProducer::Listener
 {
 public:
+	enum class E_DisplayBackend
+	{
+		OpenGL,
+		Software
+	};
+
 	AudioDisplayComponent(KickFaceAudioProcessor& processor);
 	~AudioDisplayComponent();
 
 	void setRemoteAudioSource(KickFaceAudioProcessor* pProcessor);
+	void toggleRemoteAudioSource(KickFaceAudioProcessor* pProcessor);
+	bool isRemoteAudioSource(KickFaceAudioProcessor* pProcessor) const;
+	void alignRemoteAudioSources();
+	void matchLowEndPhase(bool shouldMatch);
+	void setDisplayBackend(E_DisplayBackend backend);
+	E_DisplayBackend getDisplayBackend() const;
+	// phase difference and coherence against the local beat from 20Hz to 500Hz instead of the waveforms
+	void setPhaseView(bool isPhaseView);
+	bool isPhaseView() const;
+	// earlier beats of the local instance drawn under the waveforms, fading with age
+	void setHistoryView(bool isHistoryView);
+	bool isHistoryView() const;
 
 private:
-	struct TexQuadVert
-	{
-		float m_position[3];
-		float m_texCoord[2];
-	};
-
-	struct ColQuadVert
-	{
-		float m_position[3];
-		float m_colour[4];
-	};
+	typedef WaveformBuilder::StripVertex WaveVert;
 
-	struct AudioSourceCache
+	struct TextureVert
 	{
-		int64 m_beatBufferPosition;
-		int m_delaySamples;
-		bool m_invertPhase;
-		int m_listenMode;
+		float m_position[2];
+		float m_texCoord[2];
+		float m_fade;
 	};
 
 	struct AudioSource
 	{
 		WeakReference<KickFaceAudioProcessor> m_processor;
-		ScopedPointer<DynamicQuadMesh<ColQuadVert>> m_pQuadMesh;
-		ScopedPointer<StaticMesh<TexQuadVert>> m_pTexQuad;
-		Image m_image;
-		AudioSourceCache m_prevCache;
-	};
-
-	struct CombinedAudioSource
-	{
-		Array<AudioSource*> m_audioSources;
-		ScopedPointer<DynamicQuadMesh<ColQuadVert>> m_pQuadMesh;
-		ScopedPointer<StaticMesh<TexQuadVert>> m_pTexQuad;
-		Image m_image;
 	};
 
-	struct RenderAudioSource
+	// layers in draw order, every remote source has its own layer after the local one
+	enum class E_Layer
 	{
-		AudioSource* m_pAudioSource;
-		AudioSampleBuffer* m_pBeatBuffer;
-		AudioSourceCache m_nextCache;
-		float m_sampleSign;
-		const float* m_pReadBuffer;
+		Combined,
+		Local,
+		FirstRemote
 	};
 
 	enum class E_DragMode
@@ -73,30 +72,68 @@ private:
 		Remote
 	};
 
+	void attachOpenGLContext();
 	void newOpenGLContextCreated() override;
 	void initialiseOpenGL();
+	void releaseOpenGL();
+	ShaderProgram* acquireShaderProgram(const char* pVertexSource, const char* pFragmentSource);
 	void renderOpenGL() override;
-	void renderAudioSource(AudioSource& audioSource, const std::array<float, 4>& colour);
-	void renderCombinedAudioSource(CombinedAudioSource& audioSource, const std::array<float, 4>& colour);
+	void uploadPublishedFrame();
+	void accumulateBeatHistory(int width, int height);
+	void drawHistoryTexture(OpenGLFrameBuffer& frameBuffer, float fade);
+	static std::array<TextureVert, 4> getTextureQuad(float fade);
+	void setLayerColours();
 	void openGLContextClosing() override;
 
+	void triggerRender() override;
+	bool isRenderVisible() const override;
+	bool hasRenderPriority() const override;
+
 	void paint(Graphics& g) override;
 	void resized() override;
+	void visibilityChanged() override;
+	void parentHierarchyChanged() override;
 
-	float sampleBuffer(const float* pReadBuffer, int bufferSize, float samplePosition) const;
+	void captureSnapshot();
+	static void captureBeat(KickFaceAudioProcessor* pProcessor, WaveformProducer::Beat& beat);
+	void waveformFramePublished(double buildMilliseconds) override;
+	static const std::array<float, 4>& getLayerColour(int layerIndex);
+	static float getHistoryAlpha(int age);
+	static float getHistoryFade();
+	static float getTimeBarPosition(int barIndex, float viewStartRatio, float viewEndRatio, bool isPhaseView);
 
 	void mouseWheelMove(const MouseEvent& event, const MouseWheelDetails& wheel) override;
 	void mouseDown(const MouseEvent& event) override;
+	static void contextMenuCallback(int result, AudioDisplayComponent* pComponent);
 	void mouseUp(const MouseEvent& event) override;
 	void mouseDrag(const MouseEvent& event) override;
 
 	OpenGLContext m_openGLContext;
-	ScopedPointer<ShaderProgram> m_pQuadMeshShaderProgram;
-	ScopedPointer<ShaderProgram> m_pTexQuadShaderProgram;
-	ScopedPointer<DynamicQuadMesh<ColQuadVert>> m_pQuadMesh;
+	void* m_pNativeSharedContext;
+	int m_sharedGroupId;
+	ShaderProgram* m_pQuadMeshShaderProgram;
+	std::vector<int> m_colourUniforms;
+	ScopedPointer<DynamicQuadMesh<WaveVert>> m_pQuadMesh;
+	ScopedPointer<DynamicStripMesh<WaveVert>> m_pStripMesh;
+	GLuint m_numStripVertices;
+	ShaderProgram* m_pTextureShaderProgram;
+	int m_textureUniform;
+	ScopedPointer<DynamicQuadMesh<TextureVert>> m_pTextureQuadMesh;
+	ScopedPointer<DynamicStripMesh<WaveVert>> m_pHistoryStripMesh;
+	std::vector<GLuint> m_historyFirstVertices;
+	std::vector<int64> m_historyBeatNumbers;
+	GLuint m_numHistoryVertices;
+	OpenGLFrameBuffer m_historyFrameBuffers[2];
+	int m_historyFrameBufferIndex;
+	bool m_hasAccumulatedHistory;
+	int64 m_accumulatedNewestBeatNumber;
+	float m_accumulatedViewStartRatio;
+	float m_accumulatedViewEndRatio;
+	int m_accumulatedDelaySamples;
+	float m_accumulatedSampleSign;
 	AudioSource m_localAudioSource;
-	AudioSource m_remoteAudioSource;
-	CombinedAudioSource m_combinedAudioSource;
+	std::vector<AudioSource> m_remoteAudioSources;
+	std::vector<WeakReference<KickFaceAudioProcessor>> m_compareMenuProcessors;
 
 	float m_viewStartRatio;
 	float m_viewEndRatio;
@@ -105,9 +142,20 @@ private:
 	int m_dragSamples;
 	float m_dragViewStart;
 
-	bool m_resizeImages;
-
-	std::vector<RenderAudioSource> m_renderAudioSources;
+	WaveformProducer m_producer;
+	WaveformProducer::Snapshot m_snapshot;
+	int64 m_uploadedFrameNumber;
+	float m_uploadedViewStartRatio;
+	float m_uploadedViewEndRatio;
+	bool m_uploadedIsPhaseView;
+	int64 m_uploadedNewestHistoryBeatNumber;
+	int m_uploadedHistoryDelaySamples;
+	float m_uploadedHistorySampleSign;
+
+	E_DisplayBackend m_displayBackend;
+	bool m_isPhaseView;
+	bool m_isHistoryView;
+	WaveformRasteriser m_rasteriser;
 
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioDisplayComponent)
 };
\ No newline at end of file
@@ -0,0 +1,160 @@
+#include "BeatHistory.h"
+#include "Math.h"
+
+
+
+BeatHistory::BeatHistory()
+	: m_maxSlotSamples(0)
+	, m_useHalfFloats(false)
+	, m_nextSlot(0)
+{
+}
+
+
+BeatHistory::~BeatHistory()
+{
+}
+
+
+void BeatHistory::prepare(int numSlots, int maxSlotSamples, bool useHalfFloats)
+{
+	// readers hold the lock while they copy, so storage never moves under them
+	const ScopedLock lock(m_storageLock);
+
+	numSlots = jmax(numSlots, 0);
+	m_maxSlotSamples = jmax(maxSlotSamples, 0);
+	m_useHalfFloats = useHalfFloats;
+	m_floatSamples.resize(m_useHalfFloats ? 0 : numSlots * m_maxSlotSamples);
+	m_halfSamples.resize(m_useHalfFloats ? numSlots * m_maxSlotSamples : 0);
+
+	while(m_slots.size() < numSlots)
+		m_slots.add(new Slot());
+	m_slots.removeLast(m_slots.size() - numSlots);
+
+	for(int i = 0; i < m_slots.size(); ++i)
+	{
+		m_slots[i]->m_sequence.set(0);
+		m_slots[i]->m_beatNumber.set(-1);
+		m_slots[i]->m_numSamples.set(0);
+		m_slots[i]->m_lane.set(0);
+	}
+
+	m_nextSlot = 0;
+}
+
+
+void BeatHistory::push(const float* pSamples, int numSamples, int64 beatNumber, int lane)
+{
+	if(m_slots.size() == 0 || pSamples == nullptr)
+		return;
+
+	Slot& slot = *m_slots.getUnchecked(m_nextSlot);
+	numSamples = jlimit(0, m_maxSlotSamples, numSamples);
+	const int slotOffset = m_nextSlot * m_maxSlotSamples;
+
+	slot.m_sequence += 1;
+	if(m_useHalfFloats)
+	{
+		uint16* pHalfSamples = m_halfSamples.data() + slotOffset;
+		for(int i = 0; i < numSamples; ++i)
+			pHalfSamples[i] = Math::floatToHalf(pSamples[i]);
+	}
+	else
+	{
+		FloatVectorOperations::copy(m_floatSamples.data() + slotOffset, pSamples, numSamples);
+	}
+
+	slot.m_beatNumber.set(beatNumber);
+	slot.m_numSamples.set(numSamples);
+	slot.m_lane.set(lane);
+	slot.m_sequence += 1;
+
+	m_nextSlot = (m_nextSlot + 1) % m_slots.size();
+}
+
+
+int BeatHistory::getNumSlots() const
+{
+	const ScopedLock lock(m_storageLock);
+	return m_slots.size();
+}
+
+
+int BeatHistory::getNewestSlot() const
+{
+	const ScopedLock lock(m_storageLock);
+	int newestSlot = -1;
+	int64 newestBeatNumber = -1;
+	for(int i = 0; i < m_slots.size(); ++i)
+	{
+		const int64 beatNumber = m_slots.getUnchecked(i)->m_beatNumber.get();
+		if(beatNumber > newestBeatNumber)
+		{
+			newestSlot = i;
+			newestBeatNumber = beatNumber;
+		}
+	}
+
+	return newestSlot;
+}
+
+
+bool BeatHistory::readSlot(int slotIndex, int64& beatNumber, std::vector<float>& samples, int* pLane) const
+{
+	const ScopedLock lock(m_storageLock);
+	if(slotIndex < 0 || slotIndex >= m_slots.size())
+	{
+		beatNumber = -1;
+		samples.clear();
+		return false;
+	}
+
+	// a slot being written keeps whatever the caller already has
+	const Slot& slot = *m_slots.getUnchecked(slotIndex);
+	const int64 sequence = slot.m_sequence.get();
+	if(sequence & 1)
+		return false;
+
+	const int64 slotBeatNumber = slot.m_beatNumber.get();
+	const int numSamples = slot.m_numSamples.get();
+	const int lane = slot.m_lane.get();
+	if(slotBeatNumber < 0 || numSamples <= 0)
+	{
+		beatNumber = -1;
+		samples.clear();
+		return false;
+	}
+
+	if(slotBeatNumber == beatNumber && (int)samples.size() == numSamples && slot.m_sequence.get() == sequence)
+	{
+		if(pLane)
+			*pLane = lane;
+		return true;
+	}
+
+	samples.resize(numSamples);
+	const int slotOffset = slotIndex * m_maxSlotSamples;
+	if(m_useHalfFloats)
+	{
+		const uint16* pHalfSamples = m_halfSamples.data() + slotOffset;
+		for(int i = 0; i < numSamples; ++i)
+			samples[i] = Math::halfToFloat(pHalfSamples[i]);
+	}
+	else
+	{
+		memcpy(samples.data(), m_floatSamples.data() + slotOffset, numSamples * sizeof(float));
+	}
+
+	// a beat pushed into the slot while it was copied leaves nothing worth keeping
+	if(slot.m_sequence.get() != sequence)
+	{
+		beatNumber = -1;
+		samples.clear();
+		return false;
+	}
+
+	beatNumber = slotBeatNumber;
+	if(pLane)
+		*pLane = lane;
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+
+#include "JuceHeader.h"
+#include <vector>
+
+
+// Keeps the last few captured beats so the display can show how they vary. The audio thread pushes each beat
+// into the next slot of a fixed ring without locking or allocating, and readers copy slots out on their own
+// thread. Every slot carries a sequence count that is odd while it's being written, so a reader that raced
+// the writer can tell and try again later rather than keep a torn beat. Slots can hold half floats, halving
+// the memory at a precision well beyond what the display shows. Beats longer than a slot are cut short.
+class BeatHistory
+{
+public:
+	BeatHistory();
+	~BeatHistory();
+
+	// not to be called while the audio thread could be pushing
+	void prepare(int numSlots, int maxSlotSamples, bool useHalfFloats);
+
+	// called on the audio thread, the lane is whichever listen lane the beat was taken from
+	void push(const float* pSamples, int numSamples, int64 beatNumber, int lane);
+
+	int getNumSlots() const;
+	// the slot holding the highest beat number, -1 while the history is empty
+	int getNewestSlot() const;
+	// the beat number is what the caller already holds for the slot and is updated with what it holds now, the
+	// samples are only copied when the two differ. False if the slot is empty or was written while being read.
+	bool readSlot(int slotIndex, int64& beatNumber, std::vector<float>& samples, int* pLane = nullptr) const;
+
+private:
+	struct Slot
+	{
+		Atomic<int64> m_sequence;
+		Atomic<int64> m_beatNumber;
+		Atomic<int> m_numSamples;
+		Atomic<int> m_lane;
+	};
+
+	CriticalSection m_storageLock;
+	OwnedArray<Slot> m_slots;
+	int m_maxSlotSamples;
+	bool m_useHalfFloats;
+	std::vector<float> m_floatSamples;
+	std::vector<uint16> m_halfSamples;
+	int m_nextSlot;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BeatHistory)
+};
\ No newline at end of file
@@ -1,10 +1,88 @@
 #pragma once
 
 
+#include <cstdint>
+#include <cstring>
+
+
 namespace Math
 {
 	inline int positiveModulo(int val, int mod)
 	{
 		return (val % mod + mod) % mod;
 	}
+
+
+	// IEEE half precision, rounded to nearest even with subnormals kept so quiet tails survive
+	inline uint16_t floatToHalf(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		const uint32_t sign = (bits >> 16) & 0x8000;
+		const int floatExponent = (int)((bits >> 23) & 0xff);
+		const int exponent = floatExponent - 127 + 15;
+		uint32_t mantissa = bits & 0x7fffff;
+
+		if(floatExponent == 0xff)
+			return (uint16_t)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+		if(exponent >= 31)
+			return (uint16_t)(sign | 0x7c00);
+
+		if(exponent <= 0)
+		{
+			if(exponent < -10)
+				return (uint16_t)sign;
+
+			mantissa |= 0x800000;
+			const int shift = 14 - exponent;
+			uint32_t half = mantissa >> shift;
+			const uint32_t remainder = mantissa & ((1u << shift) - 1);
+			const uint32_t halfway = 1u << (shift - 1);
+			if(remainder > halfway || (remainder == halfway && (half & 1)))
+				++half;
+			return (uint16_t)(sign | half);
+		}
+
+		// rounding up can carry into the exponent, which is still the right answer
+		uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+		const uint32_t remainder = mantissa & 0x1fff;
+		if(remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+			++half;
+		return (uint16_t)(sign | half);
+	}
+
+
+	inline float halfToFloat(uint16_t half)
+	{
+		const uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+		const int exponent = (half >> 10) & 0x1f;
+		uint32_t mantissa = half & 0x3ff;
+		uint32_t bits = sign;
+
+		if(exponent == 0 && mantissa != 0)
+		{
+			// subnormals are normalised, every shift lowers the exponent by one
+			int shift = -1;
+			do
+			{
+				++shift;
+				mantissa <<= 1;
+			}
+			while((mantissa & 0x400) == 0);
+
+			bits |= ((uint32_t)(127 - 15 - shift) << 23) | ((mantissa & 0x3ff) << 13);
+		}
+		else if(exponent == 31)
+		{
+			bits |= 0x7f800000 | (mantissa << 13);
+		}
+		else if(exponent != 0)
+		{
+			bits |= ((uint32_t)(exponent - 15 + 127) << 23) | (mantissa << 13);
+		}
+
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,182 @@
+#include "OnsetDetector.h"
+
+
+#define ONSETDETECTOR_USE_SSE2 JUCE_INTEL
+#define ONSETDETECTOR_MIN_DECIMATED_HZ 2000.0
+#define ONSETDETECTOR_CUTOFF_HZ 150.0
+#define ONSETDETECTOR_FAST_SECONDS 0.004
+#define ONSETDETECTOR_SLOW_SECONDS 0.25
+#define ONSETDETECTOR_HOLD_SECONDS 0.08
+#define ONSETDETECTOR_TRIGGER_RATIO 4.0f
+#define ONSETDETECTOR_REARM_RATIO 1.5f
+#define ONSETDETECTOR_MIN_POWER 1.0e-6f
+
+#if ONSETDETECTOR_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+
+
+OnsetDetector::OnsetDetector()
+	: m_decimationFactor(1)
+	, m_fastCoefficient(0.0f)
+	, m_slowCoefficient(0.0f)
+	, m_numHoldSamples(0)
+{
+	for(int i = 0; i < 3; ++i)
+		m_numerator[i] = m_denominator[i] = 0.0;
+
+	reset();
+}
+
+
+OnsetDetector::~OnsetDetector()
+{
+}
+
+
+void OnsetDetector::prepare(double sampleRate)
+{
+	// the largest power of two that keeps the decimated rate above a couple of kHz
+	m_decimationFactor = 1;
+	while(sampleRate / (2 * m_decimationFactor) >= ONSETDETECTOR_MIN_DECIMATED_HZ)
+		m_decimationFactor *= 2;
+
+	const double decimatedRate = jmax(1.0, sampleRate / m_decimationFactor);
+	const double omega = 2.0 * double_Pi * jmin(ONSETDETECTOR_CUTOFF_HZ, 0.45 * decimatedRate) / decimatedRate;
+	const double alpha = sin(omega) / (2.0 * sqrt(0.5));
+	const double cosOmega = cos(omega);
+	const double a0 = 1.0 + alpha;
+	m_numerator[0] = m_numerator[2] = 0.5 * (1.0 - cosOmega) / a0;
+	m_numerator[1] = (1.0 - cosOmega) / a0;
+	m_denominator[0] = 1.0;
+	m_denominator[1] = -2.0 * cosOmega / a0;
+	m_denominator[2] = (1.0 - alpha) / a0;
+
+	m_fastCoefficient = (float)(1.0 - exp(-1.0 / (ONSETDETECTOR_FAST_SECONDS * decimatedRate)));
+	m_slowCoefficient = (float)(1.0 - exp(-1.0 / (ONSETDETECTOR_SLOW_SECONDS * decimatedRate)));
+	m_numHoldSamples = roundDoubleToInt(ONSETDETECTOR_HOLD_SECONDS * decimatedRate);
+
+	reset();
+}
+
+
+void OnsetDetector::reset()
+{
+	m_groupPosition = 0;
+	m_groupSum = 0.0f;
+	m_filterState[0] = m_filterState[1] = 0.0;
+	m_fastEnvelope = 0.0f;
+	m_slowEnvelope = 0.0f;
+	m_logFastEnvelope = logf(ONSETDETECTOR_MIN_POWER);
+	m_isArmed = true;
+	m_holdCountdown = 0;
+}
+
+
+int OnsetDetector::process(const float* pSamples, int numSamples, float* pNovelty, int* pNumNoveltyValues)
+{
+	// groups carry on across blocks, so a block can start or end part way through one
+	int onsetSample = -1;
+	int numNoveltyValues = 0;
+	int position = 0;
+	while(position < numSamples)
+	{
+		const int numGroupSamples = jmin(m_decimationFactor - m_groupPosition, numSamples - position);
+		m_groupSum += sumSamples(pSamples + position, numGroupSamples);
+		m_groupPosition += numGroupSamples;
+		position += numGroupSamples;
+
+		if(m_groupPosition == m_decimationFactor)
+		{
+			float novelty = 0.0f;
+			const bool isOnset = processDecimatedSample(m_groupSum / (float)m_decimationFactor, novelty);
+			if(isOnset && onsetSample < 0)
+				onsetSample = position - 1;
+			if(pNovelty)
+				pNovelty[numNoveltyValues++] = novelty;
+
+			m_groupPosition = 0;
+			m_groupSum = 0.0f;
+		}
+	}
+
+	if(pNumNoveltyValues)
+		*pNumNoveltyValues = numNoveltyValues;
+
+	return onsetSample;
+}
+
+
+int OnsetDetector::getDecimationFactor() const
+{
+	return m_decimationFactor;
+}
+
+
+bool OnsetDetector::processDecimatedSample(float sample, float& novelty)
+{
+	const double output = m_numerator[0] * sample + m_filterState[0];
+	m_filterState[0] = m_numerator[1] * sample - m_denominator[1] * output + m_filterState[1];
+	m_filterState[1] = m_numerator[2] * sample - m_denominator[2] * output;
+
+	// the slow envelope is the level the hits stand out from, so the threshold follows the material
+	const float power = (float)(output * output);
+	m_fastEnvelope += m_fastCoefficient * (power - m_fastEnvelope);
+	m_slowEnvelope += m_slowCoefficient * (power - m_slowEnvelope);
+
+	// only rises count, in log power so quiet and loud hits stand out the same
+	const float logFastEnvelope = logf(m_fastEnvelope + ONSETDETECTOR_MIN_POWER);
+	novelty = jmax(0.0f, logFastEnvelope - m_logFastEnvelope);
+	m_logFastEnvelope = logFastEnvelope;
+
+	if(m_holdCountdown > 0)
+	{
+		--m_holdCountdown;
+		return false;
+	}
+
+	if(!m_isArmed)
+	{
+		m_isArmed = m_fastEnvelope < ONSETDETECTOR_REARM_RATIO * m_slowEnvelope;
+		return false;
+	}
+
+	if(m_fastEnvelope > ONSETDETECTOR_MIN_POWER && m_fastEnvelope > ONSETDETECTOR_TRIGGER_RATIO * m_slowEnvelope)
+	{
+		m_isArmed = false;
+		m_holdCountdown = m_numHoldSamples;
+		return true;
+	}
+
+	return false;
+}
+
+
+float OnsetDetector::sumSamples(const float* pSamples, int numSamples)
+{
+	int i = 0;
+	float sum = 0.0f;
+
+#if ONSETDETECTOR_USE_SSE2
+	if(numSamples >= 8)
+	{
+		__m128 sum0 = _mm_setzero_ps();
+		__m128 sum1 = _mm_setzero_ps();
+		for(; i + 8 <= numSamples; i += 8)
+		{
+			sum0 = _mm_add_ps(sum0, _mm_loadu_ps(pSamples + i));
+			sum1 = _mm_add_ps(sum1, _mm_loadu_ps(pSamples + i + 4));
+		}
+
+		float lanes[4];
+		_mm_storeu_ps(lanes, _mm_add_ps(sum0, sum1));
+		sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	}
+#endif
+
+	for(; i < numSamples; ++i)
+		sum += pSamples[i];
+
+	return sum;
+}
\ No newline at end of file
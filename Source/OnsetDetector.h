@@ -0,0 +1,51 @@
+#pragma once
+
+
+#include "JuceHeader.h"
+
+
+// Finds kick onsets in a mono signal cheaply enough to run on every block. The signal is averaged down to
+// a few kHz in power of two groups, which is a handful of vector adds per group, and everything after that
+// runs at the decimated rate: a low pass keeps the kick band, and a fast and a slow envelope of its power
+// follow the hits and the level around them. An onset is where the fast envelope jumps well above the slow
+// one, after which the detector waits for the hit to die down before it can trigger again. The rise of the
+// fast envelope in log power can be written out too, once per decimated sample, for tempo tracking.
+class OnsetDetector
+{
+public:
+	OnsetDetector();
+	~OnsetDetector();
+
+	void prepare(double sampleRate);
+	void reset();
+
+	// the sample in the block the first onset was found at, or -1. Onsets are found at the end of the group
+	// they fall in and a little after the hit starts, so captures should start somewhat before them. Novelty
+	// needs room for numSamples / getDecimationFactor() + 1 values.
+	int process(const float* pSamples, int numSamples, float* pNovelty = nullptr, int* pNumNoveltyValues = nullptr);
+
+	int getDecimationFactor() const;
+
+private:
+	bool processDecimatedSample(float sample, float& novelty);
+	static float sumSamples(const float* pSamples, int numSamples);
+
+	int m_decimationFactor;
+	int m_groupPosition;
+	float m_groupSum;
+
+	double m_numerator[3];
+	double m_denominator[3];
+	double m_filterState[2];
+
+	float m_fastCoefficient;
+	float m_slowCoefficient;
+	float m_fastEnvelope;
+	float m_slowEnvelope;
+	float m_logFastEnvelope;
+	bool m_isArmed;
+	int m_numHoldSamples;
+	int m_holdCountdown;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OnsetDetector)
+};
\ No newline at end of file
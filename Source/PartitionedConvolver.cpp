@@ -0,0 +1,203 @@
+#include "PartitionedConvolver.h"
+
+
+#define PARTITIONEDCONVOLVER_FADE_SECONDS 0.02
+
+
+
+PartitionedConvolver::PartitionedConvolver()
+	: m_numTaps(0)
+	, m_blockSize(0)
+	, m_fftSize(0)
+	, m_numPartitions(0)
+	, m_numFadeSamples(0)
+	, m_hasPendingFilter(false)
+	, m_delayLineHead(0)
+	, m_blockPosition(0)
+	, m_fadePosition(0)
+{
+}
+
+
+PartitionedConvolver::~PartitionedConvolver()
+{
+}
+
+
+void PartitionedConvolver::prepare(int numTaps, int blockSize, double sampleRate)
+{
+	const ScopedLock lock(m_filterLock);
+
+	// the FFT covers two blocks, the last output block of the circular convolution is the linear one
+	int order = 1;
+	while((1 << order) < 2 * blockSize)
+		++order;
+
+	m_numTaps = numTaps;
+	m_blockSize = (1 << order) / 2;
+	m_fftSize = 1 << order;
+	m_numPartitions = jmax(1, (numTaps + m_blockSize - 1) / m_blockSize);
+	m_numFadeSamples = jmax(1, roundDoubleToInt(sampleRate * PARTITIONEDCONVOLVER_FADE_SECONDS));
+	m_pForwardFFT = new FFT(order, false);
+	m_pInverseFFT = new FFT(order, true);
+
+	const FFT::Complex zero = { 0.0f, 0.0f };
+	const int numFilterBins = m_numPartitions * m_fftSize;
+	m_previousFilter.assign(numFilterBins, zero);
+	m_pendingFilter.assign(numFilterBins, zero);
+	m_hasPendingFilter = false;
+
+	std::vector<float> impulse(m_numTaps, 0.0f);
+	impulse[m_numTaps / 2] = 1.0f;
+	buildFilter(impulse.data(), m_numTaps, m_activeFilter);
+
+	m_inputFrame.assign(m_fftSize, zero);
+	m_delayLine.assign(numFilterBins, zero);
+	m_delayLineHead = 0;
+	m_spectrum.assign(m_fftSize, zero);
+	m_outputFrame.assign(m_fftSize, zero);
+	m_previousOutputFrame.assign(m_fftSize, zero);
+	m_blockPosition = 0;
+	m_fadePosition = m_numFadeSamples;
+}
+
+
+int PartitionedConvolver::getNumTaps() const
+{
+	return m_numTaps;
+}
+
+
+int PartitionedConvolver::getLatencySamples() const
+{
+	return m_blockSize + m_numTaps / 2;
+}
+
+
+void PartitionedConvolver::buildFilter(const float* pImpulse, int numImpulseSamples, std::vector<FFT::Complex>& spectra)
+{
+	// the lock holds the layout still, the audio thread only tries it so at worst a swap waits a block
+	const ScopedLock lock(m_filterLock);
+
+	// the inverse transform isn't normalised, so the scale is folded into the filter
+	const FFT::Complex zero = { 0.0f, 0.0f };
+	spectra.assign(m_numPartitions * m_fftSize, zero);
+	if(m_fftSize <= 0)
+		return;
+
+	const float scale = 1.0f / (float)m_fftSize;
+	std::vector<FFT::Complex> partition(m_fftSize, zero);
+	for(int p = 0; p < m_numPartitions; ++p)
+	{
+		const int partitionStart = p * m_blockSize;
+		for(int i = 0; i < m_blockSize; ++i)
+		{
+			const int impulseIndex = partitionStart + i;
+			partition[i].r = (impulseIndex < jmin(numImpulseSamples, m_numTaps)) ? pImpulse[impulseIndex] * scale : 0.0f;
+		}
+
+		m_pForwardFFT->perform(partition.data(), spectra.data() + p * m_fftSize);
+	}
+}
+
+
+void PartitionedConvolver::submitFilter(std::vector<FFT::Complex>& spectra)
+{
+	const ScopedLock lock(m_filterLock);
+	if(spectra.size() != m_pendingFilter.size())
+		return;
+
+	std::swap(m_pendingFilter, spectra);
+	m_hasPendingFilter = true;
+}
+
+
+void PartitionedConvolver::process(float* pLeft, float* pRight, int numSamples)
+{
+	if(m_blockSize <= 0)
+		return;
+
+	// the right channel rides in the imaginary part, a real filter keeps the two apart
+	for(int i = 0; i < numSamples; ++i)
+	{
+		FFT::Complex& input = m_inputFrame[m_blockSize + m_blockPosition];
+		input.r = pLeft[i];
+		input.i = pRight ? pRight[i] : 0.0f;
+
+		const FFT::Complex& output = m_outputFrame[m_blockSize + m_blockPosition];
+		if(m_fadePosition < m_numFadeSamples)
+		{
+			const FFT::Complex& previousOutput = m_previousOutputFrame[m_blockSize + m_blockPosition];
+			const float fade = (float)m_fadePosition / (float)m_numFadeSamples;
+			pLeft[i] = previousOutput.r + fade * (output.r - previousOutput.r);
+			if(pRight)
+				pRight[i] = previousOutput.i + fade * (output.i - previousOutput.i);
+			++m_fadePosition;
+		}
+		else
+		{
+			pLeft[i] = output.r;
+			if(pRight)
+				pRight[i] = output.i;
+		}
+
+		if(++m_blockPosition == m_blockSize)
+		{
+			processBlock();
+			m_blockPosition = 0;
+		}
+	}
+}
+
+
+void PartitionedConvolver::processBlock()
+{
+	// a new filter only starts once the last crossfade has finished
+	if(m_fadePosition >= m_numFadeSamples)
+		swapInPendingFilter();
+
+	m_delayLineHead = (m_delayLineHead + 1) % m_numPartitions;
+	m_pForwardFFT->perform(m_inputFrame.data(), m_delayLine.data() + m_delayLineHead * m_fftSize);
+	memmove(m_inputFrame.data(), m_inputFrame.data() + m_blockSize, m_blockSize * sizeof(FFT::Complex));
+
+	accumulateSpectra(m_activeFilter, m_spectrum.data());
+	m_pInverseFFT->perform(m_spectrum.data(), m_outputFrame.data());
+
+	if(m_fadePosition < m_numFadeSamples)
+	{
+		accumulateSpectra(m_previousFilter, m_spectrum.data());
+		m_pInverseFFT->perform(m_spectrum.data(), m_previousOutputFrame.data());
+	}
+}
+
+
+void PartitionedConvolver::accumulateSpectra(const std::vector<FFT::Complex>& filterSpectra, FFT::Complex* pOutput) const
+{
+	// partition p of the filter meets the block transformed p blocks ago
+	memset(pOutput, 0, m_fftSize * sizeof(FFT::Complex));
+	for(int p = 0; p < m_numPartitions; ++p)
+	{
+		const int delayLineIndex = (m_delayLineHead - p + m_numPartitions) % m_numPartitions;
+		const FFT::Complex* pInput = m_delayLine.data() + delayLineIndex * m_fftSize;
+		const FFT::Complex* pFilter = filterSpectra.data() + p * m_fftSize;
+		for(int bin = 0; bin < m_fftSize; ++bin)
+		{
+			pOutput[bin].r += pInput[bin].r * pFilter[bin].r - pInput[bin].i * pFilter[bin].i;
+			pOutput[bin].i += pInput[bin].r * pFilter[bin].i + pInput[bin].i * pFilter[bin].r;
+		}
+	}
+}
+
+
+void PartitionedConvolver::swapInPendingFilter()
+{
+	// the swaps only exchange buffers, and the worker is never waited on
+	const ScopedTryLock lock(m_filterLock);
+	if(!lock.isLocked() || !m_hasPendingFilter)
+		return;
+
+	std::swap(m_previousFilter, m_activeFilter);
+	std::swap(m_activeFilter, m_pendingFilter);
+	m_hasPendingFilter = false;
+	m_fadePosition = 0;
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+
+#include "JuceHeader.h"
+#include <vector>
+
+
+// Convolves a stereo signal with one FIR filter using uniformly partitioned overlap-save. The filter is split
+// into partitions of the block size, every block of input is transformed once into a frequency domain delay
+// line and each output block is the sum of that line multiplied by the partition spectra. Both channels go
+// through one complex FFT as its real and imaginary parts, which works because the filter is real.
+//
+// Everything the audio thread touches is allocated in prepare. Filters are built into spectra on any other
+// thread and submitted, the audio thread swaps them in between blocks when it can take the lock without
+// waiting and crossfades from the old filter. Filters are expected to be centred on numTaps / 2 like a linear
+// phase filter, so the latency is that plus one block. Benchmarks/Source/Main.cpp times it from 64 to 4096 taps.
+class PartitionedConvolver
+{
+public:
+	PartitionedConvolver();
+	~PartitionedConvolver();
+
+	// resets to a filter that only delays by numTaps / 2, so output matches the input delayed by that and a block
+	void prepare(int numTaps, int blockSize, double sampleRate);
+	int getNumTaps() const;
+	int getLatencySamples() const;
+
+	// called on any thread, the spectra are sized for the layout prepare last set up
+	void buildFilter(const float* pImpulse, int numImpulseSamples, std::vector<FFT::Complex>& spectra);
+	// swaps the spectra with a spent set, filters built for an earlier layout are dropped
+	void submitFilter(std::vector<FFT::Complex>& spectra);
+
+	// processes in place, pRight can be null for a mono signal
+	void process(float* pLeft, float* pRight, int numSamples);
+
+private:
+	void processBlock();
+	void accumulateSpectra(const std::vector<FFT::Complex>& filterSpectra, FFT::Complex* pOutput) const;
+	void swapInPendingFilter();
+
+	int m_numTaps;
+	int m_blockSize;
+	int m_fftSize;
+	int m_numPartitions;
+	int m_numFadeSamples;
+	ScopedPointer<FFT> m_pForwardFFT;
+	ScopedPointer<FFT> m_pInverseFFT;
+
+	// each filter is numPartitions spectra of fftSize bins, one after the other
+	std::vector<FFT::Complex> m_activeFilter;
+	std::vector<FFT::Complex> m_previousFilter;
+	CriticalSection m_filterLock;
+	std::vector<FFT::Complex> m_pendingFilter;
+	bool m_hasPendingFilter;
+
+	std::vector<FFT::Complex> m_inputFrame;
+	std::vector<FFT::Complex> m_delayLine;
+	int m_delayLineHead;
+	std::vector<FFT::Complex> m_spectrum;
+	std::vector<FFT::Complex> m_outputFrame;
+	std::vector<FFT::Complex> m_previousOutputFrame;
+	int m_blockPosition;
+	int m_fadePosition;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PartitionedConvolver)
+};
\ No newline at end of file
@@ -0,0 +1,246 @@
+#include "PhaseRotator.h"
+#include <complex>
+
+
+#define PHASEROTATOR_USE_SSE2 JUCE_INTEL
+#define PHASEROTATOR_LATENCY_HZ 60.0
+#define PHASEROTATOR_RAMP_SECONDS 0.02
+#define PHASEROTATOR_CHUNK_SAMPLES 64
+#define PHASEROTATOR_DENORMAL_LIMIT 1.0e-15f
+
+#if PHASEROTATOR_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+
+
+// each section is (c - z^-2) / (1 - c z^-2), a biquad with no first order terms, from Olli Niemitalo's
+// 90 degree phase difference network. The in-phase cascade also has a one sample delay.
+const double gInPhaseCoefficients[PHASEROTATOR_NUM_STAGES] = { 0.6923878, 0.9360654322959, 0.9882295226860, 0.9987488452737 };
+const double gQuadratureCoefficients[PHASEROTATOR_NUM_STAGES] = { 0.4021921162426, 0.8561710882420, 0.9722909545651, 0.9952884791278 };
+
+
+
+PhaseRotator::PhaseRotator()
+	: m_latencySamples(0)
+	, m_angleOffset(0.0f)
+	, m_dryBufferPosition(0)
+	, m_dryGain(1.0f)
+	, m_inPhaseGain(0.0f)
+	, m_quadratureGain(0.0f)
+{
+	// lanes are left in-phase, left quadrature, right in-phase, right quadrature
+	for(int stage = 0; stage < PHASEROTATOR_NUM_STAGES; ++stage)
+	{
+		m_coefficients[stage][0] = m_coefficients[stage][2] = (float)gInPhaseCoefficients[stage];
+		m_coefficients[stage][1] = m_coefficients[stage][3] = (float)gQuadratureCoefficients[stage];
+	}
+
+	reset();
+}
+
+
+PhaseRotator::~PhaseRotator()
+{
+}
+
+
+void PhaseRotator::prepareToPlay(double sampleRate)
+{
+	// the two cascades are within a sample of each other at low frequencies, so the average is reported
+	const double inPhaseDelay = 1.0 + getGroupDelay(gInPhaseCoefficients, PHASEROTATOR_LATENCY_HZ, sampleRate);
+	const double quadratureDelay = getGroupDelay(gQuadratureCoefficients, PHASEROTATOR_LATENCY_HZ, sampleRate);
+	m_latencySamples = (sampleRate > 0.0) ? roundDoubleToInt(0.5 * (inPhaseDelay + quadratureDelay)) : 0;
+	m_angleOffset = (sampleRate > 0.0) ? getInPhaseOffset(PHASEROTATOR_LATENCY_HZ, sampleRate, m_latencySamples) : 0.0f;
+
+	for(int channel = 0; channel < 2; ++channel)
+		m_dryBuffers[channel].assign(jmax(m_latencySamples, 1), 0.0f);
+	m_dryBufferPosition = 0;
+
+	m_dryGain.reset(sampleRate, PHASEROTATOR_RAMP_SECONDS);
+	m_inPhaseGain.reset(sampleRate, PHASEROTATOR_RAMP_SECONDS);
+	m_quadratureGain.reset(sampleRate, PHASEROTATOR_RAMP_SECONDS);
+
+	reset();
+}
+
+
+int PhaseRotator::getLatencySamples() const
+{
+	return m_latencySamples;
+}
+
+
+void PhaseRotator::process(float* pLeft, float* pRight, int numSamples, float angleDegrees)
+{
+	if(m_latencySamples <= 0)
+		return;
+
+	// at 0 degrees the output fades back to the delayed input, the cascade keeps running so it's ready
+	const bool isRotating = angleDegrees != 0.0f;
+	const float angle = degreesToRadians(angleDegrees) - m_angleOffset;
+	m_dryGain.setValue(isRotating ? 0.0f : 1.0f);
+	m_inPhaseGain.setValue(isRotating ? cosf(angle) : 0.0f);
+	m_quadratureGain.setValue(isRotating ? sinf(angle) : 0.0f);
+
+	float lanes[PHASEROTATOR_CHUNK_SAMPLES * PHASEROTATOR_NUM_LANES];
+	for(int chunkStart = 0; chunkStart < numSamples; chunkStart += PHASEROTATOR_CHUNK_SAMPLES)
+	{
+		const int chunkSamples = jmin(PHASEROTATOR_CHUNK_SAMPLES, numSamples - chunkStart);
+		processCascade(pLeft + chunkStart, pRight ? pRight + chunkStart : nullptr, lanes, chunkSamples);
+
+		for(int i = 0; i < chunkSamples; ++i)
+		{
+			const float dryGain = m_dryGain.getNextValue();
+			const float inPhaseGain = m_inPhaseGain.getNextValue();
+			const float quadratureGain = m_quadratureGain.getNextValue();
+			const float* pSampleLanes = lanes + i * PHASEROTATOR_NUM_LANES;
+
+			float* pSample = pLeft + chunkStart + i;
+			const float leftDry = m_dryBuffers[0][m_dryBufferPosition];
+			m_dryBuffers[0][m_dryBufferPosition] = *pSample;
+			*pSample = dryGain * leftDry + inPhaseGain * pSampleLanes[0] + quadratureGain * pSampleLanes[1];
+
+			if(pRight)
+			{
+				pSample = pRight + chunkStart + i;
+				const float rightDry = m_dryBuffers[1][m_dryBufferPosition];
+				m_dryBuffers[1][m_dryBufferPosition] = *pSample;
+				*pSample = dryGain * rightDry + inPhaseGain * pSampleLanes[2] + quadratureGain * pSampleLanes[3];
+			}
+
+			m_dryBufferPosition = (m_dryBufferPosition + 1) % m_latencySamples;
+		}
+	}
+
+	flushDenormals();
+}
+
+
+void PhaseRotator::reset()
+{
+	memset(m_stages, 0, sizeof(m_stages));
+	memset(m_previousOutput, 0, sizeof(m_previousOutput));
+}
+
+
+void PhaseRotator::processCascade(const float* pLeft, const float* pRight, float* pLanes, int numSamples)
+{
+	// every section is y = c * (x + y[n-2]) - x[n-2], the in-phase lanes are then held back a sample
+#if PHASEROTATOR_USE_SSE2
+	// the state lives in unaligned members, so it's held in registers for the whole chunk
+	__m128 coefficients[PHASEROTATOR_NUM_STAGES];
+	__m128 x1[PHASEROTATOR_NUM_STAGES], x2[PHASEROTATOR_NUM_STAGES], y1[PHASEROTATOR_NUM_STAGES], y2[PHASEROTATOR_NUM_STAGES];
+	for(int stage = 0; stage < PHASEROTATOR_NUM_STAGES; ++stage)
+	{
+		coefficients[stage] = _mm_loadu_ps(m_coefficients[stage]);
+		x1[stage] = _mm_loadu_ps(m_stages[stage].m_x1);
+		x2[stage] = _mm_loadu_ps(m_stages[stage].m_x2);
+		y1[stage] = _mm_loadu_ps(m_stages[stage].m_y1);
+		y2[stage] = _mm_loadu_ps(m_stages[stage].m_y2);
+	}
+	__m128 previous = _mm_loadu_ps(m_previousOutput);
+	const __m128 inPhaseMask = _mm_castsi128_ps(_mm_setr_epi32(-1, 0, -1, 0));
+
+	for(int i = 0; i < numSamples; ++i)
+	{
+		const float right = pRight ? pRight[i] : 0.0f;
+		__m128 x = _mm_setr_ps(pLeft[i], pLeft[i], right, right);
+		for(int stage = 0; stage < PHASEROTATOR_NUM_STAGES; ++stage)
+		{
+			const __m128 y = _mm_sub_ps(_mm_mul_ps(coefficients[stage], _mm_add_ps(x, y2[stage])), x2[stage]);
+			x2[stage] = x1[stage];
+			x1[stage] = x;
+			y2[stage] = y1[stage];
+			y1[stage] = y;
+			x = y;
+		}
+
+		_mm_storeu_ps(pLanes + i * PHASEROTATOR_NUM_LANES, _mm_or_ps(_mm_and_ps(inPhaseMask, previous), _mm_andnot_ps(inPhaseMask, x)));
+		previous = x;
+	}
+
+	for(int stage = 0; stage < PHASEROTATOR_NUM_STAGES; ++stage)
+	{
+		_mm_storeu_ps(m_stages[stage].m_x1, x1[stage]);
+		_mm_storeu_ps(m_stages[stage].m_x2, x2[stage]);
+		_mm_storeu_ps(m_stages[stage].m_y1, y1[stage]);
+		_mm_storeu_ps(m_stages[stage].m_y2, y2[stage]);
+	}
+	_mm_storeu_ps(m_previousOutput, previous);
+#else
+	for(int i = 0; i < numSamples; ++i)
+	{
+		const float right = pRight ? pRight[i] : 0.0f;
+		float x[PHASEROTATOR_NUM_LANES] = { pLeft[i], pLeft[i], right, right };
+		for(int stage = 0; stage < PHASEROTATOR_NUM_STAGES; ++stage)
+		{
+			StageState& state = m_stages[stage];
+			for(int lane = 0; lane < PHASEROTATOR_NUM_LANES; ++lane)
+			{
+				const float y = m_coefficients[stage][lane] * (x[lane] + state.m_y2[lane]) - state.m_x2[lane];
+				state.m_x2[lane] = state.m_x1[lane];
+				state.m_x1[lane] = x[lane];
+				state.m_y2[lane] = state.m_y1[lane];
+				state.m_y1[lane] = y;
+				x[lane] = y;
+			}
+		}
+
+		float* pSampleLanes = pLanes + i * PHASEROTATOR_NUM_LANES;
+		for(int lane = 0; lane < PHASEROTATOR_NUM_LANES; ++lane)
+		{
+			const bool isInPhase = (lane % 2) == 0;
+			pSampleLanes[lane] = isInPhase ? m_previousOutput[lane] : x[lane];
+			m_previousOutput[lane] = x[lane];
+		}
+	}
+#endif
+}
+
+
+void PhaseRotator::flushDenormals()
+{
+	// the sections ring for a long time in silence, so the state is cleared before it goes denormal
+	float* pState = &m_stages[0].m_x1[0];
+	const int numStateValues = sizeof(m_stages) / sizeof(float);
+	for(int i = 0; i < numStateValues; ++i)
+		if(fabsf(pState[i]) < PHASEROTATOR_DENORMAL_LIMIT)
+			pState[i] = 0.0f;
+
+	for(int lane = 0; lane < PHASEROTATOR_NUM_LANES; ++lane)
+		if(fabsf(m_previousOutput[lane]) < PHASEROTATOR_DENORMAL_LIMIT)
+			m_previousOutput[lane] = 0.0f;
+}
+
+
+double PhaseRotator::getGroupDelay(const double* pCoefficients, double frequency, double sampleRate)
+{
+	// a section in z^-2 delays by 2 (1 - c^2) / (1 - 2c cos(2w) + c^2) samples
+	if(sampleRate <= 0.0)
+		return 0.0;
+
+	const double cosine = cos(4.0 * double_Pi * frequency / sampleRate);
+	double groupDelay = 0.0;
+	for(int stage = 0; stage < PHASEROTATOR_NUM_STAGES; ++stage)
+	{
+		const double c = pCoefficients[stage];
+		groupDelay += 2.0 * (1.0 - c * c) / (1.0 - 2.0 * c * cosine + c * c);
+	}
+	return groupDelay;
+}
+
+
+float PhaseRotator::getInPhaseOffset(double frequency, double sampleRate, int latencySamples)
+{
+	// phase delay and group delay differ for an all-pass, so the in-phase output is also rotated against the
+	// delayed input. Measuring it at the latency frequency makes angles relative to what 0 degrees plays
+	// there, and the offset drifts by less than 30 degrees across 30Hz to 120Hz.
+	const double omega = 2.0 * double_Pi * frequency / sampleRate;
+	const std::complex<double> z2 = std::polar(1.0, -2.0 * omega);
+	std::complex<double> response = std::polar(1.0, -omega);
+	for(int stage = 0; stage < PHASEROTATOR_NUM_STAGES; ++stage)
+		response *= (gInPhaseCoefficients[stage] - z2) / (1.0 - gInPhaseCoefficients[stage] * z2);
+
+	return (float)std::arg(response * std::polar(1.0, omega * latencySamples));
+}
\ No newline at end of file
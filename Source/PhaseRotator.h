@@ -0,0 +1,62 @@
+#pragma once
+
+
+#include "JuceHeader.h"
+#include <vector>
+
+
+#define PHASEROTATOR_NUM_STAGES 4
+#define PHASEROTATOR_NUM_LANES 4
+
+
+// Rotates the phase of a stereo signal by a continuous angle. Two cascades of four all-pass biquads form a
+// Hilbert pair whose outputs stay about 90 degrees apart from 20Hz to 20kHz at 44.1kHz (the band scales with
+// the sample rate), and the output is cos(angle) * inPhase + sin(angle) * quadrature. Both channels of both
+// cascades run as the four lanes of one SSE biquad cascade, so a stereo sample costs four vector sections.
+//
+// The pair isn't linear phase, so the latency it reports is its group delay at PHASEROTATOR_LATENCY_HZ, where
+// kicks and bass sit. At 0 degrees it fades to the input delayed by that latency so it stays transparent
+// until it's used, and either way the latency doesn't change.
+//
+// Benchmarks/Source/Main.cpp times it: about 20ns per stereo sample with SSE2 and 25ns without on a Xeon server
+// core, including the crossfade, which is around 0.1% of one core at 48kHz.
+class PhaseRotator
+{
+public:
+	PhaseRotator();
+	~PhaseRotator();
+
+	void prepareToPlay(double sampleRate);
+	int getLatencySamples() const;
+
+	// processes in place, pRight can be null for a mono signal
+	void process(float* pLeft, float* pRight, int numSamples, float angleDegrees);
+
+private:
+	struct StageState
+	{
+		float m_x1[PHASEROTATOR_NUM_LANES];
+		float m_x2[PHASEROTATOR_NUM_LANES];
+		float m_y1[PHASEROTATOR_NUM_LANES];
+		float m_y2[PHASEROTATOR_NUM_LANES];
+	};
+
+	void reset();
+	void processCascade(const float* pLeft, const float* pRight, float* pLanes, int numSamples);
+	void flushDenormals();
+	static double getGroupDelay(const double* pCoefficients, double frequency, double sampleRate);
+	static float getInPhaseOffset(double frequency, double sampleRate, int latencySamples);
+
+	float m_coefficients[PHASEROTATOR_NUM_STAGES][PHASEROTATOR_NUM_LANES];
+	StageState m_stages[PHASEROTATOR_NUM_STAGES];
+	float m_previousOutput[PHASEROTATOR_NUM_LANES];
+
+	int m_latencySamples;
+	float m_angleOffset;
+	std::vector<float> m_dryBuffers[2];
+	int m_dryBufferPosition;
+
+	LinearSmoothedValue<float> m_dryGain;
+	LinearSmoothedValue<float> m_inPhaseGain;
+	LinearSmoothedValue<float> m_quadratureGain;
+};
\ No newline at end of file
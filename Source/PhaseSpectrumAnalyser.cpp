@@ -0,0 +1,180 @@
+#include "PhaseSpectrumAnalyser.h"
+#include "Math.h"
+
+
+#define PHASESPECTRUM_MIN_HZ 20.0f
+#define PHASESPECTRUM_MAX_HZ 500.0f
+#define PHASESPECTRUM_RESOLUTION_HZ 10.0
+#define PHASESPECTRUM_HOPS_PER_FRAME 8
+
+
+
+PhaseSpectrumAnalyser::PhaseSpectrumAnalyser()
+	: m_sampleRate(0.0)
+	, m_frameSize(0)
+	, m_hopSize(0)
+	, m_numBins(0)
+{
+}
+
+
+PhaseSpectrumAnalyser::~PhaseSpectrumAnalyser()
+{
+}
+
+
+void PhaseSpectrumAnalyser::prepare(double sampleRate)
+{
+	if(sampleRate == m_sampleRate)
+		return;
+
+	m_sampleRate = sampleRate;
+	m_beatSpectra.clear();
+	if(sampleRate <= 0.0)
+	{
+		m_frameSize = m_hopSize = m_numBins = 0;
+		m_pFFT = nullptr;
+		return;
+	}
+
+	// frames long enough to split 20Hz from 30Hz, only the bins up to just past the top of the view are kept
+	int order = 1;
+	while((1 << order) < sampleRate / PHASESPECTRUM_RESOLUTION_HZ)
+		++order;
+
+	m_frameSize = 1 << order;
+	m_hopSize = m_frameSize / PHASESPECTRUM_HOPS_PER_FRAME;
+	m_numBins = jmin(m_frameSize / 2, (int)ceil(PHASESPECTRUM_MAX_HZ * m_frameSize / sampleRate) + 2);
+	m_pFFT = new FFT(order, false);
+
+	m_window.resize(m_frameSize);
+	for(int i = 0; i < m_frameSize; ++i)
+		m_window[i] = 0.5f - 0.5f * cosf(2.0f * float_Pi * (float)i / (float)m_frameSize);
+
+	m_frame.resize(m_frameSize);
+	m_spectrum.resize(m_frameSize);
+	m_crossReal.resize(m_numBins);
+	m_crossImag.resize(m_numBins);
+	m_localPower.resize(m_numBins);
+	m_remotePower.resize(m_numBins);
+}
+
+
+void PhaseSpectrumAnalyser::updateBeat(int beatIndex, int sourceId, int64 beatNumber, const float* pSamples, int numSamples)
+{
+	if(m_pFFT == nullptr || beatIndex < 0)
+		return;
+
+	if(beatIndex >= m_beatSpectra.size())
+	{
+		const BeatSpectra emptySpectra = { -1, -1, 0, 0 };
+		m_beatSpectra.resize(beatIndex + 1, emptySpectra);
+	}
+
+	BeatSpectra& spectra = m_beatSpectra[beatIndex];
+	if(spectra.m_sourceId == sourceId && spectra.m_beatNumber == beatNumber && spectra.m_numSamples == numSamples)
+		return;
+
+	spectra.m_sourceId = sourceId;
+	spectra.m_beatNumber = beatNumber;
+	spectra.m_numSamples = numSamples;
+	spectra.m_numFrames = (numSamples > 0) ? (numSamples + m_hopSize - 1) / m_hopSize : 0;
+	spectra.m_bins.resize(spectra.m_numFrames * m_numBins);
+
+	// the beat repeats, so frames running off its end carry on from its start
+	for(int frame = 0; frame < spectra.m_numFrames; ++frame)
+	{
+		int position = (frame * m_hopSize) % numSamples;
+		for(int i = 0; i < m_frameSize; ++i)
+		{
+			m_frame[i].r = m_window[i] * pSamples[position];
+			m_frame[i].i = 0.0f;
+			if(++position == numSamples)
+				position = 0;
+		}
+
+		m_pFFT->perform(m_frame.data(), m_spectrum.data());
+		memcpy(spectra.m_bins.data() + frame * m_numBins, m_spectrum.data(), m_numBins * sizeof(FFT::Complex));
+	}
+}
+
+
+bool PhaseSpectrumAnalyser::buildCurves(const Placement& local, const Placement& remote, float* pPhaseCurve, float* pCoherenceCurve, int numPoints)
+{
+	if(m_pFFT == nullptr || numPoints < 2 || local.m_beatIndex >= m_beatSpectra.size() || remote.m_beatIndex >= m_beatSpectra.size())
+		return false;
+
+	const BeatSpectra& localSpectra = m_beatSpectra[local.m_beatIndex];
+	const BeatSpectra& remoteSpectra = m_beatSpectra[remote.m_beatIndex];
+	if(localSpectra.m_numFrames <= 0 || remoteSpectra.m_numFrames <= 0)
+		return false;
+
+	// local frame q plays alongside remote audio offset samples earlier, which starts the rest of the offset
+	// before remote frame q - hops. That remainder is within half a hop so it's taken as a phase shift.
+	const int offset = remote.m_delaySamples - local.m_delaySamples;
+	const int hops = roundDoubleToInt((double)offset / m_hopSize);
+	const int remainder = offset - hops * m_hopSize;
+	const double sign = local.m_sampleSign * remote.m_sampleSign;
+
+	std::fill(m_crossReal.begin(), m_crossReal.end(), 0.0);
+	std::fill(m_crossImag.begin(), m_crossImag.end(), 0.0);
+	std::fill(m_localPower.begin(), m_localPower.end(), 0.0);
+	std::fill(m_remotePower.begin(), m_remotePower.end(), 0.0);
+	for(int frame = 0; frame < localSpectra.m_numFrames; ++frame)
+	{
+		const int remoteFrame = Math::positiveModulo(frame - hops, remoteSpectra.m_numFrames);
+		const FFT::Complex* pLocalBins = localSpectra.m_bins.data() + frame * m_numBins;
+		const FFT::Complex* pRemoteBins = remoteSpectra.m_bins.data() + remoteFrame * m_numBins;
+		for(int bin = 0; bin < m_numBins; ++bin)
+		{
+			// remote times the conjugate of local
+			const double localReal = pLocalBins[bin].r, localImag = pLocalBins[bin].i;
+			const double remoteReal = pRemoteBins[bin].r, remoteImag = pRemoteBins[bin].i;
+			m_crossReal[bin] += remoteReal * localReal + remoteImag * localImag;
+			m_crossImag[bin] += remoteImag * localReal - remoteReal * localImag;
+			m_localPower[bin] += localReal * localReal + localImag * localImag;
+			m_remotePower[bin] += remoteReal * remoteReal + remoteImag * remoteImag;
+		}
+	}
+
+	for(int bin = 0; bin < m_numBins; ++bin)
+	{
+		const double angle = -2.0 * double_Pi * bin * remainder / m_frameSize;
+		const double real = sign * (m_crossReal[bin] * cos(angle) - m_crossImag[bin] * sin(angle));
+		const double imag = sign * (m_crossReal[bin] * sin(angle) + m_crossImag[bin] * cos(angle));
+		m_crossReal[bin] = real;
+		m_crossImag[bin] = imag;
+	}
+
+	// points are spaced evenly in log frequency and read between the two nearest bins
+	const double binsPerHz = m_frameSize / m_sampleRate;
+	const double logSpan = log((double)PHASESPECTRUM_MAX_HZ / PHASESPECTRUM_MIN_HZ);
+	for(int point = 0; point < numPoints; ++point)
+	{
+		const double frequency = PHASESPECTRUM_MIN_HZ * exp(logSpan * point / (numPoints - 1));
+		const double binPosition = jmin(frequency * binsPerHz, (double)m_numBins - 1.001);
+		const int bin = (int)binPosition;
+		const double fraction = binPosition - bin;
+
+		const double real = m_crossReal[bin] + fraction * (m_crossReal[bin + 1] - m_crossReal[bin]);
+		const double imag = m_crossImag[bin] + fraction * (m_crossImag[bin + 1] - m_crossImag[bin]);
+		const double localPower = m_localPower[bin] + fraction * (m_localPower[bin + 1] - m_localPower[bin]);
+		const double remotePower = m_remotePower[bin] + fraction * (m_remotePower[bin + 1] - m_remotePower[bin]);
+
+		if(pPhaseCurve)
+			pPhaseCurve[point] = (float)(atan2(imag, real) / double_Pi);
+		if(pCoherenceCurve)
+		{
+			const double powerProduct = localPower * remotePower;
+			pCoherenceCurve[point] = (powerProduct > 0.0) ? (float)jmin(1.0, (real * real + imag * imag) / powerProduct) : 0.0f;
+		}
+	}
+
+	return true;
+}
+
+
+float PhaseSpectrumAnalyser::getFrequencyPosition(float frequency)
+{
+	return logf(frequency / PHASESPECTRUM_MIN_HZ) / logf(PHASESPECTRUM_MAX_HZ / PHASESPECTRUM_MIN_HZ);
+}
\ No newline at end of file
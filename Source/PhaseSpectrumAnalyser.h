@@ -0,0 +1,65 @@
+#pragma once
+
+
+#include "JuceHeader.h"
+#include <vector>
+
+
+// Shows which low frequencies of a remote beat line up with the local one. Each beat is cut into Hann windowed
+// frames an eighth of a frame apart and transformed once, and only again when its source captures a new beat,
+// so the FFT plan and the spectra are reused from frame to frame. Curves are then built from the cached bins:
+// the delays and polarities are applied by pairing frames a whole hop apart and rotating the rest of the
+// offset into the phase, and the cross-spectrum averaged over the frames gives the phase difference and the
+// coherence on a log scale from 20Hz to 500Hz.
+class PhaseSpectrumAnalyser
+{
+public:
+	struct Placement
+	{
+		int m_beatIndex;
+		int m_delaySamples;
+		float m_sampleSign;
+	};
+
+	PhaseSpectrumAnalyser();
+	~PhaseSpectrumAnalyser();
+
+	// a new sample rate drops every cached spectrum
+	void prepare(double sampleRate);
+	// the beat's frames are only transformed when its source, beat number or length differ from the cached ones
+	void updateBeat(int beatIndex, int sourceId, int64 beatNumber, const float* pSamples, int numSamples);
+
+	// phase is remote minus local scaled to -1 to 1 for -180 to 180 degrees and coherence runs from 0 to 1,
+	// either curve can be null and both are left alone when there is nothing to compare
+	bool buildCurves(const Placement& local, const Placement& remote, float* pPhaseCurve, float* pCoherenceCurve, int numPoints);
+
+	// where a frequency sits across the display, from 0 to 1
+	static float getFrequencyPosition(float frequency);
+
+private:
+	struct BeatSpectra
+	{
+		int m_sourceId;
+		int64 m_beatNumber;
+		int m_numSamples;
+		int m_numFrames;
+		std::vector<FFT::Complex> m_bins;
+	};
+
+	double m_sampleRate;
+	int m_frameSize;
+	int m_hopSize;
+	int m_numBins;
+	ScopedPointer<FFT> m_pFFT;
+	std::vector<float> m_window;
+	std::vector<FFT::Complex> m_frame;
+	std::vector<FFT::Complex> m_spectrum;
+	std::vector<BeatSpectra> m_beatSpectra;
+
+	std::vector<double> m_crossReal;
+	std::vector<double> m_crossImag;
+	std::vector<double> m_localPower;
+	std::vector<double> m_remotePower;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PhaseSpectrumAnalyser)
+};
\ No newline at end of file
@@ -45,6 +45,10 @@ KickFaceAudioProcessorEditor::KickFaceAudioProcessorEditor(KickFaceAudioProcesso
 	m_pLocalLookAndFeel->setColour(SwingBarComponent::ColourIds::foregroundColourId, localHilightColour);
 	m_pLocalLookAndFeel->setColour(TextButton::ColourIds::buttonColourId, localBaseColour);
 	m_pLocalLookAndFeel->setColour(TextButton::ColourIds::buttonOnColourId, localHilightColour);
+	m_pLocalLookAndFeel->setColour(Slider::ColourIds::backgroundColourId, localBaseColour);
+	m_pLocalLookAndFeel->setColour(Slider::ColourIds::thumbColourId, localHilightColour);
+	m_pLocalLookAndFeel->setColour(Slider::ColourIds::textBoxTextColourId, Colour::greyLevel(0.1f));
+	m_pLocalLookAndFeel->setColour(Slider::ColourIds::textBoxOutlineColourId, localBaseColour.darker(0.5f));
 	KickFaceLookAndFeel::setDefaultLookAndFeel(m_pLocalLookAndFeel);
 
 	m_pRemoteLookAndFeel = new KickFaceLookAndFeel();
@@ -57,6 +61,10 @@ KickFaceAudioProcessorEditor::KickFaceAudioProcessorEditor(KickFaceAudioProcesso
 	m_pRemoteLookAndFeel->setColour(SwingBarComponent::ColourIds::foregroundColourId, remoteHilightColour);
 	m_pRemoteLookAndFeel->setColour(TextButton::ColourIds::buttonColourId, remoteBaseColour);
 	m_pRemoteLookAndFeel->setColour(TextButton::ColourIds::buttonOnColourId, remoteHilightColour);
+	m_pRemoteLookAndFeel->setColour(Slider::ColourIds::backgroundColourId, remoteBaseColour);
+	m_pRemoteLookAndFeel->setColour(Slider::ColourIds::thumbColourId, remoteHilightColour);
+	m_pRemoteLookAndFeel->setColour(Slider::ColourIds::textBoxTextColourId, Colour::greyLevel(0.1f));
+	m_pRemoteLookAndFeel->setColour(Slider::ColourIds::textBoxOutlineColourId, remoteBaseColour.darker(0.5f));
 
 	// initialise info button
 	m_infoButton.setImages(true, false, true,
@@ -92,6 +100,7 @@ KickFaceAudioProcessorEditor::KickFaceAudioProcessorEditor(KickFaceAudioProcesso
 	addAndMakeVisible(m_trackControl);
 
 	m_remoteTrackControl.setLookAndFeel(m_pRemoteLookAndFeel);
+	m_remoteTrackControl.setSummationReference(&m_processor);
 	addAndMakeVisible(m_remoteTrackControl);
 
 	// initialise resizer and set size
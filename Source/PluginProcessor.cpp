@@ -5,6 +5,13 @@
 #include <vector>
 
 
+#define PLUGINPROCESSOR_USE_SSE2 JUCE_INTEL
+
+#if PLUGINPROCESSOR_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+
 
 #if USE_LOGGING
 String g_logWelcomeMessage =
@@ -33,6 +40,8 @@ String KickFaceAudioProcessor::s_nameDefs[] = {
 	"Sheldon",
 	"Vincent" };
 
+Atomic<int64> KickFaceAudioProcessor::s_sharedCaptureStart(-1);
+
 
 
 KickFaceAudioProcessor::KickFaceAudioProcessor()
@@ -50,8 +59,22 @@ KickFaceAudioProcessor::KickFaceAudioProcessor()
 	, m_parameters(*this, nullptr)
 	, m_sampleRate(0.0)
 	, m_beatBufferPosition(0)
+	, m_beatNumber(0)
+	, m_maxBeatBufferSamples(0)
+	, m_maxCaptureChunkSamples(0)
+	, m_trackerTimeInSamples(0)
+	, m_triggerHistoryPosition(0)
+	, m_numOnsetPreSamples(0)
+	, m_triggerClock(0)
+	, m_triggerWindowEnd(-1)
+	, m_numTriggerWindowSamples(0)
+	, m_lastSharedCaptureStart(-1)
 	, m_delayBufferPosition(0)
+	, m_alignmentFilterDesigner(m_alignmentConvolver)
 	, m_errorState(0)
+	, m_appliedRestoredBeat(0)
+	, m_restoredBeatNumber(-1)
+	, m_isHoldingRestoredBeat(false)
 {
 #if USE_LOGGING
 	m_pFileLogger = FileLogger::createDateStampedLogger("KickFace", "KickFace_", ".txt", g_logWelcomeMessage);
@@ -60,14 +83,23 @@ KickFaceAudioProcessor::KickFaceAudioProcessor()
 
 	setLatencySamples(SAMPLE_DELAY_RANGE);
 
+	// hosts address parameters by index, so new ones are only ever added after the existing ones
 	m_parameters.createAndAddParameter("delay", "Delay", "delay", NormalisableRange<float>(-SAMPLE_DELAY_RANGE, SAMPLE_DELAY_RANGE, 1.0f), 0.0f, nullptr, nullptr);
 	m_parameters.createAndAddParameter("invertPhase", "InvertPhase", "invertPhase", NormalisableRange<float>(0.0f, 1.0f, 1.0f), 0.0f, invertPhaseToText, textToInvertPhase);
 	m_parameters.createAndAddParameter("listenMode", "ListenMode", "listenMode", NormalisableRange<float>(0.0f, (float)E_ListenMode::Max, 1.0f), (float)E_ListenMode::LeftChannelOnly, listenModeToText, textToListenMode);
+	m_parameters.createAndAddParameter("phaseRotation", "PhaseRotation", "phaseRotation", NormalisableRange<float>(-PHASE_ROTATION_RANGE, PHASE_ROTATION_RANGE), 0.0f, nullptr, nullptr);
+	m_parameters.createAndAddParameter("captureMode", "CaptureMode", "captureMode", NormalisableRange<float>(0.0f, (float)E_CaptureMode::Max - 1.0f, 1.0f), (float)E_CaptureMode::TempoGrid, captureModeToText, textToCaptureMode);
+	m_parameters.createAndAddParameter("captureLength", "CaptureLength", "captureLength", NormalisableRange<float>(CAPTURE_LENGTH_MIN_MS, CAPTURE_LENGTH_MAX_MS, 1.0f), CAPTURE_LENGTH_DEFAULT_MS, nullptr, nullptr);
+	m_parameters.createAndAddParameter("captureOffset", "CaptureOffset", "captureOffset", NormalisableRange<float>(0.0f, CAPTURE_OFFSET_MAX_MS, 1.0f), 0.0f, nullptr, nullptr);
 	m_parameters.state = ValueTree(Identifier("KickFaceValueTree"));
 
 	m_delayValue = m_parameters.getParameterAsValue("delay");
 	m_invertPhaseValue = m_parameters.getParameterAsValue("invertPhase");
+	m_phaseRotationValue = m_parameters.getParameterAsValue("phaseRotation");
 	m_listenModeValue = m_parameters.getParameterAsValue("listenMode");
+	m_captureModeValue = m_parameters.getParameterAsValue("captureMode");
+	m_captureLengthValue = m_parameters.getParameterAsValue("captureLength");
+	m_captureOffsetValue = m_parameters.getParameterAsValue("captureOffset");
 
 	generateInstanceId();
 	generateGivenName();
@@ -158,14 +190,42 @@ void KickFaceAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBloc
 	m_sampleRate = sampleRate;
 	m_errorState = 0;
 
-	// prepare beat buffer
+	// prepare beat buffer, it's allocated up front for the slowest beat the grid captures and the longest window
+	// so capturing never allocates
+	const int maxTriggerWindowSamples = roundDoubleToInt(CAPTURE_LENGTH_MAX_MS * 0.001 * sampleRate);
+	m_maxBeatBufferSamples = jmax((int)ceil(60.0 * sampleRate / CAPTURE_MIN_BPM), maxTriggerWindowSamples);
+	m_beatBuffer.setSize((int)E_ListenMode::Max, m_maxBeatBufferSamples, false, true, true);
 	m_beatBuffer.clear();
+	m_beatHistory.prepare(BEAT_HISTORY_SIZE, roundDoubleToInt(BEAT_HISTORY_MAX_SECONDS * sampleRate), BEAT_HISTORY_HALF_FLOATS);
+	m_captureBuffer.setSize((int)E_ListenMode::Max, jmax(1, samplesPerBlock));
+	m_maxCaptureChunkSamples = jmax(1, samplesPerBlock);
+
+	// prepare triggered capture, the history holds the longest window and the chunk that completes it
+	m_onsetDetector.prepare(sampleRate);
+	m_noveltyBuffer.resize(m_maxCaptureChunkSamples / m_onsetDetector.getDecimationFactor() + 1);
+	m_tempoTracker.prepare(sampleRate, m_onsetDetector.getDecimationFactor());
+	m_trackerTimeInSamples = 0;
+	m_numOnsetPreSamples = roundDoubleToInt(ONSET_CAPTURE_PRE_SECONDS * sampleRate);
+	m_triggerHistoryBuffer.setSize((int)E_ListenMode::Max, maxTriggerWindowSamples + TRIGGER_CAPTURE_CHUNK_SIZE);
+	m_triggerHistoryBuffer.clear();
+	m_triggerHistoryPosition = 0;
+	m_triggerClock = 0;
+	m_triggerWindowEnd = -1;
+
+	// a beat restored with the session goes straight into the fresh beat buffer, and is put back if the host
+	// prepares again before it has played
+	updateRestoredBeat(true);
 
 	// prepare delay buffer
 	m_delayBuffer.setSize(2, 2 * SAMPLE_DELAY_RANGE);
 	m_delayBuffer.clear();
 	m_delayBufferPosition = 0;
 
+	// prepare alignment filter and phase rotation, their latencies depend on the sample rate
+	m_alignmentConvolver.prepare(AlignmentFilterDesigner::getNumTaps(sampleRate), ALIGNMENT_FILTER_BLOCK_SIZE, sampleRate);
+	m_phaseRotator.prepareToPlay(sampleRate);
+	setLatencySamples(SAMPLE_DELAY_RANGE + m_alignmentConvolver.getLatencySamples() + m_phaseRotator.getLatencySamples());
+
 	// reset time
 	m_timeInSamples = 0;
 
@@ -180,6 +240,10 @@ void KickFaceAudioProcessor::releaseResources()
 {
 	m_delayBuffer.setSize(0, 0);
 	m_beatBuffer.setSize(0, 0);
+	m_captureBuffer.setSize(0, 0);
+	m_triggerHistoryBuffer.setSize(0, 0);
+
+	// the beat history is kept so the last beat can still be saved with the state
 }
 
 
@@ -244,79 +308,22 @@ void KickFaceAudioProcessor::processBlock(AudioSampleBuffer& buffer, MidiBuffer&
 	}
 #endif
 
-	// update beat buffer
+	// the capture buffers are sized for the block size prepareToPlay was given, so a host sending bigger blocks has
+	// them captured in pieces rather than the buffers growing on the audio thread
 	AudioPlayHead::CurrentPositionInfo posInfo;
-	if(getPlayHead()->getCurrentPosition(posInfo))
-	{
-#if USE_PLUGIN_HOST
-		double bpm = DEFAULT_BPM;
-		m_timeInSamples = m_timeInSamples;
-#else
-		double bpm = posInfo.bpm;
-		m_timeInSamples = posInfo.timeInSamples;
-#endif
-
-		const double numSamplesPerBeatReal = (bpm > 0.0) ? m_sampleRate * 60.0 / bpm : 0.0;
-		const int64 numSamplesPerBeatInt = (int64)ceil(numSamplesPerBeatReal);
-		m_beatBuffer.setSize(1, numSamplesPerBeatInt, true, true, true);
-
-		if(m_beatBuffer.getNumSamples() > 0 && numSamplesPerBeatInt > 0)
-		{
-			E_ListenMode listenMode = (E_ListenMode)juce::roundFloatToInt((float)m_listenModeValue.getValue());
-			if(totalNumInputChannels > 1 && listenMode == E_ListenMode::SumLeftAndRightChannels)
-			{
-				int64 numSamplesWritten = 0;
-				while(numSamplesWritten < buffer.getNumSamples())
-				{
-					// write data into beat buffer
-					const int64 numSamplesFromBeatStart = (int64)fmod(m_timeInSamples + numSamplesWritten, numSamplesPerBeatReal);
-					const int64 numSamplesToWrite = jmin<int64>(buffer.getNumSamples(), numSamplesPerBeatInt - numSamplesFromBeatStart);
-					float* pWriteData = m_beatBuffer.getWritePointer(0, numSamplesFromBeatStart);
-					FloatVectorOperations::copyWithMultiply(pWriteData, pChannelData[0] + numSamplesWritten, 0.5f, numSamplesToWrite);
-					FloatVectorOperations::addWithMultiply(pWriteData, pChannelData[1] + numSamplesWritten, 0.5f, numSamplesToWrite);
-					numSamplesWritten += numSamplesToWrite;
-				}
-			}
-			else
-			{
-				const float* pReadData = (totalNumInputChannels == 1) ? pChannelData[0] : pChannelData[(int)listenMode];
-
-				int64 numSamplesWritten = 0;
-				while(numSamplesWritten < buffer.getNumSamples())
-				{
-					// write data into beat buffer
-					const int64 numSamplesFromBeatStart = (int64)fmod(m_timeInSamples + numSamplesWritten, numSamplesPerBeatReal);
-					const int64 numSamplesToWrite = jmin<int64>(buffer.getNumSamples(), numSamplesPerBeatInt - numSamplesFromBeatStart);
-					float* pWriteData = m_beatBuffer.getWritePointer(0, numSamplesFromBeatStart);
-					FloatVectorOperations::copy(pWriteData, pReadData + numSamplesWritten, numSamplesToWrite);
-					numSamplesWritten += numSamplesToWrite;
-				}
-			}
-
-			m_beatBufferPosition = (int64)fmod(m_timeInSamples + buffer.getNumSamples(), numSamplesPerBeatReal);
-		}
-#if USE_LOGGING
-		else
-		{
-			Logger::writeToLog(String("processBlock -> empty beat buffer : beatBufferSize ") + String(m_beatBuffer.getNumSamples())
-				+ String(" : sampleRate ") + String(m_sampleRate)
-				+ String(" : bpm ") + String(bpm)
-				+ String(" : numSamplesPerBeat ") + String(numSamplesPerBeatInt));
-		}
-#endif
-
-#if USE_PLUGIN_HOST
-		m_timeInSamples += buffer.getNumSamples();
-#endif
-	}
-	else
+	posInfo.resetToDefault();
+	const bool hasPosition = getPlayHead() != nullptr && getPlayHead()->getCurrentPosition(posInfo);
+	updateRestoredBeat(false);
+	m_isHoldingRestoredBeat = m_isHoldingRestoredBeat && hasPosition && !posInfo.isPlaying;
+
+	const int maxChunkSamples = jmax(1, m_maxCaptureChunkSamples);
+	const float* pRightChannelData = (totalNumInputChannels > 1) ? pChannelData[1] : pChannelData[0];
+	for(int chunkStart = 0; chunkStart < buffer.getNumSamples(); chunkStart += maxChunkSamples)
 	{
-#if USE_LOGGING
-		Logger::writeToLog(String("processBlock -> no playhead found"));
-#endif
-
-		m_errorState |= (uint32)E_KickFaceError::NoPlayheadFound;
-		m_beatBufferPosition = 0;
+		AudioPlayHead::CurrentPositionInfo chunkPosInfo = posInfo;
+		chunkPosInfo.timeInSamples += chunkStart;
+		captureChunk(pChannelData[0] + chunkStart, pRightChannelData + chunkStart, jmin(maxChunkSamples, buffer.getNumSamples() - chunkStart),
+			midiMessages, chunkStart, buffer.getNumSamples(), hasPosition ? &chunkPosInfo : nullptr);
 	}
 
     // update and output delay line
@@ -374,6 +381,14 @@ void KickFaceAudioProcessor::processBlock(AudioSampleBuffer& buffer, MidiBuffer&
 
 		// update delay buffer position
 		m_delayBufferPosition = (m_delayBufferPosition + buffer.getNumSamples()) % m_delayBuffer.getNumSamples();
+
+		// filter and rotate phase of both channels together
+		const int numRotatedChannels = jmin(jmin(totalNumInputChannels, 2), totalNumOutputChannels);
+		if(numRotatedChannels > 0)
+		{
+			m_alignmentConvolver.process(pChannelData[0], numRotatedChannels > 1 ? pChannelData[1] : nullptr, buffer.getNumSamples());
+			m_phaseRotator.process(pChannelData[0], numRotatedChannels > 1 ? pChannelData[1] : nullptr, buffer.getNumSamples(), (float)m_phaseRotationValue.getValue());
+		}
 	}
 #if	USE_LOGGING
 	else
@@ -384,6 +399,418 @@ void KickFaceAudioProcessor::processBlock(AudioSampleBuffer& buffer, MidiBuffer&
 }
 
 
+void KickFaceAudioProcessor::captureChunk(const float* pLeft, const float* pRight, int numSamples, const MidiBuffer& midiMessages, int chunkStart, int numBlockSamples, const AudioPlayHead::CurrentPositionInfo* pPosInfo)
+{
+	// split the input into a lane per listen mode in a single pass, every capture mode copies all of them so
+	// the beat buffer always has a whole beat of whichever lane gets listened to next. Mono input fills them all.
+	m_captureBuffer.setSize((int)E_ListenMode::Max, numSamples, false, false, true);
+	splitCaptureLanes(pLeft, pRight, m_captureBuffer.getArrayOfWritePointers(), numSamples);
+	const float* pCaptureData = m_captureBuffer.getReadPointer(getListenLane());
+
+	// onsets are looked for in every block, so the tempo tracker has a history ready whenever the host stops
+	// supplying a tempo. Chunks are never longer than the novelty buffer was sized for in prepareToPlay.
+	jassert((int)m_noveltyBuffer.size() >= numSamples / m_onsetDetector.getDecimationFactor() + 1);
+
+	int numNoveltyValues = 0;
+	const int onsetSample = m_onsetDetector.process(pCaptureData, numSamples, m_noveltyBuffer.data(), &numNoveltyValues);
+	m_tempoTracker.pushNovelty(m_noveltyBuffer.data(), numNoveltyValues);
+
+	// update beat buffer, triggered windows don't need a playhead but can only be shared while the host is playing
+	const bool hasHostTempo = pPosInfo && (USE_PLUGIN_HOST || pPosInfo->bpm > 0.0);
+	const E_CaptureMode captureMode = (E_CaptureMode)jlimit(0, (int)E_CaptureMode::Max - 1, roundFloatToInt((float)m_captureModeValue.getValue()));
+	TempoTracker::Estimate tempoEstimate;
+	const bool isGridCapture = captureMode == E_CaptureMode::TempoGrid || captureMode == E_CaptureMode::TempoGridWindow;
+	if(m_isHoldingRestoredBeat)
+	{
+		// a beat restored with the session stays up until the host plays, rather than being overwritten while stopped
+		m_beatBufferPosition = 0;
+	}
+	else if(!isGridCapture)
+	{
+		// midi windows start right on the note, onset windows a little before the hit the detector caught
+		const bool isMidiCapture = captureMode == E_CaptureMode::MidiNotes;
+		int triggerSample = -1;
+		if(isMidiCapture)
+			triggerSample = findFirstNoteOn(midiMessages, chunkStart, numSamples, numBlockSamples);
+		else if(captureMode == E_CaptureMode::Onsets)
+			triggerSample = onsetSample;
+
+		captureTriggeredWindows(m_captureBuffer, numSamples, triggerSample, isMidiCapture ? 0 : m_numOnsetPreSamples,
+			(pPosInfo && pPosInfo->isPlaying) ? pPosInfo : nullptr, captureMode == E_CaptureMode::FollowTriggers);
+	}
+	else if(hasHostTempo)
+	{
+#if USE_PLUGIN_HOST
+		double bpm = DEFAULT_BPM;
+		m_timeInSamples = m_timeInSamples;
+#else
+		double bpm = pPosInfo->bpm;
+		m_timeInSamples = pPosInfo->timeInSamples;
+#endif
+
+		captureBeatGrid(m_captureBuffer, numSamples, bpm, captureMode == E_CaptureMode::TempoGridWindow);
+
+#if USE_PLUGIN_HOST
+		m_timeInSamples += numSamples;
+#endif
+	}
+	else if(m_tempoTracker.getEstimate(tempoEstimate) && m_trackerTimeInSamples >= tempoEstimate.m_beatOrigin)
+	{
+		// the tracker's beat origin is on its own clock, which counts every sample since prepareToPlay
+		m_timeInSamples = m_trackerTimeInSamples - (int64)tempoEstimate.m_beatOrigin;
+		captureBeatGrid(m_captureBuffer, numSamples, tempoEstimate.m_bpm, captureMode == E_CaptureMode::TempoGridWindow);
+	}
+	else
+	{
+#if USE_LOGGING
+		Logger::writeToLog(String("processBlock -> no playhead found"));
+#endif
+
+		m_errorState |= (uint32)E_KickFaceError::NoPlayheadFound;
+		m_beatBufferPosition = 0;
+	}
+
+	m_trackerTimeInSamples += numSamples;
+}
+
+
+void KickFaceAudioProcessor::captureBeatGrid(const AudioSampleBuffer& captureLanes, int numSamples, double bpm, bool isWindowed)
+{
+	const double numSamplesPerBeatReal = (bpm > 0.0) ? m_sampleRate * 60.0 / bpm : 0.0;
+	const int64 numSamplesPerBeatInt = (int64)ceil(numSamplesPerBeatReal);
+
+	// a window keeps only part of each beat, so the buffer and everything reading it scale with the window rather
+	// than the tempo. Beats slower than CAPTURE_MIN_BPM are cut short so it never outgrows what prepareToPlay
+	// allocated.
+	int64 windowStart = 0;
+	int64 windowEnd = numSamplesPerBeatInt;
+	if(isWindowed && numSamplesPerBeatInt > 0)
+	{
+		windowStart = jlimit<int64>(0, numSamplesPerBeatInt - 1, roundDoubleToInt((float)m_captureOffsetValue.getValue() * 0.001 * m_sampleRate));
+		windowEnd = jmin<int64>(numSamplesPerBeatInt, windowStart + jmax(1, roundDoubleToInt((float)m_captureLengthValue.getValue() * 0.001 * m_sampleRate)));
+	}
+
+	windowEnd = jmin<int64>(windowEnd, windowStart + m_maxBeatBufferSamples);
+
+	// the size only changes with the tempo or the window, when the whole beat gets rewritten anyway, so nothing is
+	// kept and within the prepared allocation nothing is allocated
+	const int numLanes = captureLanes.getNumChannels();
+	if(m_beatBuffer.getNumSamples() != windowEnd - windowStart || m_beatBuffer.getNumChannels() != numLanes)
+		m_beatBuffer.setSize(numLanes, windowEnd - windowStart, false, true, true);
+
+	if(m_beatBuffer.getNumSamples() > 0 && numSamplesPerBeatInt > 0)
+	{
+		int64 numSamplesWritten = 0;
+		while(numSamplesWritten < numSamples)
+		{
+			// write the part of this run that falls inside the window into beat buffer
+			const int64 numSamplesFromBeatStart = (int64)fmod(m_timeInSamples + numSamplesWritten, numSamplesPerBeatReal);
+			const int64 numSamplesToWrite = jmin<int64>(numSamples - numSamplesWritten, numSamplesPerBeatInt - numSamplesFromBeatStart);
+			const int64 copyStart = jmax(numSamplesFromBeatStart, windowStart);
+			const int64 copyEnd = jmin(numSamplesFromBeatStart + numSamplesToWrite, windowEnd);
+			if(copyEnd > copyStart)
+			{
+				for(int lane = 0; lane < numLanes; ++lane)
+				{
+					float* pWriteData = m_beatBuffer.getWritePointer(lane, copyStart - windowStart);
+					FloatVectorOperations::copy(pWriteData, captureLanes.getReadPointer(lane, numSamplesWritten + copyStart - numSamplesFromBeatStart), copyEnd - copyStart);
+				}
+			}
+
+			// a beat is finished as soon as its last sample is in, before the next one starts overwriting it
+			if(numSamplesFromBeatStart < windowEnd && numSamplesFromBeatStart + numSamplesToWrite >= windowEnd)
+				finishBeat();
+
+			numSamplesWritten += numSamplesToWrite;
+		}
+
+		m_beatBufferPosition = (int64)fmod(m_timeInSamples + numSamples, numSamplesPerBeatReal);
+	}
+#if USE_LOGGING
+	else
+	{
+		Logger::writeToLog(String("processBlock -> empty beat buffer : beatBufferSize ") + String(m_beatBuffer.getNumSamples())
+			+ String(" : sampleRate ") + String(m_sampleRate)
+			+ String(" : bpm ") + String(bpm)
+			+ String(" : numSamplesPerBeat ") + String(numSamplesPerBeatInt));
+	}
+#endif
+}
+
+
+void KickFaceAudioProcessor::captureTriggeredWindows(const AudioSampleBuffer& captureLanes, int numSamples, int triggerSample, int numPreSamples, const AudioPlayHead::CurrentPositionInfo* pPlayingPosInfo, bool followShared)
+{
+	const int numHistorySamples = m_triggerHistoryBuffer.getNumSamples();
+	const int numLanes = jmin(captureLanes.getNumChannels(), m_triggerHistoryBuffer.getNumChannels());
+	if(numHistorySamples <= 0)
+		return;
+
+	m_beatBufferPosition = 0;
+
+	// shared window starts are host times, the trigger clock is where this block starts on the same timeline
+	if(followShared && pPlayingPosInfo)
+	{
+		const int64 sharedCaptureStart = s_sharedCaptureStart.get();
+		if(sharedCaptureStart >= 0 && sharedCaptureStart != m_lastSharedCaptureStart)
+		{
+			m_lastSharedCaptureStart = sharedCaptureStart;
+			startTriggeredCapture(m_triggerClock + sharedCaptureStart - pPlayingPosInfo->timeInSamples);
+		}
+	}
+
+	// chunks are small enough that the history still holds the start of a window when its last chunk arrives
+	int position = 0;
+	while(position < numSamples)
+	{
+		const int numChunkSamples = jmin(TRIGGER_CAPTURE_CHUNK_SIZE, numSamples - position);
+
+		int numSamplesWritten = 0;
+		while(numSamplesWritten < numChunkSamples)
+		{
+			const int numSamplesToWrite = jmin(numChunkSamples - numSamplesWritten, numHistorySamples - m_triggerHistoryPosition);
+			for(int lane = 0; lane < numLanes; ++lane)
+				FloatVectorOperations::copy(m_triggerHistoryBuffer.getWritePointer(lane, m_triggerHistoryPosition), captureLanes.getReadPointer(lane, position + numSamplesWritten), numSamplesToWrite);
+			numSamplesWritten += numSamplesToWrite;
+			m_triggerHistoryPosition = (m_triggerHistoryPosition + numSamplesToWrite) % numHistorySamples;
+		}
+
+		m_triggerClock += numChunkSamples;
+
+		if(triggerSample >= position && triggerSample < position + numChunkSamples)
+		{
+			const int64 windowStart = m_triggerClock - numChunkSamples + triggerSample - position - numPreSamples;
+			if(startTriggeredCapture(windowStart) && pPlayingPosInfo)
+				s_sharedCaptureStart.set(pPlayingPosInfo->timeInSamples + triggerSample - numPreSamples);
+		}
+
+		// a finished window is copied over in one go, so readers never see half of one. The beat buffer was
+		// allocated for the longest window in prepareToPlay, so resizing it here never allocates.
+		if(m_triggerWindowEnd >= 0 && m_triggerWindowEnd <= m_triggerClock)
+		{
+			m_beatBuffer.setSize(numLanes, m_numTriggerWindowSamples, false, false, true);
+
+			const int historyEnd = Math::positiveModulo(m_triggerHistoryPosition - (int)(m_triggerClock - m_triggerWindowEnd), numHistorySamples);
+			const int historyStart = Math::positiveModulo(historyEnd - m_numTriggerWindowSamples, numHistorySamples);
+			const int numFirstSamples = jmin(m_numTriggerWindowSamples, numHistorySamples - historyStart);
+			for(int lane = 0; lane < numLanes; ++lane)
+			{
+				float* pWriteData = m_beatBuffer.getWritePointer(lane);
+				FloatVectorOperations::copy(pWriteData, m_triggerHistoryBuffer.getReadPointer(lane, historyStart), numFirstSamples);
+				FloatVectorOperations::copy(pWriteData + numFirstSamples, m_triggerHistoryBuffer.getReadPointer(lane), m_numTriggerWindowSamples - numFirstSamples);
+			}
+
+			m_triggerWindowEnd = -1;
+			finishBeat();
+		}
+
+		position += numChunkSamples;
+	}
+}
+
+
+bool KickFaceAudioProcessor::startTriggeredCapture(int64 windowStart)
+{
+	// triggers arriving while a window is still filling are dropped, as are shared ones whose window has already
+	// passed. The length is fixed here so changing it part way through a window can't tear it.
+	if(m_triggerWindowEnd >= 0)
+		return false;
+
+	const int maxWindowSamples = jmax(1, m_triggerHistoryBuffer.getNumSamples() - TRIGGER_CAPTURE_CHUNK_SIZE);
+	const int numWindowSamples = jlimit(1, maxWindowSamples, roundDoubleToInt((float)m_captureLengthValue.getValue() * 0.001 * m_sampleRate));
+	const int numOffsetSamples = jmax(0, roundDoubleToInt((float)m_captureOffsetValue.getValue() * 0.001 * m_sampleRate));
+	const int64 windowEnd = windowStart + numOffsetSamples + numWindowSamples;
+	if(windowEnd < m_triggerClock)
+		return false;
+
+	m_triggerWindowEnd = windowEnd;
+	m_numTriggerWindowSamples = numWindowSamples;
+	return true;
+}
+
+
+void KickFaceAudioProcessor::finishBeat()
+{
+	++m_beatNumber;
+	m_beatHistory.push(m_beatBuffer.getReadPointer(getListenLane()), m_beatBuffer.getNumSamples(), m_beatNumber, getListenLane());
+}
+
+
+XmlElement* KickFaceAudioProcessor::createBeatSnapshotXml() const
+{
+	// the newest beat in the history, unless nothing has been captured since the session was restored, in which
+	// case the restored snapshot goes back out as it came in rather than losing detail each time it's saved
+	int64 beatNumber = -1;
+	int lane = 0;
+	std::vector<float> samples;
+	const int newestSlot = m_beatHistory.getNewestSlot();
+	if(newestSlot < 0 || !m_beatHistory.readSlot(newestSlot, beatNumber, samples, &lane) || beatNumber == m_restoredBeatNumber.get())
+	{
+		const ScopedLock lock(m_restoredSnapshotLock);
+		return m_pRestoredSnapshotXml ? new XmlElement(*m_pRestoredSnapshotXml) : nullptr;
+	}
+
+	// longer beats are averaged down to the point limit, which keeps everything up to the low mids the display
+	// and alignment look at
+	const int numSamples = (int)samples.size();
+	const int decimationFactor = (numSamples + STATE_BEAT_SNAPSHOT_MAX_POINTS - 1) / STATE_BEAT_SNAPSHOT_MAX_POINTS;
+	MemoryOutputStream pointStream;
+	for(int start = 0; start < numSamples; start += decimationFactor)
+	{
+		const int end = jmin(start + decimationFactor, numSamples);
+		float sum = 0.0f;
+		for(int i = start; i < end; ++i)
+			sum += samples[i];
+
+		pointStream.writeShort((short)Math::floatToHalf(sum / (end - start)));
+	}
+
+	XmlElement* pSnapshotXml = new XmlElement("BeatSnapshot");
+	pSnapshotXml->setAttribute("NumSamples", numSamples);
+	pSnapshotXml->setAttribute("SampleRate", m_sampleRate);
+	pSnapshotXml->setAttribute("Lane", lane);
+	pSnapshotXml->setAttribute("Points", pointStream.getMemoryBlock().toBase64Encoding());
+	return pSnapshotXml;
+}
+
+
+void KickFaceAudioProcessor::restoreBeatSnapshot(const XmlElement& snapshotXml)
+{
+	MemoryBlock pointData;
+	const int numSamples = snapshotXml.getIntAttribute("NumSamples");
+	const double sampleRate = snapshotXml.getDoubleAttribute("SampleRate");
+	const int lane = snapshotXml.getIntAttribute("Lane", -1);
+	if(numSamples <= 0 || sampleRate <= 0.0 || lane < 0 || lane >= (int)E_ListenMode::Max || !pointData.fromBase64Encoding(snapshotXml.getStringAttribute("Points")))
+		return;
+
+	const int numPoints = jmin((int)pointData.getSize() / 2, STATE_BEAT_SNAPSHOT_MAX_POINTS, numSamples);
+	if(numPoints <= 0)
+		return;
+
+	{
+		const ScopedLock lock(m_restoredSnapshotLock);
+		m_pRestoredSnapshotXml = new XmlElement(snapshotXml);
+	}
+
+	// only one beat is ever being applied, so the other can always be claimed, and a newer restore replaces one
+	// still waiting rather than the message thread waiting on the audio thread
+	int restoredIndex = 0;
+	while(!m_restoredBeats[restoredIndex].m_state.compareAndSetBool((int)E_RestoredBeatState::Writing, (int)E_RestoredBeatState::Empty)
+		&& !m_restoredBeats[restoredIndex].m_state.compareAndSetBool((int)E_RestoredBeatState::Writing, (int)E_RestoredBeatState::Ready))
+		restoredIndex = 1 - restoredIndex;
+
+	m_restoredBeats[1 - restoredIndex].m_state.compareAndSetBool((int)E_RestoredBeatState::Empty, (int)E_RestoredBeatState::Ready);
+
+	RestoredBeat& restoredBeat = m_restoredBeats[restoredIndex];
+	MemoryInputStream pointStream(pointData, false);
+	restoredBeat.m_points.resize(numPoints);
+	for(int i = 0; i < numPoints; ++i)
+		restoredBeat.m_points[i] = Math::halfToFloat((uint16)pointStream.readShort());
+
+	restoredBeat.m_numSamples = numSamples;
+	restoredBeat.m_sampleRate = sampleRate;
+	restoredBeat.m_state.set((int)E_RestoredBeatState::Ready);
+}
+
+
+void KickFaceAudioProcessor::updateRestoredBeat(bool isReapplying)
+{
+	// a newly restored beat is always applied, the one already applied only when the beat buffer has been reset.
+	// The message thread never leaves both ready at once.
+	int restoredIndex = 0;
+	if(m_restoredBeats[0].m_state.compareAndSetBool((int)E_RestoredBeatState::Applying, (int)E_RestoredBeatState::Ready))
+		restoredIndex = 0;
+	else if(m_restoredBeats[1].m_state.compareAndSetBool((int)E_RestoredBeatState::Applying, (int)E_RestoredBeatState::Ready))
+		restoredIndex = 1;
+	else if(isReapplying && m_isHoldingRestoredBeat && m_restoredBeats[m_appliedRestoredBeat].m_state.compareAndSetBool((int)E_RestoredBeatState::Applying, (int)E_RestoredBeatState::Empty))
+		restoredIndex = m_appliedRestoredBeat;
+	else
+		return;
+
+	// the points are stretched back over the beat at the current sample rate, cut short to the size prepareToPlay
+	// allocated so applying never allocates. Only one lane was saved, so it stands in for all of them until the
+	// host plays.
+	const RestoredBeat& restoredBeat = m_restoredBeats[restoredIndex];
+	const int numPoints = (int)restoredBeat.m_points.size();
+	const int numSamples = jmin(roundDoubleToInt(restoredBeat.m_numSamples * m_sampleRate / restoredBeat.m_sampleRate), m_maxBeatBufferSamples);
+	if(numPoints > 0 && numSamples > 0)
+	{
+		m_beatBuffer.setSize((int)E_ListenMode::Max, numSamples, false, true, true);
+
+		float* pWriteData = m_beatBuffer.getWritePointer(0);
+		const double pointsPerSample = (double)numPoints / numSamples;
+		for(int i = 0; i < numSamples; ++i)
+		{
+			const double position = jlimit(0.0, (double)(numPoints - 1), (i + 0.5) * pointsPerSample - 0.5);
+			const int pointIndex = jmin((int)position, jmax(numPoints - 2, 0));
+			const int nextPointIndex = jmin(pointIndex + 1, numPoints - 1);
+			pWriteData[i] = restoredBeat.m_points[pointIndex] + (float)(position - pointIndex) * (restoredBeat.m_points[nextPointIndex] - restoredBeat.m_points[pointIndex]);
+		}
+
+		for(int lane = 1; lane < m_beatBuffer.getNumChannels(); ++lane)
+			FloatVectorOperations::copy(m_beatBuffer.getWritePointer(lane), pWriteData, numSamples);
+
+		m_beatBufferPosition = 0;
+		m_appliedRestoredBeat = restoredIndex;
+		finishBeat();
+		m_restoredBeatNumber.set(m_beatNumber);
+		m_isHoldingRestoredBeat = true;
+	}
+
+	m_restoredBeats[restoredIndex].m_state.set((int)E_RestoredBeatState::Empty);
+}
+
+
+int KickFaceAudioProcessor::findFirstNoteOn(const MidiBuffer& midiMessages, int chunkStart, int numSamples, int numBlockSamples)
+{
+	// events are read as raw bytes so nothing is copied, a note-on with zero velocity is a note-off. Events are in
+	// time order, and any outside the block count as its first or last sample.
+	MidiBuffer::Iterator iterator(midiMessages);
+	const uint8* pData = nullptr;
+	int numBytes = 0;
+	int samplePosition = 0;
+	while(iterator.getNextEvent(pData, numBytes, samplePosition))
+	{
+		const int blockSample = jlimit(0, numBlockSamples - 1, samplePosition);
+		if(blockSample >= chunkStart + numSamples)
+			break;
+
+		if(blockSample >= chunkStart && numBytes >= 3 && (pData[0] & 0xf0) == 0x90 && pData[2] > 0)
+			return blockSample - chunkStart;
+	}
+
+	return -1;
+}
+
+
+void KickFaceAudioProcessor::splitCaptureLanes(const float* pLeft, const float* pRight, float* const* pLanes, int numSamples)
+{
+	float* pLeftLane = pLanes[(int)E_ListenMode::LeftChannelOnly];
+	float* pRightLane = pLanes[(int)E_ListenMode::RightChannelOnly];
+	float* pSumLane = pLanes[(int)E_ListenMode::SumLeftAndRightChannels];
+	int i = 0;
+
+#if PLUGINPROCESSOR_USE_SSE2
+	// each input sample is loaded once and all three lanes are stored from registers
+	const __m128 half = _mm_set1_ps(0.5f);
+	for(; i + 4 <= numSamples; i += 4)
+	{
+		const __m128 left = _mm_loadu_ps(pLeft + i);
+		const __m128 right = _mm_loadu_ps(pRight + i);
+		_mm_storeu_ps(pLeftLane + i, left);
+		_mm_storeu_ps(pRightLane + i, right);
+		_mm_storeu_ps(pSumLane + i, _mm_mul_ps(_mm_add_ps(left, right), half));
+	}
+#endif
+
+	for(; i < numSamples; ++i)
+	{
+		pLeftLane[i] = pLeft[i];
+		pRightLane[i] = pRight[i];
+		pSumLane[i] = 0.5f * (pLeft[i] + pRight[i]);
+	}
+}
+
+
 bool KickFaceAudioProcessor::hasEditor() const
 {
     return true; // (change this to false if you choose to not supply an editor)
@@ -403,6 +830,10 @@ void KickFaceAudioProcessor::getStateInformation(MemoryBlock& destData)
 	pXml->setAttribute("GuiWidth", m_guiWidth);
 	pXml->setAttribute("GuiHeight", m_guiHeight);
 	pXml->addChildElement(m_parameters.state.createXml());
+#if STATE_BEAT_SNAPSHOT
+	if(juce::XmlElement* pSnapshotXml = createBeatSnapshotXml())
+		pXml->addChildElement(pSnapshotXml);
+#endif
 	copyXmlToBinary(*pXml, destData);
 }
 
@@ -428,13 +859,21 @@ void KickFaceAudioProcessor::setStateInformation(const void* data, int sizeInByt
 				juce::XmlElement* pChildElement = pXml->getChildElement(childIndex);
 				if(pChildElement->hasTagName(m_parameters.state.getType()))
 					m_parameters.state = ValueTree::fromXml(*pChildElement);
+#if STATE_BEAT_SNAPSHOT
+				else if(pChildElement->hasTagName("BeatSnapshot"))
+					restoreBeatSnapshot(*pChildElement);
+#endif
 			}
 		}
 	}
 
 	m_delayValue.referTo(m_parameters.getParameterAsValue("delay"));
 	m_invertPhaseValue.referTo(m_parameters.getParameterAsValue("invertPhase"));
+	m_phaseRotationValue.referTo(m_parameters.getParameterAsValue("phaseRotation"));
 	m_listenModeValue.referTo(m_parameters.getParameterAsValue("listenMode"));
+	m_captureModeValue.referTo(m_parameters.getParameterAsValue("captureMode"));
+	m_captureLengthValue.referTo(m_parameters.getParameterAsValue("captureLength"));
+	m_captureOffsetValue.referTo(m_parameters.getParameterAsValue("captureOffset"));
 }
 
 
@@ -450,6 +889,78 @@ int64 KickFaceAudioProcessor::getBeatBufferPosition() const
 }
 
 
+int KickFaceAudioProcessor::getListenLane() const
+{
+	return jlimit(0, (int)E_ListenMode::Max - 1, roundFloatToInt((float)m_listenModeValue.getValue()));
+}
+
+
+int64 KickFaceAudioProcessor::getBeatNumber() const
+{
+	return m_beatNumber * (int64)E_ListenMode::Max + getListenLane();
+}
+
+
+void KickFaceAudioProcessor::designAlignmentFilter(KickFaceAudioProcessor* pRemoteProcessor)
+{
+	// the beats are copied here so the designer never reads a buffer the audio thread is writing, both are
+	// captured as their delay lines play them
+	AlignmentFilterDesigner::Request request;
+	request.m_sampleRate = m_sampleRate;
+
+	KickFaceAudioProcessor* pProcessors[2] = { this, pRemoteProcessor };
+	AlignmentFilterDesigner::Beat* pBeats[2] = { &request.m_localBeat, &request.m_remoteBeat };
+	for(int i = 0; i < 2; ++i)
+	{
+		pBeats[i]->m_delaySamples = 0;
+		pBeats[i]->m_sampleSign = 1.0f;
+
+		AudioSampleBuffer* pBeatBuffer = pProcessors[i] ? pProcessors[i]->getBeatBuffer() : nullptr;
+		if(pBeatBuffer && pBeatBuffer->getNumSamples() > 0)
+		{
+			const float* pReadData = pBeatBuffer->getReadPointer(pProcessors[i]->getListenLane());
+			pBeats[i]->m_samples.assign(pReadData, pReadData + pBeatBuffer->getNumSamples());
+			pBeats[i]->m_delaySamples = roundFloatToInt((float)pProcessors[i]->getDelayValue().getValue());
+			pBeats[i]->m_sampleSign = (float)pProcessors[i]->getInvertPhaseValue().getValue() > 0.5f ? -1.0f : 1.0f;
+		}
+	}
+
+	m_alignmentFilterDesigner.submitRequest(request);
+}
+
+
+SummationMeter::Reading KickFaceAudioProcessor::measureLowEndSummation(KickFaceAudioProcessor* pRemoteProcessor)
+{
+	// the meter keeps its low passed copies of both beats, so the live buffers are only read when a new beat
+	// has been captured
+	const ScopedLock lock(m_summationMeterLock);
+	m_summationMeter.prepare(m_sampleRate);
+
+	SummationMeter::Placement placements[2];
+	KickFaceAudioProcessor* pProcessors[2] = { this, pRemoteProcessor };
+	for(int i = 0; i < 2; ++i)
+	{
+		placements[i].m_beatIndex = i;
+		placements[i].m_delaySamples = 0;
+		placements[i].m_sampleSign = 1.0f;
+
+		AudioSampleBuffer* pBeatBuffer = pProcessors[i] ? pProcessors[i]->getBeatBuffer() : nullptr;
+		if(pBeatBuffer && pBeatBuffer->getNumSamples() > 0)
+		{
+			m_summationMeter.updateBeat(i, pProcessors[i]->getInstanceId(), pProcessors[i]->getBeatNumber(), pBeatBuffer->getReadPointer(pProcessors[i]->getListenLane()), pBeatBuffer->getNumSamples());
+			placements[i].m_delaySamples = roundFloatToInt((float)pProcessors[i]->getDelayValue().getValue());
+			placements[i].m_sampleSign = (float)pProcessors[i]->getInvertPhaseValue().getValue() > 0.5f ? -1.0f : 1.0f;
+		}
+		else
+		{
+			m_summationMeter.updateBeat(i, -1, -1, nullptr, 0);
+		}
+	}
+
+	return m_summationMeter.measure(placements[0], placements[1]);
+}
+
+
 uint32 KickFaceAudioProcessor::getErrorState() const
 {
 	return m_errorState;
@@ -563,6 +1074,32 @@ float KickFaceAudioProcessor::textToListenMode(const String& text)
 }
 
 
+String KickFaceAudioProcessor::captureModeToText(float value)
+{
+	int valueInt = juce::roundFloatToInt(value);
+	switch(valueInt)
+	{
+	case (int)E_CaptureMode::TempoGrid: return "Tempo";
+	case (int)E_CaptureMode::Onsets: return "Onsets";
+	case (int)E_CaptureMode::FollowTriggers: return "Follow";
+	case (int)E_CaptureMode::MidiNotes: return "Midi";
+	case (int)E_CaptureMode::TempoGridWindow: return "Window";
+	}
+	return "Tempo";
+}
+
+
+float KickFaceAudioProcessor::textToCaptureMode(const String& text)
+{
+	if(text == "Tempo") { return (float)E_CaptureMode::TempoGrid; }
+	if(text == "Onsets") { return (float)E_CaptureMode::Onsets; }
+	if(text == "Follow") { return (float)E_CaptureMode::FollowTriggers; }
+	if(text == "Midi") { return (float)E_CaptureMode::MidiNotes; }
+	if(text == "Window") { return (float)E_CaptureMode::TempoGridWindow; }
+	return 0.0f;
+}
+
+
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
@@ -1,8 +1,15 @@
 #pragma once
 
 
-#include "../JuceLibraryCode/JuceHeader.h"
+#include "JuceHeader.h"
 #include "ToneGenerator.h"
+#include "PhaseRotator.h"
+#include "PartitionedConvolver.h"
+#include "AlignmentFilterDesigner.h"
+#include "SummationMeter.h"
+#include "OnsetDetector.h"
+#include "TempoTracker.h"
+#include "BeatHistory.h"
 
 
 #define USE_PLUGIN_HOST 0
@@ -11,6 +18,22 @@
 
 #define DEFAULT_BPM 100
 #define SAMPLE_DELAY_RANGE 2000 
+#define PHASE_ROTATION_RANGE 180
+#define ALIGNMENT_FILTER_BLOCK_SIZE 256
+#define ONSET_CAPTURE_PRE_SECONDS 0.02
+#define TRIGGER_CAPTURE_CHUNK_SIZE 256
+#define CAPTURE_LENGTH_MIN_MS 20
+#define CAPTURE_LENGTH_MAX_MS 1000
+#define CAPTURE_LENGTH_DEFAULT_MS 400
+#define CAPTURE_OFFSET_MAX_MS 1000
+#define CAPTURE_MIN_BPM 30.0
+#define BEAT_HISTORY_SIZE 8
+#define BEAT_HISTORY_MAX_SECONDS 2.0
+#define BEAT_HISTORY_HALF_FLOATS 1
+// the state carries the last beat as at most STATE_BEAT_SNAPSHOT_MAX_POINTS half floats, a little under 11KB
+// once base64 encoded, so waveforms are back as soon as a session opens rather than after a beat has played
+#define STATE_BEAT_SNAPSHOT 1
+#define STATE_BEAT_SNAPSHOT_MAX_POINTS 4096
 #define PROCESS_INSTANCE_ID_START 2
 
 #define DEFAULT_WIDTH 420
@@ -41,6 +64,22 @@ enum class E_ListenMode
 
 
 
+// the beat buffer either follows the host's beat grid or holds a fixed window started by a trigger: a kick
+// onset in this instance's input, a midi note-on sent to it, or whichever trigger another instance last captured.
+// The grid can also be narrowed to a window, every window starting the capture offset after its beat or trigger.
+enum class E_CaptureMode
+{
+	TempoGrid = 0,
+	Onsets = 1,
+	FollowTriggers = 2,
+	MidiNotes = 3,
+	TempoGridWindow = 4,
+
+	Max
+};
+
+
+
 class KickFaceAudioProcessor : public AudioProcessor
 {
 public:
@@ -74,12 +113,30 @@ public:
     void getStateInformation(MemoryBlock& destData) override;
     void setStateInformation(const void* data, int sizeInBytes) override;
 
+	// holds a channel for each listen mode, captured together so switching between them is immediate
 	AudioSampleBuffer* getBeatBuffer();
 	int64 getBeatBufferPosition() const;
+	// the beat buffer channel for the current listen mode
+	int getListenLane() const;
+	// changes every time a new beat is captured or a different lane is listened to, so readers can tell their
+	// copy of the listened lane is stale
+	int64 getBeatNumber() const;
+	// the last few beats of the listened lane, oldest overwritten first
+	const BeatHistory& getBeatHistory() const { return m_beatHistory; }
 
 	Value& getDelayValue() { return m_delayValue; }
 	Value& getInvertPhaseValue() { return m_invertPhaseValue; }
+	Value& getPhaseRotationValue() { return m_phaseRotationValue; }
 	Value& getListenModeValue() { return m_listenModeValue; }
+	Value& getCaptureModeValue() { return m_captureModeValue; }
+	Value& getCaptureLengthValue() { return m_captureLengthValue; }
+	Value& getCaptureOffsetValue() { return m_captureOffsetValue; }
+
+	// designs a filter that matches this instance's low end to the remote's, null goes back to the plain delay
+	void designAlignmentFilter(KickFaceAudioProcessor* pRemoteProcessor);
+	// how much the low end of this instance and the remote gain or lose summed as they're currently aligned,
+	// cheap enough to poll and safe to call from any thread other than the audio thread
+	SummationMeter::Reading measureLowEndSummation(KickFaceAudioProcessor* pRemoteProcessor);
 	
 	int getGuiWidth() { return m_guiWidth; }
 	int getGuiHeight() { return m_guiHeight; }
@@ -95,10 +152,23 @@ private:
 	void generateInstanceId();
 	void generateGivenName();
 
+	void captureChunk(const float* pLeft, const float* pRight, int numSamples, const MidiBuffer& midiMessages, int chunkStart, int numBlockSamples, const AudioPlayHead::CurrentPositionInfo* pPosInfo);
+	void captureBeatGrid(const AudioSampleBuffer& captureLanes, int numSamples, double bpm, bool isWindowed);
+	void captureTriggeredWindows(const AudioSampleBuffer& captureLanes, int numSamples, int triggerSample, int numPreSamples, const AudioPlayHead::CurrentPositionInfo* pPlayingPosInfo, bool followShared);
+	bool startTriggeredCapture(int64 windowStart);
+	void finishBeat();
+	XmlElement* createBeatSnapshotXml() const;
+	void restoreBeatSnapshot(const XmlElement& snapshotXml);
+	void updateRestoredBeat(bool isReapplying);
+	static int findFirstNoteOn(const MidiBuffer& midiMessages, int chunkStart, int numSamples, int numBlockSamples);
+	static void splitCaptureLanes(const float* pLeft, const float* pRight, float* const* pLanes, int numSamples);
+
 	static String invertPhaseToText(float value);
 	static float textToInvertPhase(const String& text);
 	static String listenModeToText(float value);
 	static float textToListenMode(const String& text);
+	static String captureModeToText(float value);
+	static float textToCaptureMode(const String& text);
 
 #if USE_LOGGING
 	ScopedPointer<juce::FileLogger> m_pFileLogger;
@@ -109,15 +179,40 @@ private:
 	AudioProcessorValueTreeState m_parameters;
 	Value m_delayValue;
 	Value m_invertPhaseValue;
+	Value m_phaseRotationValue;
 	Value m_listenModeValue; 
+	Value m_captureModeValue;
+	Value m_captureLengthValue;
+	Value m_captureOffsetValue;
 	String m_givenName;
 
 	double m_sampleRate;
 
 	AudioSampleBuffer m_beatBuffer;
 	int64 m_beatBufferPosition;
+	int64 m_beatNumber;
+	int m_maxBeatBufferSamples;
+	BeatHistory m_beatHistory;
+	AudioSampleBuffer m_captureBuffer;
+	int m_maxCaptureChunkSamples;
+	OnsetDetector m_onsetDetector;
+	std::vector<float> m_noveltyBuffer;
+	TempoTracker m_tempoTracker;
+	int64 m_trackerTimeInSamples;
+	AudioSampleBuffer m_triggerHistoryBuffer;
+	int m_triggerHistoryPosition;
+	int m_numOnsetPreSamples;
+	int64 m_triggerClock;
+	int64 m_triggerWindowEnd;
+	int m_numTriggerWindowSamples;
+	int64 m_lastSharedCaptureStart;
 	AudioSampleBuffer m_delayBuffer;
 	int m_delayBufferPosition;
+	PhaseRotator m_phaseRotator;
+	PartitionedConvolver m_alignmentConvolver;
+	AlignmentFilterDesigner m_alignmentFilterDesigner;
+	CriticalSection m_summationMeterLock;
+	SummationMeter m_summationMeter;
 	int64 m_timeInSamples;
 
 	int m_guiWidth;
@@ -132,7 +227,35 @@ private:
 	WeakReference<KickFaceAudioProcessor>::Master masterReference;
 	friend class WeakReference<KickFaceAudioProcessor>;
 
+	// the message thread decodes a restored beat into whichever of the two isn't being applied, so a restore is
+	// never dropped, and only writes one while it's empty or ready. Whichever thread moves one from ready to
+	// applying owns it until it's back to empty.
+	enum class E_RestoredBeatState
+	{
+		Empty = 0,
+		Writing = 1,
+		Ready = 2,
+		Applying = 3
+	};
+
+	struct RestoredBeat
+	{
+		Atomic<int> m_state;
+		std::vector<float> m_points;
+		int m_numSamples;
+		double m_sampleRate;
+	};
+
+	RestoredBeat m_restoredBeats[2];
+	int m_appliedRestoredBeat;
+	Atomic<int64> m_restoredBeatNumber;
+	bool m_isHoldingRestoredBeat;
+	CriticalSection m_restoredSnapshotLock;
+	ScopedPointer<XmlElement> m_pRestoredSnapshotXml;
+
 	static String s_nameDefs[];
+	// host time the last window started by an instance's own onsets or midi notes begins at, -1 before any
+	static Atomic<int64> s_sharedCaptureStart;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(KickFaceAudioProcessor)
 };
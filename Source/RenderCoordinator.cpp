@@ -0,0 +1,210 @@
+#include "RenderCoordinator.h"
+
+
+#define RENDERCOORDINATOR_DEFAULT_BUDGET 250.0
+#define RENDERCOORDINATOR_MIN_FRAME_RATE 4
+#define RENDERCOORDINATOR_MAX_FRAME_RATE 60
+#define RENDERCOORDINATOR_PRIORITY_WEIGHT 4.0
+#define RENDERCOORDINATOR_MIN_RENDER_TIME 0.05
+#define RENDERCOORDINATOR_SMOOTHING 0.1
+#define RENDERCOORDINATOR_BUDGET_SETTING "renderBudget"
+
+
+
+RenderCoordinator* RenderCoordinator::s_pInstance = nullptr;
+Atomic<double> RenderCoordinator::s_renderBudget(RENDERCOORDINATOR_DEFAULT_BUDGET);
+
+
+
+RenderCoordinator::Client::Client()
+	: m_averageRenderMicroseconds(0)
+	, m_pendingCostMicroseconds(0)
+	, m_lastRenderTriggerTime(0.0)
+{
+}
+
+
+void RenderCoordinator::Client::reportRenderTime(double milliseconds)
+{
+	milliseconds += m_pendingCostMicroseconds.exchange(0) / 1000.0;
+
+	// smooth the reported time so a single slow frame doesn't throttle the client
+	const double prevAverage = getAverageRenderTime();
+	const double nextAverage = (prevAverage > 0.0) ? prevAverage + (milliseconds - prevAverage) * RENDERCOORDINATOR_SMOOTHING : milliseconds;
+	m_averageRenderMicroseconds.set(roundToInt(nextAverage * 1000.0));
+}
+
+
+void RenderCoordinator::Client::addRenderCost(double milliseconds)
+{
+	m_pendingCostMicroseconds += roundToInt(milliseconds * 1000.0);
+}
+
+
+double RenderCoordinator::Client::getAverageRenderTime() const
+{
+	return m_averageRenderMicroseconds.get() / 1000.0;
+}
+
+
+
+
+
+RenderCoordinator::RenderCoordinator()
+	: m_nextClientIndex(0)
+{
+	// pick up the budget last chosen in any session, it may have been changed by another process since
+	PropertiesFile settings(getSettingsOptions());
+	s_renderBudget.set(jmax(1.0, settings.getDoubleValue(RENDERCOORDINATOR_BUDGET_SETTING, RENDERCOORDINATOR_DEFAULT_BUDGET)));
+
+	startTimerHz(RENDERCOORDINATOR_MAX_FRAME_RATE);
+}
+
+
+RenderCoordinator::~RenderCoordinator()
+{
+	stopTimer();
+}
+
+
+void RenderCoordinator::addClient(Client* pClient)
+{
+	if(pClient == nullptr)
+		return;
+
+	if(s_pInstance == nullptr)
+		s_pInstance = new RenderCoordinator();
+
+	std::vector<WeakReference<Client>>& clients = s_pInstance->m_clients;
+	for(int i = 0; i < clients.size(); ++i)
+		if(clients[i].get() == pClient)
+			return;
+
+	pClient->m_lastRenderTriggerTime = 0.0;
+	clients.push_back(pClient);
+}
+
+
+void RenderCoordinator::removeClient(Client* pClient)
+{
+	if(pClient == nullptr || s_pInstance == nullptr)
+		return;
+
+	std::vector<WeakReference<Client>>& clients = s_pInstance->m_clients;
+	for(int i = 0; i < clients.size(); ++i)
+	{
+		if(clients[i].get() == pClient || clients[i].get() == nullptr)
+		{
+			clients[i] = clients[clients.size() - 1];
+			clients.pop_back();
+			--i;
+		}
+	}
+
+	if(clients.size() == 0)
+	{
+		delete s_pInstance;
+		s_pInstance = nullptr;
+	}
+}
+
+
+void RenderCoordinator::setRenderBudget(double millisecondsPerSecond)
+{
+	s_renderBudget.set(jmax(1.0, millisecondsPerSecond));
+
+	PropertiesFile settings(getSettingsOptions());
+	settings.setValue(RENDERCOORDINATOR_BUDGET_SETTING, s_renderBudget.get());
+	settings.saveIfNeeded();
+}
+
+
+double RenderCoordinator::getRenderBudget()
+{
+	return s_renderBudget.get();
+}
+
+
+PropertiesFile::Options RenderCoordinator::getSettingsOptions()
+{
+	PropertiesFile::Options options;
+	options.applicationName = "KickFace";
+	options.filenameSuffix = "settings";
+	options.osxLibrarySubFolder = "Application Support";
+	return options;
+}
+
+
+void RenderCoordinator::timerCallback()
+{
+	const int numClients = (int)m_clients.size();
+	if(numClients == 0)
+		return;
+
+	// gather the cost and weight of every visible client, the vectors only allocate when a client is added
+	m_frameRates.assign(numClients, 0.0);
+	m_renderTimes.assign(numClients, 0.0);
+	m_weights.assign(numClients, 0.0);
+	double totalWeight = 0.0;
+	for(int i = 0; i < numClients; ++i)
+	{
+		Client* pClient = m_clients[i].get();
+		if(pClient && pClient->isRenderVisible())
+		{
+			m_renderTimes[i] = jmax(RENDERCOORDINATOR_MIN_RENDER_TIME, pClient->getAverageRenderTime());
+			m_weights[i] = pClient->hasRenderPriority() ? RENDERCOORDINATOR_PRIORITY_WEIGHT : 1.0;
+			totalWeight += m_weights[i];
+		}
+	}
+
+	// share the budget by weight, handing whatever a cheap client doesn't need on to the others
+	double remainingBudget = s_renderBudget.get();
+	bool budgetReleased = true;
+	while(budgetReleased && totalWeight > 0.0)
+	{
+		budgetReleased = false;
+		for(int i = 0; i < numClients; ++i)
+		{
+			if(m_weights[i] <= 0.0 || m_frameRates[i] > 0.0)
+				continue;
+
+			const double requiredBudget = RENDERCOORDINATOR_MAX_FRAME_RATE * m_renderTimes[i];
+			if(requiredBudget <= remainingBudget * m_weights[i] / totalWeight)
+			{
+				m_frameRates[i] = RENDERCOORDINATOR_MAX_FRAME_RATE;
+				remainingBudget -= requiredBudget;
+				totalWeight -= m_weights[i];
+				budgetReleased = true;
+			}
+		}
+	}
+
+	for(int i = 0; i < numClients; ++i)
+	{
+		if(m_weights[i] > 0.0 && m_frameRates[i] <= 0.0)
+		{
+			const double share = jmax(0.0, remainingBudget) * m_weights[i] / totalWeight;
+			m_frameRates[i] = jlimit<double>(RENDERCOORDINATOR_MIN_FRAME_RATE, RENDERCOORDINATOR_MAX_FRAME_RATE, share / m_renderTimes[i]);
+		}
+	}
+
+	// trigger clients whose frame interval has elapsed, starting at a rotating index so no client is always first
+	const double now = Time::getMillisecondCounterHiRes();
+	const double timerInterval = 1000.0 / RENDERCOORDINATOR_MAX_FRAME_RATE;
+	for(int n = 0; n < numClients; ++n)
+	{
+		const int i = (m_nextClientIndex + n) % numClients;
+		Client* pClient = m_clients[i].get();
+		if(pClient == nullptr || m_frameRates[i] <= 0.0)
+			continue;
+
+		const double frameInterval = 1000.0 / m_frameRates[i];
+		if(now - pClient->m_lastRenderTriggerTime >= frameInterval - 0.5 * timerInterval)
+		{
+			pClient->m_lastRenderTriggerTime = now;
+			pClient->triggerRender();
+		}
+	}
+
+	m_nextClientIndex = (m_nextClientIndex + 1) % numClients;
+}
\ No newline at end of file
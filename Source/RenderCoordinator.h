@@ -0,0 +1,66 @@
+#pragma once
+
+
+#include "JuceHeader.h"
+#include <vector>
+
+
+
+class RenderCoordinator : private Timer
+{
+public:
+	class Client
+	{
+	public:
+		Client();
+		virtual ~Client() { masterReference.clear(); }
+
+		// called on the message thread when the coordinator grants this client a frame
+		virtual void triggerRender() = 0;
+
+		// called on the message thread, clients that aren't visible are never granted frames
+		virtual bool isRenderVisible() const = 0;
+		virtual bool hasRenderPriority() const { return false; }
+
+		// called from the render thread once a frame has been drawn, the report includes any cost added since
+		// the last one so work done for the frame on other threads counts against the budget too
+		void reportRenderTime(double milliseconds);
+		void addRenderCost(double milliseconds);
+		double getAverageRenderTime() const;
+
+		WeakReference<RenderCoordinator::Client>::Master masterReference;
+		friend class WeakReference<RenderCoordinator::Client>;
+
+	private:
+		Atomic<int> m_averageRenderMicroseconds;
+		Atomic<int> m_pendingCostMicroseconds;
+		double m_lastRenderTriggerTime;
+		friend class RenderCoordinator;
+	};
+
+	static void addClient(Client* pClient);
+	static void removeClient(Client* pClient);
+
+	// milliseconds of rendering per second shared by every display in the process, kept in the user's
+	// settings rather than any session since no one instance owns it
+	static void setRenderBudget(double millisecondsPerSecond);
+	static double getRenderBudget();
+
+private:
+	RenderCoordinator();
+	~RenderCoordinator();
+
+	void timerCallback() override;
+	static PropertiesFile::Options getSettingsOptions();
+
+	std::vector<WeakReference<Client>> m_clients;
+	std::vector<double> m_frameRates;
+	std::vector<double> m_renderTimes;
+	std::vector<double> m_weights;
+	int m_nextClientIndex;
+
+	static RenderCoordinator* s_pInstance;
+	static Atomic<double> s_renderBudget;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RenderCoordinator)
+};
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+
+
+#include "JuceHeader.h"
+
+
+// pasted into the wave shader source, so it has to stay a plain number
+#define DISPLAYSHADERS_NUM_COLOURS 17
+
+
+
+// edge is 0 on the outer edge of the waveform rising to 1 at the baseline, its screen space gradient
+// gives the distance to the edge in pixels so coverage ramps across the extra pixel the mesh is padded by.
+// Each vertex picks its colour by layer so every waveform can be drawn from one strip.
+const char* const gQuadMeshVertexShaderSource = 
+"attribute vec2 v_position;\
+attribute float v_edge;\
+attribute float v_layer;\
+\
+uniform vec4 layerColours[" JUCE_STRINGIFY(DISPLAYSHADERS_NUM_COLOURS) "];\
+\
+varying float f_edge;\
+varying vec4 f_colour;\
+\
+void main()\
+{\
+	gl_Position = vec4(v_position, 0.5f, 1.0f);\
+	f_edge = v_edge;\
+	f_colour = layerColours[int(v_layer)];\
+}";
+
+
+const char* const gQuadMeshFragmentShaderSource = 
+"varying float f_edge;\
+varying vec4 f_colour;\
+\
+void main()\
+{\
+	float edgePixels = f_edge / max(fwidth(f_edge), 0.000001f);\
+	gl_FragColor = vec4(f_colour.rgb, f_colour.a * clamp(edgePixels - 0.5f, 0.0f, 1.0f));\
+}";
+
+
+
+// copies the accumulated earlier beats, scaled down by the fade to age them. The fade comes with the vertices
+// since the program is shared with displays rendering on other threads, a uniform set by one could be
+// overwritten by another before it draws.
+const char* const gTextureVertexShaderSource = 
+"attribute vec2 v_position;\
+attribute vec2 v_texCoord;\
+attribute float v_fade;\
+\
+varying vec2 f_texCoord;\
+varying float f_fade;\
+\
+void main()\
+{\
+	gl_Position = vec4(v_position, 0.5f, 1.0f);\
+	f_texCoord = v_texCoord;\
+	f_fade = v_fade;\
+}";
+
+
+const char* const gTextureFragmentShaderSource = 
+"uniform sampler2D accumulation;\
+\
+varying vec2 f_texCoord;\
+varying float f_fade;\
+\
+void main()\
+{\
+	gl_FragColor = texture2D(accumulation, f_texCoord) * f_fade;\
+}";
\ No newline at end of file
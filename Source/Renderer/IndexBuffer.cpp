@@ -1,17 +1,15 @@
 #include "IndexBuffer.h"
 
 
-StaticIndexBuffer::StaticIndexBuffer(OpenGLContext& context)
-	: m_openGLContext(context)
-	, m_indexBuffer(0)
+StaticIndexBuffer::StaticIndexBuffer()
+	: m_indexBuffer(0)
 	, m_numIndices(0)
 {
 }
 
 
-StaticIndexBuffer::StaticIndexBuffer(OpenGLContext& context, const std::vector<GLuint>& indices)
-	: m_openGLContext(context)
-	, m_indexBuffer(0)
+StaticIndexBuffer::StaticIndexBuffer(const std::vector<GLuint>& indices)
+	: m_indexBuffer(0)
 	, m_numIndices(0)
 {
 	initialise(indices);
@@ -20,7 +18,7 @@ StaticIndexBuffer::StaticIndexBuffer(OpenGLContext& context, const std::vector<G
 
 StaticIndexBuffer::~StaticIndexBuffer()
 {
-	m_openGLContext.extensions.glDeleteBuffers(1, &m_indexBuffer);
+	getGLExtensions().glDeleteBuffers(1, &m_indexBuffer);
 }
 
 
@@ -28,12 +26,12 @@ void StaticIndexBuffer::initialise(const std::vector<GLuint>& indices)
 {
 	m_numIndices = indices.size();
 
-	m_openGLContext.extensions.glGenBuffers(1, &m_indexBuffer);
-	m_openGLContext.extensions.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
-	m_openGLContext.extensions.glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+	getGLExtensions().glGenBuffers(1, &m_indexBuffer);
+	getGLExtensions().glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	getGLExtensions().glBufferData(GL_ELEMENT_ARRAY_BUFFER,
 		static_cast<GLsizeiptr>(static_cast<size_t>(m_numIndices) * sizeof(GLuint)),
 		indices.data(), GL_STATIC_DRAW);
-	m_openGLContext.extensions.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	getGLExtensions().glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
 
@@ -45,16 +43,15 @@ GLuint StaticIndexBuffer::getNumIndices() const
 
 void StaticIndexBuffer::bind()
 {
-	m_openGLContext.extensions.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	getGLExtensions().glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
 }
 
 
 
 
 
-DynamicIndexBuffer::DynamicIndexBuffer(OpenGLContext& context, GLuint indexCapacity)
-	: m_openGLContext(context)
-	, m_pIndices(nullptr)
+DynamicIndexBuffer::DynamicIndexBuffer(GLuint indexCapacity)
+	: m_pIndices(nullptr)
 	, m_indexCapacity(0)
 	, m_indexBuffer(0)
 {
@@ -62,19 +59,19 @@ DynamicIndexBuffer::DynamicIndexBuffer(OpenGLContext& context, GLuint indexCapac
 	{
 		m_pIndices = new GLuint[m_indexCapacity];
 
-		m_openGLContext.extensions.glGenBuffers(1, &m_indexBuffer);
-		m_openGLContext.extensions.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
-		m_openGLContext.extensions.glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+		getGLExtensions().glGenBuffers(1, &m_indexBuffer);
+		getGLExtensions().glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+		getGLExtensions().glBufferData(GL_ELEMENT_ARRAY_BUFFER,
 			static_cast<GLsizeiptr>(static_cast<size_t>(m_indexCapacity) * sizeof(GLuint)),
 			m_pIndices, GL_STATIC_DRAW);
-		m_openGLContext.extensions.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		getGLExtensions().glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	}
 }
 
 
 DynamicIndexBuffer::~DynamicIndexBuffer()
 {
-	m_openGLContext.extensions.glDeleteBuffers(1, &m_indexBuffer);
+	getGLExtensions().glDeleteBuffers(1, &m_indexBuffer);
 
 	if(m_pIndices)
 		delete[]m_pIndices;
@@ -100,15 +97,15 @@ void DynamicIndexBuffer::updateIndexArray(GLuint startIndexIndex, GLuint endInde
 
 	if(endIndexIndex > startIndexIndex)
 	{
-		m_openGLContext.extensions.glBindBuffer(GL_ARRAY_BUFFER, m_indexBuffer);
-		m_openGLContext.extensions.glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(sizeof(GLuint) * startIndexIndex),
+		getGLExtensions().glBindBuffer(GL_ARRAY_BUFFER, m_indexBuffer);
+		getGLExtensions().glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(sizeof(GLuint) * startIndexIndex),
 			static_cast<GLsizeiptr>(sizeof(GLuint) * (endIndexIndex - startIndexIndex)), m_pIndices);
-		m_openGLContext.extensions.glBindBuffer(GL_ARRAY_BUFFER, 0);
+		getGLExtensions().glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 }
 
 
 void DynamicIndexBuffer::bind()
 {
-	m_openGLContext.extensions.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	getGLExtensions().glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
 }
\ No newline at end of file
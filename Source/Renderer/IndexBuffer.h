@@ -1,7 +1,7 @@
 #pragma once
 
 
-#include "../../JuceLibraryCode/JuceHeader.h"
+#include "JuceHeader.h"
 #include "ShaderProgram.h"
 #include <vector>
 
@@ -10,8 +10,8 @@
 class StaticIndexBuffer
 {
 public:
-	StaticIndexBuffer(OpenGLContext& context);
-	StaticIndexBuffer(OpenGLContext& context, const std::vector<GLuint>& indices);
+	StaticIndexBuffer();
+	StaticIndexBuffer(const std::vector<GLuint>& indices);
 	~StaticIndexBuffer();
 
 	void initialise(const std::vector<GLuint>& indices);
@@ -19,7 +19,6 @@ public:
 	void bind();
 
 private:
-	OpenGLContext& m_openGLContext;
 	GLuint m_indexBuffer;
 	int m_numIndices;
 };
@@ -31,7 +30,7 @@ private:
 class DynamicIndexBuffer
 {
 public:
-	DynamicIndexBuffer(OpenGLContext& context, GLuint indexCapacity);
+	DynamicIndexBuffer(GLuint indexCapacity);
 	~DynamicIndexBuffer();
 
 	GLuint getIndexCapacity() const;
@@ -41,7 +40,6 @@ public:
 	void bind();
 
 private:
-	OpenGLContext& m_openGLContext;
 	GLuint* m_pIndices;
 	GLuint m_indexCapacity;
 	GLuint m_indexBuffer;
@@ -1,21 +1,14 @@
 #pragma once
 
 
-#include "../../JuceLibraryCode/JuceHeader.h"
+#include "JuceHeader.h"
 #include <vector>
 #include <array>
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
 #include "ShaderProgram.h"
-
-
-
-struct Attribute
-{
-	juce::String m_name;
-	GLuint m_numFloats;
-	GLuint m_floatOffset;
-};
+#include "SharedRenderResources.h"
+#include "VertexArray.h"
 
 
 
@@ -26,25 +19,24 @@ template<class Vertex>
 class StaticMesh
 {
 public:
-	StaticMesh(OpenGLContext& openGLContext, const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, const std::vector<Attribute>& attributes);
+	StaticMesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, const std::vector<Attribute>& attributes);
 
 	void draw(ShaderProgram* pShaderProgram);
 
 private:
-	OpenGLContext& m_openGLContext;
 	StaticVertexBuffer<Vertex> m_vertexBuffer;
 	StaticIndexBuffer m_indexBuffer;
-	std::vector<Attribute> m_attributes;
+	VertexArray m_vertexArray;
+	CriticalSection m_drawLock;
 };
 
 
 
 template<class Vertex>
-StaticMesh<Vertex>::StaticMesh(OpenGLContext& openGLContext, const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, const std::vector<Attribute>& attributes)
-	: m_openGLContext(openGLContext)
-	, m_vertexBuffer(openGLContext, vertices)
-	, m_indexBuffer(openGLContext, indices)
-	, m_attributes(attributes)
+StaticMesh<Vertex>::StaticMesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, const std::vector<Attribute>& attributes)
+	: m_vertexBuffer(vertices)
+	, m_indexBuffer(indices)
+	, m_vertexArray(attributes, sizeof(Vertex), false)
 {
 }
 
@@ -52,25 +44,17 @@ StaticMesh<Vertex>::StaticMesh(OpenGLContext& openGLContext, const std::vector<V
 template<class Vertex>
 void StaticMesh<Vertex>::draw(ShaderProgram* pShaderProgram)
 {
+	// static meshes are shared between contexts so their layout is never captured in a vertex array object
+	const ScopedLock lock(m_drawLock);
+
+	m_vertexArray.bind(pShaderProgram);
 	m_vertexBuffer.bind();
 	m_indexBuffer.bind();
-
-	for(int i = 0; i < m_attributes.size(); ++i)
-	{
-		const Attribute& attribute = m_attributes[i];
-		int attributeId = pShaderProgram->getAttributeIndex(attribute.m_name);
-		m_openGLContext.extensions.glVertexAttribPointer(attributeId, attribute.m_numFloats, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)(sizeof(float) * attribute.m_floatOffset));
-		m_openGLContext.extensions.glEnableVertexAttribArray(attributeId);
-	}
+	m_vertexArray.recordAttributes();
 
 	glDrawElements(GL_TRIANGLES, m_indexBuffer.getNumIndices(), GL_UNSIGNED_INT, 0);
 	
-	for(int i = 0; i < m_attributes.size(); ++i)
-	{
-		const Attribute& attribute = m_attributes[i];
-		int attributeId = pShaderProgram->getAttributeIndex(attribute.m_name);
-		m_openGLContext.extensions.glDisableVertexAttribArray(attributeId);
-	}
+	m_vertexArray.unbind();
 }
 
 
@@ -82,17 +66,19 @@ template<class Vertex>
 class DynamicQuadMesh
 {
 public:
-	DynamicQuadMesh(OpenGLContext& openGLContext, GLuint quadCapacity, const std::vector<Attribute>& attributes);
+	DynamicQuadMesh(GLuint quadCapacity, const std::vector<Attribute>& attributes);
+	~DynamicQuadMesh();
+
+	static StaticIndexBuffer* acquireQuadIndexBuffer(GLuint quadCapacity);
 
 	void setQuad(GLuint quadIndex, const std::array<Vertex, 4>& verts);
 	void draw(ShaderProgram* pShaderProgram);
 	void draw(ShaderProgram* pShaderProgram, GLuint firstQuadIndex, GLuint lastQuadIndex);
 
 private:
-	OpenGLContext& m_openGLContext;
 	DynamicVertexBuffer<Vertex> m_vertexBuffer;
-	StaticIndexBuffer m_indexBuffer;
-	std::vector<Attribute> m_attributes;
+	StaticIndexBuffer* m_pIndexBuffer;
+	OwnedArray<VertexArray> m_vertexArrays;
 
 	GLuint m_firstDirtyQuad;
 	GLuint m_lastDirtyQuad;
@@ -101,28 +87,47 @@ private:
 
 
 template<class Vertex>
-DynamicQuadMesh<Vertex>::DynamicQuadMesh(OpenGLContext& openGLContext, GLuint quadCapacity, const std::vector<Attribute>& attributes)
-	: m_openGLContext(openGLContext)
-	, m_vertexBuffer(openGLContext, quadCapacity * 4)
-	, m_indexBuffer(openGLContext)
-	, m_attributes(attributes)
+DynamicQuadMesh<Vertex>::DynamicQuadMesh(GLuint quadCapacity, const std::vector<Attribute>& attributes)
+	: m_vertexBuffer(quadCapacity * 4)
+	, m_pIndexBuffer(acquireQuadIndexBuffer(quadCapacity))
 	, m_firstDirtyQuad(quadCapacity)
 	, m_lastDirtyQuad(0)
 {
-	GLuint vertIndex = 0;
-	std::vector<GLuint> indicies;
-	indicies.resize(quadCapacity * 6);
-	for(GLuint i = 0; i < quadCapacity * 6; i += 6)
+	// a vertex array object captures the buffer it was recorded with, so keep one per stream
+	for(int i = 0; i < VERTEXBUFFER_NUM_STREAMS; ++i)
+		m_vertexArrays.add(new VertexArray(attributes, sizeof(Vertex), true));
+}
+
+
+template<class Vertex>
+DynamicQuadMesh<Vertex>::~DynamicQuadMesh()
+{
+	SharedRenderResources::release(m_pIndexBuffer);
+}
+
+
+template<class Vertex>
+StaticIndexBuffer* DynamicQuadMesh<Vertex>::acquireQuadIndexBuffer(GLuint quadCapacity)
+{
+	// quad indices only depend on the capacity so every mesh of the same size shares one buffer
+	const int64 key = SharedRenderResources::hashBytes(&quadCapacity, sizeof(quadCapacity), SharedRenderResources::hashString("QuadIndices", 0));
+	return SharedRenderResources::acquire<StaticIndexBuffer>(key, [quadCapacity]()
 	{
-		indicies[i + 0] = vertIndex + 0;
-		indicies[i + 1] = vertIndex + 1;
-		indicies[i + 2] = vertIndex + 2;
-		indicies[i + 3] = vertIndex + 0;
-		indicies[i + 4] = vertIndex + 2;
-		indicies[i + 5] = vertIndex + 3;
-		vertIndex += 4;
-	}
-	m_indexBuffer.initialise(indicies);
+		GLuint vertIndex = 0;
+		std::vector<GLuint> indicies;
+		indicies.resize(quadCapacity * 6);
+		for(GLuint i = 0; i < quadCapacity * 6; i += 6)
+		{
+			indicies[i + 0] = vertIndex + 0;
+			indicies[i + 1] = vertIndex + 1;
+			indicies[i + 2] = vertIndex + 2;
+			indicies[i + 3] = vertIndex + 0;
+			indicies[i + 4] = vertIndex + 2;
+			indicies[i + 5] = vertIndex + 3;
+			vertIndex += 4;
+		}
+		return new StaticIndexBuffer(indicies);
+	});
 }
 
 
@@ -154,7 +159,7 @@ void DynamicQuadMesh<Vertex>::draw(ShaderProgram* pShaderProgram)
 template<class Vertex>
 void DynamicQuadMesh<Vertex>::draw(ShaderProgram* pShaderProgram, GLuint firstQuadIndex, GLuint lastQuadIndex)
 {
-	GLuint quadCapacity = m_indexBuffer.getNumIndices() / 6;
+	GLuint quadCapacity = m_pIndexBuffer->getNumIndices() / 6;
 	if(firstQuadIndex >= quadCapacity) { firstQuadIndex = quadCapacity - 1; }
 	if(lastQuadIndex >= quadCapacity) { lastQuadIndex = quadCapacity - 1; }
 
@@ -167,24 +172,124 @@ void DynamicQuadMesh<Vertex>::draw(ShaderProgram* pShaderProgram, GLuint firstQu
 			m_lastDirtyQuad = 0;
 		}
 
-		m_vertexBuffer.bind();
-		m_indexBuffer.bind();
-
-		for(int i = 0; i < m_attributes.size(); ++i)
+		VertexArray* pVertexArray = m_vertexArrays[m_vertexBuffer.getCurrentStream()];
+		if(!pVertexArray->bind(pShaderProgram))
 		{
-			const Attribute& attribute = m_attributes[i];
-			int attributeId = pShaderProgram->getAttributeIndex(attribute.m_name);
-			m_openGLContext.extensions.glVertexAttribPointer(attributeId, attribute.m_numFloats, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)(sizeof(float) * attribute.m_floatOffset));
-			m_openGLContext.extensions.glEnableVertexAttribArray(attributeId);
+			m_vertexBuffer.bind();
+			m_pIndexBuffer->bind();
+			pVertexArray->recordAttributes();
 		}
 
 		glDrawElements(GL_TRIANGLES, (lastQuadIndex - firstQuadIndex + 1) * 6, GL_UNSIGNED_INT, (void*)(firstQuadIndex * 6 * sizeof(GLuint)));
 
-		for(int i = 0; i < m_attributes.size(); ++i)
+		pVertexArray->unbind();
+	}
+}
+
+
+
+
+
+template<class Vertex>
+class DynamicStripMesh
+{
+public:
+	DynamicStripMesh(GLuint vertexCapacity, const std::vector<Attribute>& attributes);
+
+	GLuint getVertexCapacity() const;
+	void setVertex(GLuint vertexIndex, const Vertex& vert);
+	void setVertices(GLuint firstVertexIndex, const Vertex* pVerts, GLuint numVerts);
+	void draw(ShaderProgram* pShaderProgram);
+	void draw(ShaderProgram* pShaderProgram, GLuint firstVertexIndex, GLuint lastVertexIndex);
+
+private:
+	DynamicVertexBuffer<Vertex> m_vertexBuffer;
+	OwnedArray<VertexArray> m_vertexArrays;
+
+	GLuint m_firstDirtyVertex;
+	GLuint m_lastDirtyVertex;
+};
+
+
+
+template<class Vertex>
+DynamicStripMesh<Vertex>::DynamicStripMesh(GLuint vertexCapacity, const std::vector<Attribute>& attributes)
+	: m_vertexBuffer(vertexCapacity)
+	, m_firstDirtyVertex(vertexCapacity)
+	, m_lastDirtyVertex(0)
+{
+	for(int i = 0; i < VERTEXBUFFER_NUM_STREAMS; ++i)
+		m_vertexArrays.add(new VertexArray(attributes, sizeof(Vertex), true));
+}
+
+
+template<class Vertex>
+GLuint DynamicStripMesh<Vertex>::getVertexCapacity() const
+{
+	return m_vertexBuffer.getVertexCapacity();
+}
+
+
+template<class Vertex>
+void DynamicStripMesh<Vertex>::setVertex(GLuint vertexIndex, const Vertex& vert)
+{
+	if(vertexIndex < m_vertexBuffer.getVertexCapacity())
+	{
+		m_vertexBuffer.getVertexArray()[vertexIndex] = vert;
+
+		m_firstDirtyVertex = jmin<GLuint>(m_firstDirtyVertex, vertexIndex);
+		m_lastDirtyVertex = jmax<GLuint>(m_lastDirtyVertex, vertexIndex);
+	}
+}
+
+
+template<class Vertex>
+void DynamicStripMesh<Vertex>::setVertices(GLuint firstVertexIndex, const Vertex* pVerts, GLuint numVerts)
+{
+	GLuint vertexCapacity = m_vertexBuffer.getVertexCapacity();
+	if(firstVertexIndex < vertexCapacity && numVerts > 0)
+	{
+		numVerts = jmin<GLuint>(numVerts, vertexCapacity - firstVertexIndex);
+		memcpy(m_vertexBuffer.getVertexArray() + firstVertexIndex, pVerts, numVerts * sizeof(Vertex));
+
+		m_firstDirtyVertex = jmin<GLuint>(m_firstDirtyVertex, firstVertexIndex);
+		m_lastDirtyVertex = jmax<GLuint>(m_lastDirtyVertex, firstVertexIndex + numVerts - 1);
+	}
+}
+
+
+template<class Vertex>
+void DynamicStripMesh<Vertex>::draw(ShaderProgram* pShaderProgram)
+{
+	draw(pShaderProgram, 0, m_vertexBuffer.getVertexCapacity() - 1);
+}
+
+
+template<class Vertex>
+void DynamicStripMesh<Vertex>::draw(ShaderProgram* pShaderProgram, GLuint firstVertexIndex, GLuint lastVertexIndex)
+{
+	GLuint vertexCapacity = m_vertexBuffer.getVertexCapacity();
+	if(firstVertexIndex >= vertexCapacity) { firstVertexIndex = vertexCapacity - 1; }
+	if(lastVertexIndex >= vertexCapacity) { lastVertexIndex = vertexCapacity - 1; }
+
+	if(lastVertexIndex >= firstVertexIndex)
+	{
+		if(m_lastDirtyVertex >= m_firstDirtyVertex)
 		{
-			const Attribute& attribute = m_attributes[i];
-			int attributeId = pShaderProgram->getAttributeIndex(attribute.m_name);
-			m_openGLContext.extensions.glDisableVertexAttribArray(attributeId);
+			m_vertexBuffer.updateVertexArray(m_firstDirtyVertex, m_lastDirtyVertex);
+			m_firstDirtyVertex = vertexCapacity;
+			m_lastDirtyVertex = 0;
 		}
+
+		VertexArray* pVertexArray = m_vertexArrays[m_vertexBuffer.getCurrentStream()];
+		if(!pVertexArray->bind(pShaderProgram))
+		{
+			m_vertexBuffer.bind();
+			pVertexArray->recordAttributes();
+		}
+
+		glDrawArrays(GL_TRIANGLE_STRIP, firstVertexIndex, lastVertexIndex - firstVertexIndex + 1);
+
+		pVertexArray->unbind();
 	}
 }
\ No newline at end of file
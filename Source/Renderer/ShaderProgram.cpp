@@ -1,17 +1,17 @@
 #include "ShaderProgram.h"
 
 
-ShaderProgram::ShaderProgram(OpenGLContext& openGLContext)
-	: m_openGLContext(openGLContext)
-	, m_programId(0)
+ShaderProgram::ShaderProgram()
+	: m_programId(0)
 {
 }
 
 
 ShaderProgram::~ShaderProgram()
 {
-	m_openGLContext.extensions.glDeleteProgram(m_programId);
-	m_variableMap.clear();
+	getGLExtensions().glDeleteProgram(m_programId);
+	m_attributeMap.clear();
+	m_uniformMap.clear();
 }
 
 
@@ -22,96 +22,123 @@ bool ShaderProgram::load(const char* pVertexSource, const char* pFragmentSource)
 	GLuint fragmentShaderId = createShader(pFragmentSource, GL_FRAGMENT_SHADER);
 
 	// create shader program
-	GLuint shaderProgramId = m_openGLContext.extensions.glCreateProgram();
+	GLuint shaderProgramId = getGLExtensions().glCreateProgram();
 
 	// link shader program
-	m_openGLContext.extensions.glAttachShader(shaderProgramId, vertexShaderId);
-	m_openGLContext.extensions.glAttachShader(shaderProgramId, fragmentShaderId);
-	m_openGLContext.extensions.glLinkProgram(shaderProgramId);
+	getGLExtensions().glAttachShader(shaderProgramId, vertexShaderId);
+	getGLExtensions().glAttachShader(shaderProgramId, fragmentShaderId);
+	getGLExtensions().glLinkProgram(shaderProgramId);
 
 	// check program
 	int result;
-	m_openGLContext.extensions.glGetProgramiv(shaderProgramId, GL_LINK_STATUS, &result);
+	getGLExtensions().glGetProgramiv(shaderProgramId, GL_LINK_STATUS, &result);
 	if(result == GL_FALSE)
 	{
 		char shaderErrorMessage[2048];
-		m_openGLContext.extensions.glGetProgramInfoLog(shaderProgramId, 2048, NULL, shaderErrorMessage);
+		getGLExtensions().glGetProgramInfoLog(shaderProgramId, 2048, NULL, shaderErrorMessage);
 
 		juce::String errorMessage = "Failed to link shader program : ";
 		errorMessage += shaderErrorMessage;
 		Logger::getCurrentLogger()->writeToLog(errorMessage);
 
-		m_openGLContext.extensions.glDeleteShader(shaderProgramId);
+		getGLExtensions().glDeleteShader(shaderProgramId);
 	}
 	else
 	{
 		// initialise shader program
 		m_programId = shaderProgramId;
+
+		// resolve every variable location now so drawing never queries the driver, this also
+		// leaves the maps read only so the program can be used from several render threads
+		resolveVariables(pVertexSource);
+		resolveVariables(pFragmentSource);
 	}
 
 	// release un-needed resources
-	m_openGLContext.extensions.glDeleteShader(vertexShaderId);
-	m_openGLContext.extensions.glDeleteShader(fragmentShaderId);
+	getGLExtensions().glDeleteShader(vertexShaderId);
+	getGLExtensions().glDeleteShader(fragmentShaderId);
 
 	// return shader program name
 	return result == GL_TRUE;
 }
 
 
-int ShaderProgram::getAttributeIndex(const juce::String& name)
+int ShaderProgram::getAttributeIndex(const juce::String& name) const
 {
 	const int nameHash = name.hashCode();
-	if(m_variableMap.contains(nameHash))
-		return m_variableMap[nameHash];
-
-	int attributeLocation = m_openGLContext.extensions.glGetAttribLocation(m_programId, name.getCharPointer());
-	m_variableMap.set(nameHash, attributeLocation);
-	return attributeLocation;
+	return m_attributeMap.contains(nameHash) ? m_attributeMap[nameHash] : -1;
 }
 
 
-int ShaderProgram::getUniformIndex(const juce::String& name)
+int ShaderProgram::getUniformIndex(const juce::String& name) const
 {
 	const int nameHash = name.hashCode();
-	if(m_variableMap.contains(nameHash))
-		return m_variableMap[nameHash];
-	
-	int uniformLocation = m_openGLContext.extensions.glGetUniformLocation(m_programId, name.getCharPointer());
-	m_variableMap.set(nameHash, uniformLocation);
-	return uniformLocation;
+	return m_uniformMap.contains(nameHash) ? m_uniformMap[nameHash] : -1;
 }
 
 
 void ShaderProgram::useProgram() const
 {
-	m_openGLContext.extensions.glUseProgram(m_programId);
+	getGLExtensions().glUseProgram(m_programId);
 }
 
 
 uint32 ShaderProgram::createShader(const char* pShaderSource, GLenum shaderType) const
 {
 	// create the shader
-	uint32 shaderId = m_openGLContext.extensions.glCreateShader(shaderType);
+	uint32 shaderId = getGLExtensions().glCreateShader(shaderType);
 
 	// compile Shader
-	m_openGLContext.extensions.glShaderSource(shaderId, 1, &pShaderSource, NULL);
-	m_openGLContext.extensions.glCompileShader(shaderId);
+	getGLExtensions().glShaderSource(shaderId, 1, &pShaderSource, NULL);
+	getGLExtensions().glCompileShader(shaderId);
 
 	// check shader
 	int result;
-	m_openGLContext.extensions.glGetShaderiv(shaderId, GL_COMPILE_STATUS, &result);
+	getGLExtensions().glGetShaderiv(shaderId, GL_COMPILE_STATUS, &result);
 	if(result == GL_FALSE)
 	{
 		char shaderErrorMessage[2048];
-		m_openGLContext.extensions.glGetShaderInfoLog(shaderId, 2048, NULL, shaderErrorMessage);
+		getGLExtensions().glGetShaderInfoLog(shaderId, 2048, NULL, shaderErrorMessage);
 
 		juce::String errorMessage = "Failed to compile shader : ";
 		errorMessage += shaderErrorMessage;
 		Logger::getCurrentLogger()->writeToLog(errorMessage);
 
-		m_openGLContext.extensions.glDeleteShader(shaderId);
+		getGLExtensions().glDeleteShader(shaderId);
 		return 0;
 	}
 
 	return shaderId;
+}
+
+
+void ShaderProgram::resolveVariables(const char* pShaderSource)
+{
+	// find the attribute and uniform declarations, each statement is "qualifier type name;"
+	StringArray statements = StringArray::fromTokens(pShaderSource, ";{}", "");
+	for(int i = 0; i < statements.size(); ++i)
+	{
+		StringArray tokens = StringArray::fromTokens(statements[i], false);
+		tokens.removeEmptyStrings();
+		if(tokens.size() < 3)
+			continue;
+
+		const String& qualifier = tokens[0];
+		const String& declaration = tokens[tokens.size() - 1];
+		const String name = declaration.upToFirstOccurrenceOf("[", false, false);
+		if(qualifier == "attribute")
+			m_attributeMap.set(name.hashCode(), getGLExtensions().glGetAttribLocation(m_programId, name.getCharPointer()));
+		else if(qualifier == "uniform")
+		{
+			m_uniformMap.set(name.hashCode(), getGLExtensions().glGetUniformLocation(m_programId, name.getCharPointer()));
+
+			// element locations of a uniform array aren't guaranteed to follow on, so each is looked up as "name[i]"
+			const int arraySize = declaration.fromFirstOccurrenceOf("[", false, false).getIntValue();
+			for(int element = 0; element < arraySize; ++element)
+			{
+				const String elementName = name + "[" + String(element) + "]";
+				m_uniformMap.set(elementName.hashCode(), getGLExtensions().glGetUniformLocation(m_programId, elementName.getCharPointer()));
+			}
+		}
+	}
 }
\ No newline at end of file
@@ -1,7 +1,8 @@
 #pragma once
 
 
-#include "../../JuceLibraryCode/JuceHeader.h"
+#include "JuceHeader.h"
+#include "SharedRenderResources.h"
 
 
 typedef juce::HashMap<int, int> VariableMap;
@@ -10,21 +11,23 @@ typedef juce::HashMap<int, int> VariableMap;
 class ShaderProgram
 {
 public:
-	ShaderProgram(OpenGLContext& openGLContext);
+	ShaderProgram();
 	virtual ~ShaderProgram();
 
 	bool load(const char* pVertexSource, const char* pFragmentSource);
+	bool isLoaded() const { return m_programId != 0; }
 
-	int getAttributeIndex(const juce::String& name);
-	int getUniformIndex(const juce::String& name);
+	int getAttributeIndex(const juce::String& name) const;
+	int getUniformIndex(const juce::String& name) const;
 	void useProgram() const;
 
 private:
-	OpenGLContext& m_openGLContext;
 	uint32 m_programId;
-	VariableMap m_variableMap;
+	VariableMap m_attributeMap;
+	VariableMap m_uniformMap;
 
 	uint32 createShader(const char* pShaderSource, GLenum shaderType) const;
+	void resolveVariables(const char* pShaderSource);
 
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ShaderProgram)
 };
@@ -0,0 +1,137 @@
+#include "SharedRenderResources.h"
+
+
+CriticalSection SharedRenderResources::s_lock;
+std::vector<SharedRenderResources::Context> SharedRenderResources::s_contexts;
+std::vector<SharedRenderResources::Entry> SharedRenderResources::s_entries;
+int SharedRenderResources::s_nextGroupId = 0;
+
+
+void* SharedRenderResources::pickSharedContext(int& groupId)
+{
+	const ScopedLock lock(s_lock);
+
+	// the group is taken along with the context, so joining it doesn't depend on the context still being
+	// registered, or its address not having been reused, by the time the new one is created
+	groupId = (s_contexts.size() > 0) ? s_contexts[0].m_groupId : -1;
+	return (s_contexts.size() > 0) ? s_contexts[0].m_pNativeContext : nullptr;
+}
+
+
+void SharedRenderResources::addContext(void* pNativeContext, int groupId)
+{
+	if(pNativeContext == nullptr)
+		return;
+
+	const ScopedLock lock(s_lock);
+
+	// contexts created against a picked shared context join its group, anything else starts a new one
+	for(int i = 0; i < s_contexts.size(); ++i)
+		if(s_contexts[i].m_pNativeContext == pNativeContext)
+			return;
+
+	Context context;
+	context.m_pNativeContext = pNativeContext;
+	context.m_groupId = (groupId >= 0) ? groupId : s_nextGroupId++;
+	s_contexts.push_back(context);
+}
+
+
+void SharedRenderResources::removeContext(void* pNativeContext)
+{
+	const ScopedLock lock(s_lock);
+
+	for(int i = 0; i < s_contexts.size(); ++i)
+	{
+		if(s_contexts[i].m_pNativeContext == pNativeContext)
+		{
+			s_contexts.erase(s_contexts.begin() + i);
+			--i;
+		}
+	}
+}
+
+
+void SharedRenderResources::release(const void* pResource)
+{
+	if(pResource == nullptr)
+		return;
+
+	const ScopedLock lock(s_lock);
+
+	for(int i = 0; i < s_entries.size(); ++i)
+	{
+		Entry& entry = s_entries[i];
+		if(entry.m_pResource == pResource)
+		{
+			if(--entry.m_refCount <= 0)
+			{
+				entry.m_pDeleter(entry.m_pResource);
+				s_entries[i] = s_entries[s_entries.size() - 1];
+				s_entries.pop_back();
+			}
+			return;
+		}
+	}
+}
+
+
+int64 SharedRenderResources::hashBytes(const void* pData, size_t numBytes, int64 seed)
+{
+	// 64 bit FNV-1a
+	uint64 hash = 14695981039346656037ull ^ (uint64)seed;
+	const uint8* pBytes = static_cast<const uint8*>(pData);
+	for(size_t i = 0; i < numBytes; ++i)
+	{
+		hash ^= pBytes[i];
+		hash *= 1099511628211ull;
+	}
+	return (int64)hash;
+}
+
+
+int64 SharedRenderResources::hashString(const char* pString, int64 seed)
+{
+	return hashBytes(pString, strlen(pString), seed);
+}
+
+
+int SharedRenderResources::getCurrentGroupId()
+{
+	OpenGLContext* pContext = OpenGLContext::getCurrentContext();
+	void* pNativeContext = (pContext != nullptr) ? pContext->getRawContext() : nullptr;
+
+	for(int i = 0; i < s_contexts.size(); ++i)
+		if(s_contexts[i].m_pNativeContext == pNativeContext)
+			return s_contexts[i].m_groupId;
+
+	jassertfalse; // resources must be acquired with a registered context active
+	return -1;
+}
+
+
+void* SharedRenderResources::findResource(int groupId, int64 key)
+{
+	for(int i = 0; i < s_entries.size(); ++i)
+	{
+		Entry& entry = s_entries[i];
+		if(entry.m_groupId == groupId && entry.m_key == key)
+		{
+			++entry.m_refCount;
+			return entry.m_pResource;
+		}
+	}
+	return nullptr;
+}
+
+
+void SharedRenderResources::addResource(int groupId, int64 key, void* pResource, void(*pDeleter)(void*))
+{
+	Entry entry;
+	entry.m_groupId = groupId;
+	entry.m_key = key;
+	entry.m_pResource = pResource;
+	entry.m_pDeleter = pDeleter;
+	entry.m_refCount = 1;
+	s_entries.push_back(entry);
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+
+
+#include "JuceHeader.h"
+#include <vector>
+
+
+
+inline OpenGLExtensionFunctions& getGLExtensions()
+{
+	OpenGLContext* pContext = OpenGLContext::getCurrentContext();
+	jassert(pContext != nullptr);
+	return pContext->extensions;
+}
+
+
+
+
+
+// Caches GL objects by content so every context in a share group uses a single copy.
+// Resources are acquired and released with a context from the group active on the calling thread.
+class SharedRenderResources
+{
+public:
+	// a registered context to share with, or null to start a new group. Only valid until the next context is
+	// removed, so it's picked right before the context sharing it is created.
+	static void* pickSharedContext(int& groupId);
+	static void addContext(void* pNativeContext, int groupId);
+	static void removeContext(void* pNativeContext);
+
+	template<class ResourceType, class Factory>
+	static ResourceType* acquire(int64 key, Factory createResource);
+	static void release(const void* pResource);
+
+	static int64 hashBytes(const void* pData, size_t numBytes, int64 seed);
+	static int64 hashString(const char* pString, int64 seed);
+
+private:
+	struct Context
+	{
+		void* m_pNativeContext;
+		int m_groupId;
+	};
+
+	struct Entry
+	{
+		int m_groupId;
+		int64 m_key;
+		void* m_pResource;
+		void(*m_pDeleter)(void*);
+		int m_refCount;
+	};
+
+	static int getCurrentGroupId();
+	static void* findResource(int groupId, int64 key);
+	static void addResource(int groupId, int64 key, void* pResource, void(*pDeleter)(void*));
+
+	static CriticalSection s_lock;
+	static std::vector<Context> s_contexts;
+	static std::vector<Entry> s_entries;
+	static int s_nextGroupId;
+};
+
+
+
+template<class ResourceType, class Factory>
+ResourceType* SharedRenderResources::acquire(int64 key, Factory createResource)
+{
+	const ScopedLock lock(s_lock);
+
+	const int groupId = getCurrentGroupId();
+	ResourceType* pResource = static_cast<ResourceType*>(findResource(groupId, key));
+	if(pResource == nullptr)
+	{
+		pResource = createResource();
+		addResource(groupId, key, pResource, [](void* p) { delete static_cast<ResourceType*>(p); });
+	}
+
+	return pResource;
+}
\ No newline at end of file
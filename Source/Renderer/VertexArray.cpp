@@ -0,0 +1,124 @@
+#include "VertexArray.h"
+
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+
+typedef void (APIENTRY *GenVertexArraysFunction)(GLsizei, GLuint*);
+typedef void (APIENTRY *DeleteVertexArraysFunction)(GLsizei, const GLuint*);
+typedef void (APIENTRY *BindVertexArrayFunction)(GLuint);
+
+static GenVertexArraysFunction s_glGenVertexArrays = nullptr;
+static DeleteVertexArraysFunction s_glDeleteVertexArrays = nullptr;
+static BindVertexArrayFunction s_glBindVertexArray = nullptr;
+
+// every display renders on its own thread, so the first binds can race to resolve the functions
+static CriticalSection s_loadLock;
+static Atomic<int> s_loaded;
+
+
+
+VertexArray::VertexArray(const std::vector<Attribute>& attributes, GLsizei vertexStride, bool useVertexArrayObject)
+	: m_attributes(attributes)
+	, m_vertexStride(vertexStride)
+	, m_pShaderProgram(nullptr)
+	, m_useVertexArrayObject(useVertexArrayObject)
+	, m_vertexArrayId(0)
+	, m_recorded(false)
+{
+}
+
+
+VertexArray::~VertexArray()
+{
+	if(m_vertexArrayId != 0)
+		s_glDeleteVertexArrays(1, &m_vertexArrayId);
+}
+
+
+bool VertexArray::bind(ShaderProgram* pShaderProgram)
+{
+	if(pShaderProgram != m_pShaderProgram)
+	{
+		// resolve attribute locations once per program rather than on every draw
+		m_pShaderProgram = pShaderProgram;
+		m_attributeIds.resize(m_attributes.size());
+		for(int i = 0; i < m_attributes.size(); ++i)
+			m_attributeIds[i] = pShaderProgram->getAttributeIndex(m_attributes[i].m_name);
+		m_recorded = false;
+	}
+
+	if(m_useVertexArrayObject && loadFunctions())
+	{
+		if(m_vertexArrayId == 0)
+			s_glGenVertexArrays(1, &m_vertexArrayId);
+
+		s_glBindVertexArray(m_vertexArrayId);
+		return m_recorded;
+	}
+
+	return false;
+}
+
+
+void VertexArray::recordAttributes()
+{
+	for(int i = 0; i < m_attributes.size(); ++i)
+	{
+		const Attribute& attribute = m_attributes[i];
+		if(m_attributeIds[i] < 0)
+			continue;
+
+		getGLExtensions().glVertexAttribPointer(m_attributeIds[i], attribute.m_numFloats, GL_FLOAT, GL_FALSE, m_vertexStride, (GLvoid*)(sizeof(float) * attribute.m_floatOffset));
+		getGLExtensions().glEnableVertexAttribArray(m_attributeIds[i]);
+	}
+
+	m_recorded = m_vertexArrayId != 0;
+}
+
+
+void VertexArray::unbind()
+{
+	if(m_vertexArrayId != 0)
+	{
+		s_glBindVertexArray(0);
+		return;
+	}
+
+	for(int i = 0; i < m_attributeIds.size(); ++i)
+		if(m_attributeIds[i] >= 0)
+			getGLExtensions().glDisableVertexAttribArray(m_attributeIds[i]);
+}
+
+
+bool VertexArray::loadFunctions()
+{
+	// the flag is only set once the pointers are written, so binds that see it set skip the lock
+	if(s_loaded.get() == 0)
+	{
+		const ScopedLock lock(s_loadLock);
+		if(s_loaded.get() == 0)
+		{
+			resolveFunctions();
+			s_loaded.set(1);
+		}
+	}
+
+	return s_glGenVertexArrays != nullptr && s_glDeleteVertexArrays != nullptr && s_glBindVertexArray != nullptr;
+}
+
+
+void VertexArray::resolveFunctions()
+{
+	// some platforms return entry points for functions the context doesn't support, so check first
+	const char* pVersion = (const char*)glGetString(GL_VERSION);
+	const bool isVersion3 = pVersion != nullptr && String(pVersion).getIntValue() >= 3;
+	if(!isVersion3 && !OpenGLHelpers::isExtensionSupported("GL_ARB_vertex_array_object"))
+		return;
+
+	s_glGenVertexArrays = (GenVertexArraysFunction)OpenGLHelpers::getExtensionFunction("glGenVertexArrays");
+	s_glDeleteVertexArrays = (DeleteVertexArraysFunction)OpenGLHelpers::getExtensionFunction("glDeleteVertexArrays");
+	s_glBindVertexArray = (BindVertexArrayFunction)OpenGLHelpers::getExtensionFunction("glBindVertexArray");
+}
\ No newline at end of file
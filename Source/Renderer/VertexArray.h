@@ -0,0 +1,48 @@
+#pragma once
+
+
+#include "JuceHeader.h"
+#include "ShaderProgram.h"
+#include <vector>
+
+
+
+struct Attribute
+{
+	juce::String m_name;
+	GLuint m_numFloats;
+	GLuint m_floatOffset;
+};
+
+
+
+
+
+// Records the attribute layout of a mesh for one shader program. When vertex array objects are
+// available the layout is captured once and re-bound with a single call, otherwise the attribute
+// pointers are specified on each bind using locations resolved when the program was linked.
+// Vertex array objects aren't shared between contexts, so layouts of shared meshes must not use them.
+class VertexArray
+{
+public:
+	VertexArray(const std::vector<Attribute>& attributes, GLsizei vertexStride, bool useVertexArrayObject);
+	~VertexArray();
+
+	// returns false when the layout isn't recorded, the caller must then bind its vertex
+	// buffer (and index buffer if used) and call recordAttributes
+	bool bind(ShaderProgram* pShaderProgram);
+	void recordAttributes();
+	void unbind();
+
+private:
+	static bool loadFunctions();
+	static void resolveFunctions();
+
+	std::vector<Attribute> m_attributes;
+	std::vector<int> m_attributeIds;
+	GLsizei m_vertexStride;
+	const ShaderProgram* m_pShaderProgram;
+	bool m_useVertexArrayObject;
+	GLuint m_vertexArrayId;
+	bool m_recorded;
+};
\ No newline at end of file
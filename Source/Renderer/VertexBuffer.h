@@ -1,94 +1,117 @@
 #pragma once
 
 
-#include "../../JuceLibraryCode/JuceHeader.h"
+#include "JuceHeader.h"
+#include "SharedRenderResources.h"
 #include <vector>
 
 
+// number of buffers each dynamic vertex buffer cycles through, enough to cover frames in flight
+#define VERTEXBUFFER_NUM_STREAMS 3
+
+
 
 template<class Vertex>
 class StaticVertexBuffer
 {
 public:
-	StaticVertexBuffer(OpenGLContext& context, const std::vector<Vertex>& vertices);
+	StaticVertexBuffer(const std::vector<Vertex>& vertices);
 	~StaticVertexBuffer();
 
 	void bind();
 
 private:
-	OpenGLContext& m_openGLContext;
 	GLuint m_vertexBuffer;
 };
 
 
 template<class Vertex>
-StaticVertexBuffer<Vertex>::StaticVertexBuffer(OpenGLContext& context, const std::vector<Vertex>& vertices)
-	: m_openGLContext(context)
-	, m_vertexBuffer(0)
+StaticVertexBuffer<Vertex>::StaticVertexBuffer(const std::vector<Vertex>& vertices)
+	: m_vertexBuffer(0)
 {
-	m_openGLContext.extensions.glGenBuffers(1, &m_vertexBuffer);
-	m_openGLContext.extensions.glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
-	m_openGLContext.extensions.glBufferData(GL_ARRAY_BUFFER,
+	getGLExtensions().glGenBuffers(1, &m_vertexBuffer);
+	getGLExtensions().glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	getGLExtensions().glBufferData(GL_ARRAY_BUFFER,
 		static_cast<GLsizeiptr>(static_cast<size_t>(vertices.size()) * sizeof(Vertex)),
 		vertices.data(), GL_STATIC_DRAW);
-	m_openGLContext.extensions.glBindBuffer(GL_ARRAY_BUFFER, 0);
+	getGLExtensions().glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 
 template<class Vertex>
 StaticVertexBuffer<Vertex>::~StaticVertexBuffer()
 {
-	m_openGLContext.extensions.glDeleteBuffers(1, &m_vertexBuffer);
+	getGLExtensions().glDeleteBuffers(1, &m_vertexBuffer);
 }
 
 
 template<class Vertex>
 void StaticVertexBuffer<Vertex>::bind()
 {
-	m_openGLContext.extensions.glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	getGLExtensions().glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
 }
 
 
 
 
+// Dynamic buffers stream through a ring of GL buffers so an update never writes to storage the
+// GPU may still be reading from a previous frame. Each buffer catches up on every change made
+// since it was last current when it becomes current again.
 template<class Vertex>
 class DynamicVertexBuffer
 {
 public:
-	DynamicVertexBuffer(OpenGLContext& context, GLuint vertexCapacity);
+	DynamicVertexBuffer(GLuint vertexCapacity);
 	~DynamicVertexBuffer();
 
 	GLuint getVertexCapacity() const;
 	Vertex* getVertexArray();
 	void updateVertexArray(GLuint startVertexIndex, GLuint lastVertexIndex);
 
+	int getCurrentStream() const;
 	void bind();
 
 private:
-	OpenGLContext& m_openGLContext;
+	struct Stream
+	{
+		GLuint m_vertexBuffer;
+		GLuint m_firstPendingVertex;
+		GLuint m_lastPendingVertex;
+	};
+
 	Vertex* m_pVertices;
 	GLuint m_vertexCapacity;
-	GLuint m_vertexBuffer;
+	Stream m_streams[VERTEXBUFFER_NUM_STREAMS];
+	int m_currentStream;
 };
 
 
 template<class Vertex>
-DynamicVertexBuffer<Vertex>::DynamicVertexBuffer(OpenGLContext& context, GLuint vertexCapacity)
-	: m_openGLContext(context)
-	, m_pVertices(nullptr)
+DynamicVertexBuffer<Vertex>::DynamicVertexBuffer(GLuint vertexCapacity)
+	: m_pVertices(nullptr)
 	, m_vertexCapacity(vertexCapacity)
-	, m_vertexBuffer(0)
+	, m_currentStream(0)
 {
+	for(int i = 0; i < VERTEXBUFFER_NUM_STREAMS; ++i)
+	{
+		m_streams[i].m_vertexBuffer = 0;
+		m_streams[i].m_firstPendingVertex = m_vertexCapacity;
+		m_streams[i].m_lastPendingVertex = 0;
+	}
+
 	if(m_vertexCapacity > 0)
 	{
 		m_pVertices = new Vertex[m_vertexCapacity];
 
-		m_openGLContext.extensions.glGenBuffers(1, &m_vertexBuffer);
-		m_openGLContext.extensions.glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
-		m_openGLContext.extensions.glBufferData(GL_ARRAY_BUFFER,
-			static_cast<GLsizeiptr>(static_cast<size_t>(m_vertexCapacity) * sizeof(Vertex)),
-			m_pVertices, GL_DYNAMIC_DRAW);
-		m_openGLContext.extensions.glBindBuffer(GL_ARRAY_BUFFER, 0);
+		for(int i = 0; i < VERTEXBUFFER_NUM_STREAMS; ++i)
+		{
+			getGLExtensions().glGenBuffers(1, &m_streams[i].m_vertexBuffer);
+			getGLExtensions().glBindBuffer(GL_ARRAY_BUFFER, m_streams[i].m_vertexBuffer);
+			getGLExtensions().glBufferData(GL_ARRAY_BUFFER,
+				static_cast<GLsizeiptr>(static_cast<size_t>(m_vertexCapacity) * sizeof(Vertex)),
+				m_pVertices, GL_STREAM_DRAW);
+		}
+		getGLExtensions().glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 }
 
@@ -96,7 +119,8 @@ DynamicVertexBuffer<Vertex>::DynamicVertexBuffer(OpenGLContext& context, GLuint
 template<class Vertex>
 DynamicVertexBuffer<Vertex>::~DynamicVertexBuffer()
 {
-	m_openGLContext.extensions.glDeleteBuffers(1, &m_vertexBuffer);
+	for(int i = 0; i < VERTEXBUFFER_NUM_STREAMS; ++i)
+		getGLExtensions().glDeleteBuffers(1, &m_streams[i].m_vertexBuffer);
 
 	if(m_pVertices)
 		delete []m_pVertices;
@@ -120,21 +144,56 @@ Vertex* DynamicVertexBuffer<Vertex>::getVertexArray()
 template<class Vertex>
 void DynamicVertexBuffer<Vertex>::updateVertexArray(GLuint startVertexIndex, GLuint lastVertexIndex)
 {
+	if(m_vertexCapacity == 0)
+		return;
+
 	if(startVertexIndex >= m_vertexCapacity) { startVertexIndex = m_vertexCapacity - 1; }
 	if(lastVertexIndex >= m_vertexCapacity) { lastVertexIndex = m_vertexCapacity - 1; }
 
 	if(lastVertexIndex >= startVertexIndex)
 	{
-		m_openGLContext.extensions.glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
-		m_openGLContext.extensions.glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(sizeof(Vertex) * startVertexIndex),
-			static_cast<GLsizeiptr>(sizeof(Vertex) * (lastVertexIndex - startVertexIndex + 1)), m_pVertices);
-		m_openGLContext.extensions.glBindBuffer(GL_ARRAY_BUFFER, 0);
+		// every buffer in the ring is now missing this range
+		for(int i = 0; i < VERTEXBUFFER_NUM_STREAMS; ++i)
+		{
+			m_streams[i].m_firstPendingVertex = jmin<GLuint>(m_streams[i].m_firstPendingVertex, startVertexIndex);
+			m_streams[i].m_lastPendingVertex = jmax<GLuint>(m_streams[i].m_lastPendingVertex, lastVertexIndex);
+		}
+
+		// move on to the buffer drawn longest ago and bring it up to date
+		m_currentStream = (m_currentStream + 1) % VERTEXBUFFER_NUM_STREAMS;
+		Stream& stream = m_streams[m_currentStream];
+
+		getGLExtensions().glBindBuffer(GL_ARRAY_BUFFER, stream.m_vertexBuffer);
+		if(stream.m_firstPendingVertex == 0 && stream.m_lastPendingVertex == m_vertexCapacity - 1)
+		{
+			// whole buffer replaced, respecify it so the driver can hand back fresh storage
+			getGLExtensions().glBufferData(GL_ARRAY_BUFFER,
+				static_cast<GLsizeiptr>(static_cast<size_t>(m_vertexCapacity) * sizeof(Vertex)),
+				m_pVertices, GL_STREAM_DRAW);
+		}
+		else
+		{
+			getGLExtensions().glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(sizeof(Vertex) * stream.m_firstPendingVertex),
+				static_cast<GLsizeiptr>(sizeof(Vertex) * (stream.m_lastPendingVertex - stream.m_firstPendingVertex + 1)),
+				m_pVertices + stream.m_firstPendingVertex);
+		}
+		getGLExtensions().glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		stream.m_firstPendingVertex = m_vertexCapacity;
+		stream.m_lastPendingVertex = 0;
 	}
 }
 
 
+template<class Vertex>
+int DynamicVertexBuffer<Vertex>::getCurrentStream() const
+{
+	return m_currentStream;
+}
+
+
 template<class Vertex>
 void DynamicVertexBuffer<Vertex>::bind()
 {
-	m_openGLContext.extensions.glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	getGLExtensions().glBindBuffer(GL_ARRAY_BUFFER, m_streams[m_currentStream].m_vertexBuffer);
 }
\ No newline at end of file
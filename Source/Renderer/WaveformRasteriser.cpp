@@ -0,0 +1,275 @@
+#include "WaveformRasteriser.h"
+
+
+#define WAVEFORMRASTERISER_USE_SSE2 JUCE_INTEL
+#define WAVEFORMRASTERISER_PARTIAL_LIMIT 4
+
+#if WAVEFORMRASTERISER_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+
+
+WaveformRasteriser::WaveformRasteriser()
+	: m_width(0)
+	, m_height(0)
+	, m_numLayers(0)
+	, m_prevNumLayers(0)
+	, m_fullRedraw(true)
+{
+}
+
+
+void WaveformRasteriser::beginFrame(int width, int height, Colour backgroundColour)
+{
+	width = jmax(width, 1);
+	height = jmax(height, 1);
+	if(m_image.isNull() || m_image.getWidth() != width || m_image.getHeight() != height)
+	{
+		m_image = Image(Image::ARGB, width, height, false, SoftwareImageType());
+		m_fullRedraw = true;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_prevNumLayers = m_numLayers;
+	m_numLayers = 0;
+
+	m_prevBaseRow.swap(m_baseRow);
+	const uint32 backgroundPixel = backgroundColour.withAlpha(1.0f).getPixelARGB().getNativeARGB();
+	m_baseRow.assign(m_width, backgroundPixel);
+}
+
+
+void WaveformRasteriser::addTimeBar(float xRatio, float halfWidthRatio, Colour colour)
+{
+	// time bars cover the full height so they are folded into the background row
+	const int startColumn = jmax(0, roundToInt((xRatio - halfWidthRatio) * m_width));
+	const int endColumn = jmin(m_width, jmax(startColumn + 1, roundToInt((xRatio + halfWidthRatio) * m_width)));
+
+	const uint32 pixel = getAdditivePixel(colour);
+	for(int x = startColumn; x < endColumn; ++x)
+		m_baseRow[x] = addSaturated(m_baseRow[x], pixel);
+}
+
+
+void WaveformRasteriser::addWaveform(const float* pValues, int numValues, float firstValueX, float valueSpacingX, Colour colour)
+{
+	if(numValues < 2 || valueSpacingX <= 0.0f)
+		return;
+
+	if(m_numLayers == m_layers.size())
+		m_layers.resize(m_numLayers + 1);
+
+	// keep last frame's spans so only the columns that moved need drawing
+	Layer& layer = m_layers[m_numLayers++];
+	layer.m_prevColour = layer.m_colour;
+	layer.m_colour = getAdditivePixel(colour);
+	layer.m_prevSpanStart.swap(layer.m_spanStart);
+	layer.m_prevSpanEnd.swap(layer.m_spanEnd);
+	layer.m_spanStart.resize(m_width);
+	layer.m_spanEnd.resize(m_width);
+	layer.m_firstRow = m_height;
+	layer.m_lastRow = 0;
+
+	// the waveform is filled between the curve and the centre line, values and x are in clip space
+	const float columnToValue = 2.0f / (m_width * valueSpacingX);
+	const float firstColumnValue = (-1.0f + (1.0f / m_width) - firstValueX) / valueSpacingX;
+	const float halfHeight = 0.5f * m_height;
+	const int32 baseRow = (int32)halfHeight;
+	const float lastValue = (float)(numValues - 1);
+
+	int32* pSpanStart = layer.m_spanStart.data();
+	int32* pSpanEnd = layer.m_spanEnd.data();
+	for(int x = 0; x < m_width; ++x)
+	{
+		const float valuePosition = firstColumnValue + x * columnToValue;
+		if(valuePosition < 0.0f || valuePosition > lastValue)
+		{
+			pSpanStart[x] = 0;
+			pSpanEnd[x] = 0;
+			continue;
+		}
+
+		const int valueIndex = jmin((int)valuePosition, numValues - 2);
+		const float valueRatio = valuePosition - valueIndex;
+		const float value = pValues[valueIndex] + (pValues[valueIndex + 1] - pValues[valueIndex]) * valueRatio;
+		const int32 curveRow = (int32)((1.0f - jlimit(-1.0f, 1.0f, value)) * halfHeight + 0.5f);
+
+		pSpanStart[x] = jmin(curveRow, baseRow);
+		pSpanEnd[x] = jmax(curveRow, baseRow);
+	}
+
+	for(int x = 0; x < m_width; ++x)
+	{
+		if(pSpanEnd[x] > pSpanStart[x])
+		{
+			layer.m_firstRow = jmin<int>(layer.m_firstRow, pSpanStart[x]);
+			layer.m_lastRow = jmax<int>(layer.m_lastRow, pSpanEnd[x] - 1);
+		}
+	}
+}
+
+
+void WaveformRasteriser::endFrame()
+{
+	// anything that changes every column needs a full redraw
+	bool fullRedraw = m_fullRedraw || m_numLayers != m_prevNumLayers || m_prevBaseRow != m_baseRow;
+	for(int i = 0; i < m_numLayers && !fullRedraw; ++i)
+	{
+		const Layer& layer = m_layers[i];
+		fullRedraw = layer.m_colour != layer.m_prevColour || layer.m_prevSpanStart.size() != m_width;
+	}
+
+	if(fullRedraw || !updateChangedColumns())
+		fillImage();
+
+	m_fullRedraw = false;
+}
+
+
+const Image& WaveformRasteriser::getImage() const
+{
+	return m_image;
+}
+
+
+uint32 WaveformRasteriser::getAdditivePixel(Colour colour)
+{
+	// layers add colour without touching alpha, matching the GL_SRC_ALPHA, GL_ONE blend of the OpenGL path
+	const float alpha = colour.getFloatAlpha();
+	const Colour scaled(roundToInt(colour.getRed() * alpha), roundToInt(colour.getGreen() * alpha), roundToInt(colour.getBlue() * alpha));
+	return scaled.getPixelARGB().getNativeARGB() & 0x00ffffff;
+}
+
+
+uint32 WaveformRasteriser::addSaturated(uint32 a, uint32 b)
+{
+	uint32 result = 0;
+	for(int shift = 0; shift < 32; shift += 8)
+		result |= (uint32)jmin<int>(255, (int)((a >> shift) & 0xff) + (int)((b >> shift) & 0xff)) << shift;
+	return result;
+}
+
+
+void WaveformRasteriser::fillImage()
+{
+	int firstRow = m_height;
+	int lastRow = -1;
+	m_rowSpanStarts.resize(m_numLayers);
+	m_rowSpanEnds.resize(m_numLayers);
+	m_rowColours.resize(m_numLayers);
+	for(int i = 0; i < m_numLayers; ++i)
+	{
+		firstRow = jmin(firstRow, m_layers[i].m_firstRow);
+		lastRow = jmax(lastRow, m_layers[i].m_lastRow);
+		m_rowSpanStarts[i] = m_layers[i].m_spanStart.data();
+		m_rowSpanEnds[i] = m_layers[i].m_spanEnd.data();
+		m_rowColours[i] = m_layers[i].m_colour;
+	}
+
+	Image::BitmapData bitmap(m_image, Image::BitmapData::writeOnly);
+	for(int row = 0; row < m_height; ++row)
+	{
+		uint32* pDest = reinterpret_cast<uint32*>(bitmap.getLinePointer(row));
+		if(row < firstRow || row > lastRow)
+			memcpy(pDest, m_baseRow.data(), m_width * sizeof(uint32));
+		else
+			fillRow(pDest, row);
+	}
+}
+
+
+void WaveformRasteriser::fillRow(uint32* pDest, int row) const
+{
+	const uint32* pBase = m_baseRow.data();
+	int x = 0;
+
+#if WAVEFORMRASTERISER_USE_SSE2
+	// four pixels at a time, a layer covers a pixel when spanStart <= row < spanEnd
+	const __m128i rowVector = _mm_set1_epi32(row);
+	for(; x + 4 <= m_width; x += 4)
+	{
+		__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBase + x));
+		for(int i = 0; i < m_numLayers; ++i)
+		{
+			const __m128i spanStart = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_rowSpanStarts[i] + x));
+			const __m128i spanEnd = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_rowSpanEnds[i] + x));
+			const __m128i inside = _mm_andnot_si128(_mm_cmpgt_epi32(spanStart, rowVector), _mm_cmpgt_epi32(spanEnd, rowVector));
+			pixels = _mm_adds_epu8(pixels, _mm_and_si128(inside, _mm_set1_epi32((int)m_rowColours[i])));
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pDest + x), pixels);
+	}
+#endif
+
+	for(; x < m_width; ++x)
+	{
+		uint32 pixel = pBase[x];
+		for(int i = 0; i < m_numLayers; ++i)
+			if(m_rowSpanStarts[i][x] <= row && row < m_rowSpanEnds[i][x])
+				pixel = addSaturated(pixel, m_rowColours[i]);
+		pDest[x] = pixel;
+	}
+}
+
+
+bool WaveformRasteriser::updateChangedColumns()
+{
+	// find the rows either frame covered in each column that moved, everything else is already correct
+	m_changedFirstRow.resize(m_width);
+	m_changedEndRow.resize(m_width);
+	int numChangedColumns = 0;
+	for(int x = 0; x < m_width; ++x)
+	{
+		int firstRow = m_height;
+		int endRow = 0;
+		for(int i = 0; i < m_numLayers; ++i)
+		{
+			const Layer& layer = m_layers[i];
+			const int32 spanStart = layer.m_spanStart[x];
+			const int32 spanEnd = layer.m_spanEnd[x];
+			const int32 prevSpanStart = layer.m_prevSpanStart[x];
+			const int32 prevSpanEnd = layer.m_prevSpanEnd[x];
+			if(spanStart == prevSpanStart && spanEnd == prevSpanEnd)
+				continue;
+
+			if(spanEnd > spanStart)
+			{
+				firstRow = jmin<int>(firstRow, spanStart);
+				endRow = jmax<int>(endRow, spanEnd);
+			}
+			if(prevSpanEnd > prevSpanStart)
+			{
+				firstRow = jmin<int>(firstRow, prevSpanStart);
+				endRow = jmax<int>(endRow, prevSpanEnd);
+			}
+		}
+
+		m_changedFirstRow[x] = firstRow;
+		m_changedEndRow[x] = endRow;
+		if(endRow > firstRow)
+			++numChangedColumns;
+	}
+
+	// writing columns is strided, past a point the row pass is cheaper
+	if(numChangedColumns * WAVEFORMRASTERISER_PARTIAL_LIMIT > m_width)
+		return false;
+
+	Image::BitmapData bitmap(m_image, Image::BitmapData::writeOnly);
+	for(int x = 0; x < m_width; ++x)
+	{
+		for(int row = m_changedFirstRow[x]; row < m_changedEndRow[x]; ++row)
+		{
+			uint32 pixel = m_baseRow[x];
+			for(int i = 0; i < m_numLayers; ++i)
+			{
+				const Layer& layer = m_layers[i];
+				if(layer.m_spanStart[x] <= row && row < layer.m_spanEnd[x])
+					pixel = addSaturated(pixel, layer.m_colour);
+			}
+			reinterpret_cast<uint32*>(bitmap.getLinePointer(row))[x] = pixel;
+		}
+	}
+
+	return true;
+}
\ No newline at end of file
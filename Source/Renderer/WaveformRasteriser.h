@@ -0,0 +1,60 @@
+#pragma once
+
+
+#include "JuceHeader.h"
+#include <vector>
+
+
+
+// Software version of the waveform display that needs no graphics API, used when OpenGL isn't available
+// and for headless benchmarking. Each layer is reduced to one vertical span per column. A full redraw
+// writes every row in a single pass that adds the layers covering each pixel to a precomputed background
+// row, so the image is never cleared or read back. Later frames only rewrite the columns whose spans
+// moved, which is usually the few columns the audio thread has written since the last frame.
+// Layers blend additively like the OpenGL path.
+class WaveformRasteriser
+{
+public:
+	WaveformRasteriser();
+
+	void beginFrame(int width, int height, Colour backgroundColour);
+	void addTimeBar(float xRatio, float halfWidthRatio, Colour colour);
+	void addWaveform(const float* pValues, int numValues, float firstValueX, float valueSpacingX, Colour colour);
+	void endFrame();
+
+	const Image& getImage() const;
+
+private:
+	struct Layer
+	{
+		uint32 m_colour;
+		int m_firstRow;
+		int m_lastRow;
+		std::vector<int32> m_spanStart;
+		std::vector<int32> m_spanEnd;
+		std::vector<int32> m_prevSpanStart;
+		std::vector<int32> m_prevSpanEnd;
+		uint32 m_prevColour;
+	};
+
+	static uint32 getAdditivePixel(Colour colour);
+	static uint32 addSaturated(uint32 a, uint32 b);
+	void fillRow(uint32* pDest, int row) const;
+	void fillImage();
+	bool updateChangedColumns();
+
+	Image m_image;
+	int m_width;
+	int m_height;
+	std::vector<uint32> m_baseRow;
+	std::vector<uint32> m_prevBaseRow;
+	std::vector<Layer> m_layers;
+	std::vector<const int32*> m_rowSpanStarts;
+	std::vector<const int32*> m_rowSpanEnds;
+	std::vector<uint32> m_rowColours;
+	std::vector<int32> m_changedFirstRow;
+	std::vector<int32> m_changedEndRow;
+	int m_numLayers;
+	int m_prevNumLayers;
+	bool m_fullRedraw;
+};
\ No newline at end of file
@@ -0,0 +1,217 @@
+#include "SummationMeter.h"
+#include "Math.h"
+
+
+#define SUMMATIONMETER_USE_SSE2 JUCE_INTEL
+#define SUMMATIONMETER_CUTOFF_HZ 150.0
+#define SUMMATIONMETER_BLOCK_SAMPLES 4096
+#define SUMMATIONMETER_SILENCE_ENERGY 1.0e-12
+#define SUMMATIONMETER_MIN_DECIBELS -100.0f
+
+#if SUMMATIONMETER_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+
+
+SummationMeter::SummationMeter()
+	: m_sampleRate(0.0)
+{
+	for(int i = 0; i < 3; ++i)
+		m_numerator[i] = m_denominator[i] = 0.0;
+}
+
+
+SummationMeter::~SummationMeter()
+{
+}
+
+
+void SummationMeter::prepare(double sampleRate)
+{
+	if(sampleRate == m_sampleRate)
+		return;
+
+	m_sampleRate = sampleRate;
+	m_beats.clear();
+	if(sampleRate <= 0.0)
+		return;
+
+	// a Butterworth low pass run twice, so the low band is split off the way a 4th order crossover would
+	const double omega = 2.0 * double_Pi * jmin(SUMMATIONMETER_CUTOFF_HZ, 0.45 * sampleRate) / sampleRate;
+	const double alpha = sin(omega) / (2.0 * sqrt(0.5));
+	const double cosOmega = cos(omega);
+	const double a0 = 1.0 + alpha;
+	m_numerator[0] = m_numerator[2] = 0.5 * (1.0 - cosOmega) / a0;
+	m_numerator[1] = (1.0 - cosOmega) / a0;
+	m_denominator[0] = 1.0;
+	m_denominator[1] = -2.0 * cosOmega / a0;
+	m_denominator[2] = (1.0 - alpha) / a0;
+}
+
+
+void SummationMeter::updateBeat(int beatIndex, int sourceId, int64 beatNumber, const float* pSamples, int numSamples)
+{
+	if(m_sampleRate <= 0.0 || beatIndex < 0)
+		return;
+
+	if(beatIndex >= m_beats.size())
+		m_beats.resize(beatIndex + 1);
+
+	LowBandBeat& beat = m_beats[beatIndex];
+	if(!beat.m_samples.empty() && beat.m_sourceId == sourceId && beat.m_beatNumber == beatNumber && beat.m_numSamples == numSamples)
+		return;
+
+	beat.m_sourceId = sourceId;
+	beat.m_beatNumber = beatNumber;
+	beat.m_numSamples = numSamples;
+	beat.m_samples.resize(jmax(numSamples, 0));
+	if(numSamples <= 0 || pSamples == nullptr)
+	{
+		beat.m_samples.clear();
+		beat.m_energy = 0.0;
+		return;
+	}
+
+	// the beat repeats, so the first pass only settles the filters and the second is kept
+	double state[2][2] = { { 0.0, 0.0 }, { 0.0, 0.0 } };
+	for(int pass = 0; pass < 2; ++pass)
+	{
+		for(int i = 0; i < numSamples; ++i)
+		{
+			double sample = pSamples[i];
+			for(int section = 0; section < 2; ++section)
+			{
+				const double output = m_numerator[0] * sample + state[section][0];
+				state[section][0] = m_numerator[1] * sample - m_denominator[1] * output + state[section][1];
+				state[section][1] = m_numerator[2] * sample - m_denominator[2] * output;
+				sample = output;
+			}
+
+			beat.m_samples[i] = (float)sample;
+		}
+	}
+
+	beat.m_energy = sumOfSquares(beat.m_samples.data(), numSamples);
+}
+
+
+SummationMeter::Reading SummationMeter::measure(const Placement& local, const Placement& remote) const
+{
+	Reading reading = { false, 0.0f, 0.0f, 0.0f, 0.0f };
+	if(local.m_beatIndex < 0 || remote.m_beatIndex < 0 || local.m_beatIndex >= m_beats.size() || remote.m_beatIndex >= m_beats.size())
+		return reading;
+
+	const LowBandBeat& localBeat = m_beats[local.m_beatIndex];
+	const LowBandBeat& remoteBeat = m_beats[remote.m_beatIndex];
+	const int numLocalSamples = (int)localBeat.m_samples.size();
+	const int numRemoteSamples = (int)remoteBeat.m_samples.size();
+	if(numLocalSamples <= 0 || numRemoteSamples <= 0)
+		return reading;
+
+	// local sample i plays alongside remote sample i + offset, taken in runs that stop where either beat wraps.
+	// The remote energy is only summed again when the beats differ in length and so don't line up one to one.
+	const int offset = Math::positiveModulo(local.m_delaySamples - remote.m_delaySamples, numRemoteSamples);
+	const bool isSameLength = numLocalSamples == numRemoteSamples;
+	double crossEnergy = 0.0;
+	double remoteEnergy = isSameLength ? remoteBeat.m_energy : 0.0;
+	int localPosition = 0;
+	int remotePosition = offset;
+	while(localPosition < numLocalSamples)
+	{
+		const int numRunSamples = jmin(numLocalSamples - localPosition, numRemoteSamples - remotePosition);
+		const float* pRemoteSamples = remoteBeat.m_samples.data() + remotePosition;
+		crossEnergy += sumOfProducts(localBeat.m_samples.data() + localPosition, pRemoteSamples, numRunSamples);
+		if(!isSameLength)
+			remoteEnergy += sumOfSquares(pRemoteSamples, numRunSamples);
+
+		localPosition += numRunSamples;
+		remotePosition += numRunSamples;
+		if(remotePosition == numRemoteSamples)
+			remotePosition = 0;
+	}
+
+	const double localEnergy = localBeat.m_energy;
+	if(localEnergy < SUMMATIONMETER_SILENCE_ENERGY || remoteEnergy < SUMMATIONMETER_SILENCE_ENERGY)
+		return reading;
+
+	const double combinedEnergy = jmax(0.0, localEnergy + remoteEnergy + 2.0 * local.m_sampleSign * remote.m_sampleSign * crossEnergy);
+	reading.m_isValid = true;
+	reading.m_localRms = (float)sqrt(localEnergy / numLocalSamples);
+	reading.m_remoteRms = (float)sqrt(remoteEnergy / numLocalSamples);
+	reading.m_combinedRms = (float)sqrt(combinedEnergy / numLocalSamples);
+	reading.m_summationDecibels = jmax(SUMMATIONMETER_MIN_DECIBELS, (float)(10.0 * log10(jmax(combinedEnergy, 1.0e-30) / (localEnergy + remoteEnergy))));
+	return reading;
+}
+
+
+double SummationMeter::sumOfSquares(const float* pSamples, int numSamples)
+{
+	double sum = 0.0;
+	for(int blockStart = 0; blockStart < numSamples; blockStart += SUMMATIONMETER_BLOCK_SAMPLES)
+	{
+		const float* pBlock = pSamples + blockStart;
+		const int numBlockSamples = jmin(SUMMATIONMETER_BLOCK_SAMPLES, numSamples - blockStart);
+		int i = 0;
+		float blockSum = 0.0f;
+
+#if SUMMATIONMETER_USE_SSE2
+		// two accumulators so consecutive adds don't wait on each other
+		__m128 sum0 = _mm_setzero_ps();
+		__m128 sum1 = _mm_setzero_ps();
+		for(; i + 8 <= numBlockSamples; i += 8)
+		{
+			const __m128 samples0 = _mm_loadu_ps(pBlock + i);
+			const __m128 samples1 = _mm_loadu_ps(pBlock + i + 4);
+			sum0 = _mm_add_ps(sum0, _mm_mul_ps(samples0, samples0));
+			sum1 = _mm_add_ps(sum1, _mm_mul_ps(samples1, samples1));
+		}
+
+		float lanes[4];
+		_mm_storeu_ps(lanes, _mm_add_ps(sum0, sum1));
+		blockSum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+
+		for(; i < numBlockSamples; ++i)
+			blockSum += pBlock[i] * pBlock[i];
+
+		sum += blockSum;
+	}
+
+	return sum;
+}
+
+
+double SummationMeter::sumOfProducts(const float* pSamplesA, const float* pSamplesB, int numSamples)
+{
+	double sum = 0.0;
+	for(int blockStart = 0; blockStart < numSamples; blockStart += SUMMATIONMETER_BLOCK_SAMPLES)
+	{
+		const float* pBlockA = pSamplesA + blockStart;
+		const float* pBlockB = pSamplesB + blockStart;
+		const int numBlockSamples = jmin(SUMMATIONMETER_BLOCK_SAMPLES, numSamples - blockStart);
+		int i = 0;
+		float blockSum = 0.0f;
+
+#if SUMMATIONMETER_USE_SSE2
+		__m128 sum0 = _mm_setzero_ps();
+		__m128 sum1 = _mm_setzero_ps();
+		for(; i + 8 <= numBlockSamples; i += 8)
+		{
+			sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(pBlockA + i), _mm_loadu_ps(pBlockB + i)));
+			sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(pBlockA + i + 4), _mm_loadu_ps(pBlockB + i + 4)));
+		}
+
+		float lanes[4];
+		_mm_storeu_ps(lanes, _mm_add_ps(sum0, sum1));
+		blockSum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+
+		for(; i < numBlockSamples; ++i)
+			blockSum += pBlockA[i] * pBlockB[i];
+
+		sum += blockSum;
+	}
+
+	return sum;
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+
+#include "JuceHeader.h"
+#include <vector>
+
+
+// Measures how much the low end gains or loses when a remote beat is summed with the local one. Both beats are
+// low passed once, and only again when their source captures a new beat, and their energies are cached with
+// them. A reading then only needs the cross term of the two beats as their delay lines play them, so it's a
+// single dot product over at most three runs of samples and can be taken every frame. The summation is
+// RMS(local + remote) over sqrt(RMS local^2 + RMS remote^2) in dB, 0dB is what two unrelated beats give,
+// +3dB is the most two equal beats can gain and a large negative figure means they're cancelling.
+class SummationMeter
+{
+public:
+	struct Placement
+	{
+		int m_beatIndex;
+		int m_delaySamples;
+		float m_sampleSign;
+	};
+
+	struct Reading
+	{
+		bool m_isValid;
+		float m_summationDecibels;
+		float m_localRms;
+		float m_remoteRms;
+		float m_combinedRms;
+	};
+
+	SummationMeter();
+	~SummationMeter();
+
+	// a new sample rate drops every cached beat
+	void prepare(double sampleRate);
+	// the beat is only filtered when its source, beat number or length differ from the cached one
+	void updateBeat(int beatIndex, int sourceId, int64 beatNumber, const float* pSamples, int numSamples);
+
+	// the remote beat is read over the length of the local one, the reading isn't valid if either is silent
+	Reading measure(const Placement& local, const Placement& remote) const;
+
+	// both are accumulated in blocks of floats which are then added up as doubles, so long beats stay accurate
+	static double sumOfSquares(const float* pSamples, int numSamples);
+	static double sumOfProducts(const float* pSamplesA, const float* pSamplesB, int numSamples);
+
+private:
+	struct LowBandBeat
+	{
+		int m_sourceId;
+		int64 m_beatNumber;
+		int m_numSamples;
+		double m_energy;
+		std::vector<float> m_samples;
+	};
+
+	double m_sampleRate;
+	double m_numerator[3];
+	double m_denominator[3];
+	std::vector<LowBandBeat> m_beats;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SummationMeter)
+};
\ No newline at end of file
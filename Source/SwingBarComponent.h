@@ -1,7 +1,7 @@
 #pragma once
 
 
-#include "../JuceLibraryCode/JuceHeader.h"
+#include "JuceHeader.h"
 
 
 class SwingBarComponent : public Component
@@ -0,0 +1,282 @@
+#include "TempoTracker.h"
+
+
+#define TEMPOTRACKER_STOP_TIMEOUT_MS 2000
+#define TEMPOTRACKER_POLL_MS 50
+#define TEMPOTRACKER_MIN_FRAME_HZ 100.0
+#define TEMPOTRACKER_FIFO_SECONDS 1.0
+#define TEMPOTRACKER_HISTORY_SECONDS 8.0
+#define TEMPOTRACKER_PHASE_SECONDS 4.0
+#define TEMPOTRACKER_MIN_SECONDS 3.0
+#define TEMPOTRACKER_UPDATE_SECONDS 0.25
+#define TEMPOTRACKER_MIN_BPM 60.0
+#define TEMPOTRACKER_MAX_BPM 200.0
+#define TEMPOTRACKER_PREFERRED_BPM 120.0
+#define TEMPOTRACKER_PREFERENCE_OCTAVES 1.0
+#define TEMPOTRACKER_MIN_PERIODICITY 0.1
+#define TEMPOTRACKER_SWITCH_RATIO 1.25
+#define TEMPOTRACKER_BPM_TOLERANCE 0.01
+#define TEMPOTRACKER_PHASE_TOLERANCE 0.05
+#define TEMPOTRACKER_PRE_SECONDS 0.02
+
+
+
+TempoTracker::TempoTracker()
+	: Thread("TempoTracker")
+	, m_sampleRate(0.0)
+	, m_decimationFactor(1)
+	, m_numDroppedValues(0)
+	, m_frameSize(1)
+	, m_frameRate(0.0)
+	, m_framePosition(0)
+	, m_frameSum(0.0f)
+	, m_frameMean(0.0f)
+	, m_numFrames(0)
+	, m_numFramesAtEstimate(0)
+	, m_minLag(0)
+	, m_maxLag(0)
+{
+	const Estimate noEstimate = { 0.0, 0.0 };
+	m_workerEstimate = m_publishedEstimate = m_audioEstimate = noEstimate;
+
+	startThread();
+}
+
+
+TempoTracker::~TempoTracker()
+{
+	signalThreadShouldExit();
+	notify();
+	stopThread(TEMPOTRACKER_STOP_TIMEOUT_MS);
+}
+
+
+void TempoTracker::prepare(double sampleRate, int decimationFactor)
+{
+	const ScopedLock lock(m_stateLock);
+	m_sampleRate = sampleRate;
+	m_decimationFactor = jmax(1, decimationFactor);
+
+	// frames are the largest power of two of novelty values that still leaves a hundred or so a second
+	const double noveltyRate = (sampleRate > 0.0) ? sampleRate / m_decimationFactor : 0.0;
+	m_frameSize = 1;
+	while(noveltyRate / (2 * m_frameSize) >= TEMPOTRACKER_MIN_FRAME_HZ)
+		m_frameSize *= 2;
+	m_frameRate = noveltyRate / m_frameSize;
+
+	const int fifoSize = jmax(1, roundDoubleToInt(TEMPOTRACKER_FIFO_SECONDS * noveltyRate));
+	m_pNoveltyFifo = new AbstractFifo(fifoSize);
+	m_noveltyValues.assign(fifoSize, 0.0f);
+	m_numDroppedValues.set(0);
+
+	// the autocorrelation runs to twice the longest beat so half-time readings can be checked against it
+	m_minLag = jmax(1, (int)floor(60.0 * m_frameRate / TEMPOTRACKER_MAX_BPM));
+	m_maxLag = jmax(m_minLag + 1, (int)ceil(60.0 * m_frameRate / TEMPOTRACKER_MIN_BPM));
+	m_frames.assign(jmax(2 * m_maxLag + 1, roundDoubleToInt(TEMPOTRACKER_HISTORY_SECONDS * m_frameRate)), 0.0f);
+	m_autocorrelation.assign(2 * m_maxLag + 1, 0.0);
+	m_lagScores.assign(m_maxLag + 1, 0.0);
+	m_phaseEnergy.reserve(m_maxLag + 1);
+
+	m_framePosition = 0;
+	m_frameSum = 0.0f;
+	m_frameMean = 0.0f;
+	m_numFrames = 0;
+	m_numFramesAtEstimate = 0;
+
+	const Estimate noEstimate = { 0.0, 0.0 };
+	m_workerEstimate = m_audioEstimate = noEstimate;
+	const ScopedLock estimateLock(m_estimateLock);
+	m_publishedEstimate = noEstimate;
+}
+
+
+void TempoTracker::pushNovelty(const float* pNovelty, int numValues)
+{
+	if(m_pNoveltyFifo == nullptr || numValues <= 0)
+		return;
+
+	int start1, size1, start2, size2;
+	m_pNoveltyFifo->prepareToWrite(numValues, start1, size1, start2, size2);
+	if(size1 > 0)
+		memcpy(m_noveltyValues.data() + start1, pNovelty, size1 * sizeof(float));
+	if(size2 > 0)
+		memcpy(m_noveltyValues.data() + start2, pNovelty + size1, size2 * sizeof(float));
+	m_pNoveltyFifo->finishedWrite(size1 + size2);
+
+	if(size1 + size2 < numValues)
+		m_numDroppedValues += numValues - (size1 + size2);
+}
+
+
+bool TempoTracker::getEstimate(Estimate& estimate)
+{
+	const ScopedTryLock lock(m_estimateLock);
+	if(lock.isLocked())
+		m_audioEstimate = m_publishedEstimate;
+
+	estimate = m_audioEstimate;
+	return estimate.m_bpm > 0.0;
+}
+
+
+void TempoTracker::run()
+{
+	while(!threadShouldExit())
+	{
+		wait(TEMPOTRACKER_POLL_MS);
+
+		const ScopedLock lock(m_stateLock);
+		if(m_pNoveltyFifo == nullptr || m_frameRate <= 0.0)
+			continue;
+
+		// dropped values went missing after everything still in the fifo was pushed, so they go last
+		int start1, size1, start2, size2;
+		m_pNoveltyFifo->prepareToRead(m_pNoveltyFifo->getNumReady(), start1, size1, start2, size2);
+		for(int i = 0; i < size1; ++i)
+			addNovelty(m_noveltyValues[start1 + i]);
+		for(int i = 0; i < size2; ++i)
+			addNovelty(m_noveltyValues[start2 + i]);
+		m_pNoveltyFifo->finishedRead(size1 + size2);
+
+		const int numDroppedValues = m_numDroppedValues.exchange(0);
+		for(int i = 0; i < numDroppedValues; ++i)
+			addNovelty(0.0f);
+
+		if(m_numFrames >= TEMPOTRACKER_MIN_SECONDS * m_frameRate && m_numFrames - m_numFramesAtEstimate >= TEMPOTRACKER_UPDATE_SECONDS * m_frameRate)
+		{
+			updateEstimate();
+			m_numFramesAtEstimate = m_numFrames;
+		}
+	}
+}
+
+
+void TempoTracker::addNovelty(float novelty)
+{
+	m_frameSum += novelty;
+	if(++m_framePosition == m_frameSize)
+	{
+		addFrame(m_frameSum);
+		m_framePosition = 0;
+		m_frameSum = 0.0f;
+	}
+}
+
+
+void TempoTracker::addFrame(float frame)
+{
+	// frames are centred on a slow running mean so steady novelty doesn't read as periodic at every lag
+	const double historyFrames = TEMPOTRACKER_HISTORY_SECONDS * m_frameRate;
+	m_frameMean += (float)(1.0 / historyFrames) * (frame - m_frameMean);
+	const float centredFrame = frame - m_frameMean;
+
+	const int numHistoryFrames = (int)m_frames.size();
+	const int frameIndex = (int)(m_numFrames % numHistoryFrames);
+	m_frames[frameIndex] = centredFrame;
+
+	// each new frame adds its products with the frames before it and the older products fade away
+	const double decay = 1.0 - 1.0 / historyFrames;
+	for(int lag = 0; lag < (int)m_autocorrelation.size(); ++lag)
+	{
+		int laggedIndex = frameIndex - lag;
+		if(laggedIndex < 0)
+			laggedIndex += numHistoryFrames;
+		m_autocorrelation[lag] = decay * m_autocorrelation[lag] + (double)centredFrame * m_frames[laggedIndex];
+	}
+
+	++m_numFrames;
+}
+
+
+void TempoTracker::updateEstimate()
+{
+	if(m_autocorrelation[0] <= 0.0)
+		return;
+
+	// a period that repeats again at twice the lag scores higher, which also keeps swung beats, where the
+	// single beat lag splits in two, from locking onto either half
+	std::vector<double>& scores = m_lagScores;
+	std::fill(scores.begin(), scores.end(), 0.0);
+	int bestLag = -1;
+	for(int lag = m_minLag; lag <= m_maxLag; ++lag)
+	{
+		const double octaves = log(60.0 * m_frameRate / lag / TEMPOTRACKER_PREFERRED_BPM) / log(2.0) / TEMPOTRACKER_PREFERENCE_OCTAVES;
+		scores[lag] = (0.5 * m_autocorrelation[lag] + m_autocorrelation[2 * lag]) * exp(-0.5 * octaves * octaves);
+		if(scores[lag] > 0.0 && (bestLag < 0 || scores[lag] > scores[bestLag]))
+			bestLag = lag;
+	}
+
+	// the tempo only jumps to another peak, say an octave away, when it's clearly stronger than the current one
+	if(bestLag >= 0 && m_workerEstimate.m_bpm > 0.0)
+	{
+		const int currentLag = jlimit(m_minLag, m_maxLag, roundDoubleToInt(60.0 * m_frameRate / m_workerEstimate.m_bpm));
+		int currentPeakLag = currentLag;
+		for(int lag = jmax(m_minLag, currentLag - 2); lag <= jmin(m_maxLag, currentLag + 2); ++lag)
+			if(scores[lag] > scores[currentPeakLag])
+				currentPeakLag = lag;
+
+		if(scores[currentPeakLag] > 0.0 && scores[bestLag] < TEMPOTRACKER_SWITCH_RATIO * scores[currentPeakLag])
+			bestLag = currentPeakLag;
+	}
+
+	if(bestLag < 0 || m_autocorrelation[bestLag] + m_autocorrelation[2 * bestLag] < TEMPOTRACKER_MIN_PERIODICITY * m_autocorrelation[0])
+		return;
+
+	// the peak is refined between lags with a parabola through it and its neighbours
+	double period = bestLag;
+	if(bestLag > m_minLag && bestLag < m_maxLag)
+	{
+		const double before = scores[bestLag - 1];
+		const double peak = scores[bestLag];
+		const double after = scores[bestLag + 1];
+		const double curvature = before - 2.0 * peak + after;
+		if(curvature < 0.0)
+			period += jlimit(-0.5, 0.5, 0.5 * (before - after) / curvature);
+	}
+
+	// recent frames are folded onto the period, the beat is at the phase with the most novelty
+	const int numHistoryFrames = (int)m_frames.size();
+	const int numPhaseBins = jmax(1, (int)period);
+	const int64 numPhaseFrames = jmin<int64>(m_numFrames, jmin(numHistoryFrames, roundDoubleToInt(TEMPOTRACKER_PHASE_SECONDS * m_frameRate)));
+	m_phaseEnergy.assign(numPhaseBins, 0.0);
+	for(int64 frame = m_numFrames - numPhaseFrames; frame < m_numFrames; ++frame)
+	{
+		const int bin = jmin(numPhaseBins - 1, (int)(fmod((double)frame, period) / period * numPhaseBins));
+		m_phaseEnergy[bin] += m_frames[(int)(frame % numHistoryFrames)];
+	}
+
+	int bestBin = 0;
+	double bestEnergy = -1.0e30;
+	for(int bin = 0; bin < numPhaseBins; ++bin)
+	{
+		const double energy = m_phaseEnergy[(bin + numPhaseBins - 1) % numPhaseBins] + 2.0 * m_phaseEnergy[bin] + m_phaseEnergy[(bin + 1) % numPhaseBins];
+		if(energy > bestEnergy)
+		{
+			bestEnergy = energy;
+			bestBin = bin;
+		}
+	}
+
+	// the latest beat up to the newest frame, started a little early so the hit isn't cut off at the start
+	const double phaseFrames = (bestBin + 0.5) / numPhaseBins * period;
+	const double originFrame = phaseFrames + period * floor((m_numFrames - 1 - phaseFrames) / period);
+	const double samplesPerFrame = (double)m_frameSize * m_decimationFactor;
+	Estimate estimate = { 60.0 * m_frameRate / period, originFrame * samplesPerFrame - TEMPOTRACKER_PRE_SECONDS * m_sampleRate };
+
+	if(m_workerEstimate.m_bpm > 0.0)
+	{
+		if(fabs(estimate.m_bpm / m_workerEstimate.m_bpm - 1.0) < TEMPOTRACKER_BPM_TOLERANCE)
+		{
+			estimate.m_bpm = m_workerEstimate.m_bpm;
+
+			const double beatSamples = 60.0 * m_sampleRate / estimate.m_bpm;
+			const double phaseError = remainder(estimate.m_beatOrigin - m_workerEstimate.m_beatOrigin, beatSamples);
+			if(fabs(phaseError) < TEMPOTRACKER_PHASE_TOLERANCE * beatSamples)
+				estimate.m_beatOrigin = m_workerEstimate.m_beatOrigin;
+		}
+	}
+
+	m_workerEstimate = estimate;
+	const ScopedLock lock(m_estimateLock);
+	m_publishedEstimate = estimate;
+}
\ No newline at end of file
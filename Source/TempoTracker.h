@@ -0,0 +1,70 @@
+#pragma once
+
+
+#include "JuceHeader.h"
+#include <vector>
+
+
+// Finds a beat grid in the onset novelty of a track for when the host doesn't supply one. The audio thread only
+// pushes novelty into a lock free fifo. A worker sums it into frames at around a hundred a second and keeps a
+// leaky autocorrelation of them up to date one frame at a time, so an estimate never has to look back over the
+// whole history. The period is the lag with the strongest autocorrelation, combined with its double so
+// half-time readings lose out, under a broad preference for tempos near 120bpm. The phase is where the
+// novelty of recent frames folds onto that period most strongly. Small changes in either are ignored so the
+// grid, and the beat buffer sized from it, only moves when the material does.
+class TempoTracker : private Thread
+{
+public:
+	// the beat origin is where a beat starts, counted in samples pushed since prepare
+	struct Estimate
+	{
+		double m_bpm;
+		double m_beatOrigin;
+	};
+
+	TempoTracker();
+	~TempoTracker();
+
+	// the decimation factor is the number of samples each novelty value covers
+	void prepare(double sampleRate, int decimationFactor);
+
+	// called on the audio thread, novelty that doesn't fit while the worker is behind is counted and later
+	// taken as silence, so frames stay in step with the samples pushed
+	void pushNovelty(const float* pNovelty, int numValues);
+	// called on the audio thread, it never waits on the worker and keeps the last estimate it saw instead
+	bool getEstimate(Estimate& estimate);
+
+private:
+	void run() override;
+	void addNovelty(float novelty);
+	void addFrame(float frame);
+	void updateEstimate();
+
+	CriticalSection m_stateLock;
+	double m_sampleRate;
+	int m_decimationFactor;
+	ScopedPointer<AbstractFifo> m_pNoveltyFifo;
+	std::vector<float> m_noveltyValues;
+	Atomic<int> m_numDroppedValues;
+
+	int m_frameSize;
+	double m_frameRate;
+	int m_framePosition;
+	float m_frameSum;
+	float m_frameMean;
+	int64 m_numFrames;
+	int64 m_numFramesAtEstimate;
+	std::vector<float> m_frames;
+	std::vector<double> m_autocorrelation;
+	int m_minLag;
+	int m_maxLag;
+	std::vector<double> m_lagScores;
+	std::vector<double> m_phaseEnergy;
+	Estimate m_workerEstimate;
+
+	CriticalSection m_estimateLock;
+	Estimate m_publishedEstimate;
+	Estimate m_audioEstimate;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TempoTracker)
+};
\ No newline at end of file
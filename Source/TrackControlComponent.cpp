@@ -4,11 +4,16 @@
 
 #define TRACKCONTROL_LISTENMODE_RADIOGROUP 1
 #define TRACKCONTROL_DELAY_HEIGHT 3
+#define TRACKCONTROL_PHASE_ROTATION_WIDTH 70
+#define TRACKCONTROL_SUMMATION_WIDTH 60
+#define TRACKCONTROL_SUMMATION_REFRESH_HZ 10
+#define TRACKCONTROL_SUMMATION_WARNING_DB -1.0f
 
 
 
 TrackControlComponent::TrackControlComponent(bool delayOnTop)
 	: m_processor(nullptr)
+	, m_summationReference(nullptr)
 	, m_delayOnTop(delayOnTop)
 	, m_listenModeLeftButton("L")
 	, m_listenModeSumButton("L+R")
@@ -48,11 +53,27 @@ TrackControlComponent::TrackControlComponent(bool delayOnTop)
 	m_invertPhaseButton.addListener(this);
 	m_invertPhaseButton.setTooltip("Invert the phase of this tracks waveform");
 	addAndMakeVisible(m_invertPhaseButton);
+
+	// initialise phase rotation slider
+	m_phaseRotationSlider.setSliderStyle(Slider::LinearBar);
+	m_phaseRotationSlider.setRange(-PHASE_ROTATION_RANGE, PHASE_ROTATION_RANGE, 1.0);
+	m_phaseRotationSlider.setValue(0.0, NotificationType::dontSendNotification);
+	m_phaseRotationSlider.setDoubleClickReturnValue(true, 0.0);
+	m_phaseRotationSlider.setTextValueSuffix(CharPointer_UTF8("\xc2\xb0"));
+	m_phaseRotationSlider.addListener(this);
+	m_phaseRotationSlider.setTooltip("Rotate the phase of this track, double click to reset");
+	addAndMakeVisible(m_phaseRotationSlider);
+
+	// initialise summation label, it's only shown once there's a reference to sum with
+	m_summationLabel.setJustificationType(Justification::centred);
+	m_summationLabel.setTooltip("How much louder the low end of this track and the local track are together than apart, below 0dB they're cancelling");
+	addChildComponent(m_summationLabel);
 }
 
 
 TrackControlComponent::~TrackControlComponent()
 {
+	stopTimer();
 	setAudioSource(nullptr);
 }
 
@@ -64,6 +85,7 @@ void TrackControlComponent::setAudioSource(KickFaceAudioProcessor* pProcessor)
 	{
 		pPrevProcessor->getDelayValue().removeListener(this);
 		pPrevProcessor->getInvertPhaseValue().removeListener(this);
+		pPrevProcessor->getPhaseRotationValue().removeListener(this);
 		pPrevProcessor->getListenModeValue().removeListener(this);
 	}
 
@@ -72,15 +94,35 @@ void TrackControlComponent::setAudioSource(KickFaceAudioProcessor* pProcessor)
 	{
 		pProcessor->getDelayValue().addListener(this);
 		pProcessor->getInvertPhaseValue().addListener(this);
+		pProcessor->getPhaseRotationValue().addListener(this);
 		pProcessor->getListenModeValue().addListener(this);
 
 		valueChanged(pProcessor->getDelayValue());
 		valueChanged(pProcessor->getInvertPhaseValue());
+		valueChanged(pProcessor->getPhaseRotationValue());
 		valueChanged(pProcessor->getListenModeValue());
 	}
 }
 
 
+void TrackControlComponent::setSummationReference(KickFaceAudioProcessor* pReferenceProcessor)
+{
+	m_summationReference = pReferenceProcessor;
+	m_summationLabel.setVisible(pReferenceProcessor != nullptr);
+	if(pReferenceProcessor)
+	{
+		startTimerHz(TRACKCONTROL_SUMMATION_REFRESH_HZ);
+		timerCallback();
+	}
+	else
+	{
+		stopTimer();
+	}
+
+	resized();
+}
+
+
 void TrackControlComponent::paint(Graphics& g)
 {
 }
@@ -95,6 +137,9 @@ void TrackControlComponent::resized()
 	m_listenModeLeftButton.setBounds(bounds.removeFromLeft(20));
 	m_listenModeSumButton.setBounds(bounds.removeFromLeft(30));
 	m_listenModeRightButton.setBounds(bounds.removeFromLeft(20));
+	m_phaseRotationSlider.setBounds(bounds.removeFromRight(TRACKCONTROL_PHASE_ROTATION_WIDTH));
+	if(m_summationLabel.isVisible())
+		m_summationLabel.setBounds(bounds.removeFromRight(TRACKCONTROL_SUMMATION_WIDTH));
 	m_invertPhaseButton.setBounds(bounds);
 }
 
@@ -124,6 +169,20 @@ void TrackControlComponent::buttonClicked(Button* pButton)
 }
 
 
+void TrackControlComponent::sliderValueChanged(Slider* pSlider)
+{
+	KickFaceAudioProcessor* pProcessor = m_processor.get();
+	if(pProcessor == nullptr)
+		return;
+
+	if(pSlider == &m_phaseRotationSlider)
+	{
+		pProcessor->getPhaseRotationValue().setValue((float)m_phaseRotationSlider.getValue());
+		return;
+	}
+}
+
+
 void TrackControlComponent::valueChanged(Value& value)
 {
 	KickFaceAudioProcessor* pProcessor = m_processor.get();
@@ -144,6 +203,12 @@ void TrackControlComponent::valueChanged(Value& value)
 		return;
 	}
 
+	if(value.refersToSameSourceAs(pProcessor->getPhaseRotationValue()))
+	{
+		m_phaseRotationSlider.setValue((float)value.getValue(), NotificationType::dontSendNotification);
+		return;
+	}
+
 	if(value.refersToSameSourceAs(pProcessor->getListenModeValue()))
 	{
 		E_ListenMode listenMode = E_ListenMode::LeftChannelOnly;
@@ -160,4 +225,25 @@ void TrackControlComponent::valueChanged(Value& value)
 
 		return;
 	}
+}
+
+
+void TrackControlComponent::timerCallback()
+{
+	KickFaceAudioProcessor* pProcessor = m_processor.get();
+	KickFaceAudioProcessor* pReferenceProcessor = m_summationReference.get();
+	SummationMeter::Reading reading = { false, 0.0f, 0.0f, 0.0f, 0.0f };
+	if(pProcessor && pReferenceProcessor)
+		reading = pReferenceProcessor->measureLowEndSummation(pProcessor);
+
+	// cancelling swaps the colours round so it stands out
+	const bool isCancelling = reading.m_isValid && reading.m_summationDecibels < TRACKCONTROL_SUMMATION_WARNING_DB;
+	const Colour baseColour = findColour(TextButton::ColourIds::buttonColourId);
+	const Colour hilightColour = findColour(TextButton::ColourIds::buttonOnColourId);
+	m_summationLabel.setColour(Label::ColourIds::backgroundColourId, isCancelling ? hilightColour : baseColour);
+	m_summationLabel.setColour(Label::ColourIds::textColourId, isCancelling ? Colour::greyLevel(0.1f) : hilightColour);
+	if(reading.m_isValid)
+		m_summationLabel.setText((reading.m_summationDecibels >= 0.0f ? "+" : "") + String(reading.m_summationDecibels, 1) + "dB", NotificationType::dontSendNotification);
+	else
+		m_summationLabel.setText("-", NotificationType::dontSendNotification);
 }
\ No newline at end of file
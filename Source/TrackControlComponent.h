@@ -1,29 +1,35 @@
 #pragma once
 
 
-#include "../JuceLibraryCode/JuceHeader.h"
+#include "JuceHeader.h"
 #include "SwingBarComponent.h"
 
 
 class KickFaceAudioProcessor;
 
 
-class TrackControlComponent : public Component, public juce::Button::Listener, public juce::Value::Listener
+class TrackControlComponent : public Component, public juce::Button::Listener, public juce::Slider::Listener, public juce::Value::Listener,
+	private juce::Timer
 {
 public:
 	TrackControlComponent(bool delayOnTop);
 	~TrackControlComponent();
 
 	void setAudioSource(KickFaceAudioProcessor* pProcessor);
+	// shows how the low end of this track sums with the reference's, null hides the meter
+	void setSummationReference(KickFaceAudioProcessor* pReferenceProcessor);
 
 private:
 	void paint(Graphics& g) override;
 	void resized() override;
 
 	virtual void buttonClicked(Button* pButton) override;
+	virtual void sliderValueChanged(Slider* pSlider) override;
 	virtual void valueChanged(Value& value) override;
+	virtual void timerCallback() override;
 
 	WeakReference<KickFaceAudioProcessor> m_processor;
+	WeakReference<KickFaceAudioProcessor> m_summationReference;
 
 	bool m_delayOnTop;
 	SwingBarComponent m_delayBar;
@@ -31,6 +37,8 @@ private:
 	TextButton m_listenModeSumButton;
 	TextButton m_listenModeRightButton;
 	TextButton m_invertPhaseButton;
+	Slider m_phaseRotationSlider;
+	Label m_summationLabel;
 
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TrackControlComponent)
 };
\ No newline at end of file
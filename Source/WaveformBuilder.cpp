@@ -0,0 +1,169 @@
+#include "WaveformBuilder.h"
+#include "Math.h"
+
+
+#define WAVEFORMBUILDER_USE_SSE2 JUCE_INTEL
+
+#if WAVEFORMBUILDER_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+
+
+void WaveformBuilder::buildCurve(const Source& source, float viewStartRatio, float viewEndRatio, float* pCurve, int numPoints)
+{
+	if(source.m_numBeatSamples <= 0 || numPoints < 2)
+		return;
+
+	const int viewStartBeatSample = (int)floorf(viewStartRatio * source.m_numBeatSamples);
+	const int viewEndBeatSample = (int)ceilf(viewEndRatio * source.m_numBeatSamples);
+	const float viewScale = (float)(viewEndBeatSample - viewStartBeatSample) / (numPoints - 1);
+
+	resampleWrapped(source.m_pBeatBuffer, source.m_numBeatSamples, (float)(viewStartBeatSample - source.m_delaySamples), viewScale,
+		numPoints, source.m_sampleSign, false, pCurve);
+	FloatVectorOperations::clip(pCurve, pCurve, -1.0f, 1.0f, numPoints);
+}
+
+
+WaveformBuilder::Source WaveformBuilder::sumSources(const Source* pSources, int numSources, std::vector<float>& summedSamples)
+{
+	// the sum is laid out on the first source, each source wraps at its own length
+	const int numSamples = (numSources > 0) ? jmax(0, pSources[0].m_numBeatSamples) : 0;
+	summedSamples.resize(numSamples);
+	if(numSamples > 0)
+		FloatVectorOperations::clear(summedSamples.data(), numSamples);
+
+	for(int i = 0; i < numSources && numSamples > 0; ++i)
+	{
+		const Source& source = pSources[i];
+		if(source.m_numBeatSamples <= 0)
+			continue;
+
+		// sum[n] += sign * beat[n - delay], added in runs that end wherever the source wraps
+		int readIndex = Math::positiveModulo(-source.m_delaySamples, source.m_numBeatSamples);
+		int writeIndex = 0;
+		while(writeIndex < numSamples)
+		{
+			const int runLength = jmin(numSamples - writeIndex, source.m_numBeatSamples - readIndex);
+			FloatVectorOperations::addWithMultiply(summedSamples.data() + writeIndex, source.m_pBeatBuffer + readIndex, source.m_sampleSign, runLength);
+			writeIndex += runLength;
+			readIndex = 0;
+		}
+	}
+
+	// delays and polarity are already applied
+	Source summedSource;
+	summedSource.m_pBeatBuffer = summedSamples.data();
+	summedSource.m_numBeatSamples = numSamples;
+	summedSource.m_delaySamples = 0;
+	summedSource.m_sampleSign = 1.0f;
+	return summedSource;
+}
+
+
+void WaveformBuilder::buildStripVertices(const float* pCurve, int numPoints, float edgeOffset, int layerIndex, StripVertex* pVertices)
+{
+	if(numPoints < 2)
+		return;
+
+	// one triangle strip alternating between the curve and the baseline, the curve is pushed out by the
+	// edge offset so the shader can fade it over the last pixel without thinning it, the layer index
+	// lets strips of several layers share one draw
+	const float vertXScale = 2.0f / (numPoints - 1);
+	const float layer = (float)layerIndex;
+	for(int i = 0; i < numPoints; ++i)
+	{
+		StripVertex& curveVert = pVertices[2 * i];
+		curveVert.m_position[0] = -1.0f + ((i - 1) * vertXScale);
+		curveVert.m_position[1] = pCurve[i] + (pCurve[i] < 0.0f ? -edgeOffset : edgeOffset);
+		curveVert.m_edge = 0.0f;
+		curveVert.m_layer = layer;
+
+		StripVertex& baseVert = pVertices[2 * i + 1];
+		baseVert.m_position[0] = curveVert.m_position[0];
+		baseVert.m_position[1] = 0.0f;
+		baseVert.m_edge = 1.0f;
+		baseVert.m_layer = layer;
+	}
+}
+
+
+void WaveformBuilder::resampleWrapped(const float* pBuffer, int bufferSize, float startPosition, float stride, int numPoints, float gain, bool addToOutput, float* pOutput)
+{
+	if(bufferSize <= 0 || numPoints <= 0)
+		return;
+
+	// wrap the start once, after that positions only move forward so every later wrap is a subtraction
+	const float lastSample = (float)(bufferSize - 1);
+	float runStart = startPosition - bufferSize * floorf(startPosition / bufferSize);
+	int point = 0;
+	while(point < numPoints)
+	{
+		const float position = runStart + point * stride;
+		if(position >= bufferSize)
+		{
+			runStart -= bufferSize;
+			continue;
+		}
+
+		if(position >= lastSample)
+		{
+			// between the last sample and the first
+			const float value = pBuffer[bufferSize - 1] + (pBuffer[0] - pBuffer[bufferSize - 1]) * (position - lastSample);
+			pOutput[point] = addToOutput ? pOutput[point] + gain * value : gain * value;
+			++point;
+			continue;
+		}
+
+		// every point before the last sample reads a contiguous stretch of the buffer
+		int runEnd = numPoints;
+		if(stride > 0.0f)
+			runEnd = jmin(numPoints, point + jmax(1, (int)ceilf((lastSample - position) / stride)));
+
+		point = resampleRun(pBuffer, bufferSize, runStart, stride, point, runEnd, gain, addToOutput, pOutput);
+	}
+}
+
+
+int WaveformBuilder::resampleRun(const float* pBuffer, int bufferSize, float runStart, float stride, int firstPoint, int endPoint, float gain, bool addToOutput, float* pOutput)
+{
+	// rounding can push the last point of a run onto the last sample, clamping keeps the read in bounds
+	const int lastIndex = jmax(0, bufferSize - 2);
+	int point = firstPoint;
+
+#if WAVEFORMBUILDER_USE_SSE2
+	// four points at a time, positions are never negative so truncation is floor
+	const __m128 strideVector = _mm_set1_ps(stride);
+	const __m128 gainVector = _mm_set1_ps(gain);
+	const __m128 runStartVector = _mm_set1_ps(runStart);
+	const __m128i lastIndexVector = _mm_set1_epi32(lastIndex);
+	for(; point + 4 <= endPoint; point += 4)
+	{
+		const __m128 pointVector = _mm_cvtepi32_ps(_mm_setr_epi32(point, point + 1, point + 2, point + 3));
+		const __m128 positions = _mm_add_ps(runStartVector, _mm_mul_ps(pointVector, strideVector));
+		__m128i indices = _mm_cvttps_epi32(positions);
+		const __m128i overflow = _mm_cmpgt_epi32(indices, lastIndexVector);
+		indices = _mm_or_si128(_mm_andnot_si128(overflow, indices), _mm_and_si128(overflow, lastIndexVector));
+
+		alignas(16) int32 index[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(index), indices);
+		const __m128 a = _mm_setr_ps(pBuffer[index[0]], pBuffer[index[1]], pBuffer[index[2]], pBuffer[index[3]]);
+		const __m128 b = _mm_setr_ps(pBuffer[index[0] + 1], pBuffer[index[1] + 1], pBuffer[index[2] + 1], pBuffer[index[3] + 1]);
+		const __m128 ratios = _mm_sub_ps(positions, _mm_cvtepi32_ps(indices));
+		__m128 values = _mm_mul_ps(gainVector, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), ratios)));
+		if(addToOutput)
+			values = _mm_add_ps(values, _mm_loadu_ps(pOutput + point));
+		_mm_storeu_ps(pOutput + point, values);
+	}
+#endif
+
+	for(; point < endPoint; ++point)
+	{
+		const float position = runStart + point * stride;
+		const int index = jmin((int)position, lastIndex);
+		const float value = pBuffer[index] + (pBuffer[index + 1] - pBuffer[index]) * (position - index);
+		pOutput[point] = addToOutput ? pOutput[point] + gain * value : gain * value;
+	}
+
+	return point;
+}
\ No newline at end of file
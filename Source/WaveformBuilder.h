@@ -0,0 +1,40 @@
+#pragma once
+
+
+#include "JuceHeader.h"
+#include <vector>
+
+
+// Builds the display curves from beat buffers. It doesn't touch the processor or any graphics API, so
+// both display backends and the benchmarks share it. Curves hold one value per point, evenly spaced
+// across the view and clamped to the -1 to 1 range of the display. Layers that combine several sources
+// sum them into one buffer first, so they cost the same to resample as a single source.
+class WaveformBuilder
+{
+public:
+	struct Source
+	{
+		const float* m_pBeatBuffer;
+		int m_numBeatSamples;
+		int m_delaySamples;
+		float m_sampleSign;
+	};
+
+	struct StripVertex
+	{
+		float m_position[2];
+		float m_edge;
+		float m_layer;
+	};
+
+	static void buildCurve(const Source& source, float viewStartRatio, float viewEndRatio, float* pCurve, int numPoints);
+	static Source sumSources(const Source* pSources, int numSources, std::vector<float>& summedSamples);
+	static void buildStripVertices(const float* pCurve, int numPoints, float edgeOffset, int layerIndex, StripVertex* pVertices);
+
+	// linearly interpolates numPoints evenly spaced positions from a buffer that wraps at its end and
+	// scales them by gain, either writing or adding them to the output
+	static void resampleWrapped(const float* pBuffer, int bufferSize, float startPosition, float stride, int numPoints, float gain, bool addToOutput, float* pOutput);
+
+private:
+	static int resampleRun(const float* pBuffer, int bufferSize, float runStart, float stride, int firstPoint, int endPoint, float gain, bool addToOutput, float* pOutput);
+};
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include "WaveformProducer.h"
+#include <algorithm>
+
+
+#define WAVEFORMPRODUCER_STOP_TIMEOUT_MS 2000
+
+
+
+WaveformProducer::FrameReader::FrameReader(WaveformProducer& producer)
+	: m_lock(producer.m_frameLock)
+	, m_pFrame(producer.m_hasPublishedFrame ? &producer.m_frames[producer.m_publishedFrameIndex] : nullptr)
+{
+}
+
+
+const WaveformProducer::Frame* WaveformProducer::FrameReader::getFrame() const
+{
+	return m_pFrame;
+}
+
+
+
+
+
+WaveformProducer::WaveformProducer(int numPoints)
+	: Thread("WaveformProducer")
+	, m_numPoints(jmax(numPoints, 2))
+	, m_pListener(nullptr)
+	, m_hasPendingSnapshot(false)
+	, m_publishedFrameIndex(1)
+	, m_hasPublishedFrame(false)
+	, m_numFramesBuilt(0)
+{
+}
+
+
+WaveformProducer::~WaveformProducer()
+{
+	stopProducing();
+}
+
+
+void WaveformProducer::startProducing(Listener* pListener)
+{
+	stopProducing();
+
+	m_pListener = pListener;
+	startThread();
+}
+
+
+void WaveformProducer::stopProducing()
+{
+	// the worker sleeps until it has a snapshot, so wake it to see the exit flag
+	signalThreadShouldExit();
+	notify();
+	stopThread(WAVEFORMPRODUCER_STOP_TIMEOUT_MS);
+	m_pListener = nullptr;
+}
+
+
+void WaveformProducer::submitSnapshot(Snapshot& snapshot)
+{
+	{
+		const ScopedLock lock(m_snapshotLock);
+		std::swap(m_pendingSnapshot, snapshot);
+		m_hasPendingSnapshot = true;
+	}
+
+	notify();
+}
+
+
+void WaveformProducer::run()
+{
+	while(!threadShouldExit())
+	{
+		wait(-1);
+
+		{
+			const ScopedLock lock(m_snapshotLock);
+			if(!m_hasPendingSnapshot)
+				continue;
+
+			std::swap(m_pendingSnapshot, m_buildSnapshot);
+			m_hasPendingSnapshot = false;
+		}
+
+		// only this thread publishes, so the frame that isn't published can be built without the lock
+		const int buildFrameIndex = 1 - m_publishedFrameIndex;
+		const double buildStartTime = Time::getMillisecondCounterHiRes();
+		buildFrame(m_buildSnapshot, m_frames[buildFrameIndex]);
+		const double buildMilliseconds = Time::getMillisecondCounterHiRes() - buildStartTime;
+
+		{
+			const ScopedLock lock(m_frameLock);
+			m_publishedFrameIndex = buildFrameIndex;
+			m_hasPublishedFrame = true;
+		}
+
+		if(m_pListener)
+			m_pListener->waveformFramePublished(buildMilliseconds);
+	}
+}
+
+
+void WaveformProducer::buildFrame(const Snapshot& snapshot, Frame& frame)
+{
+	frame.m_isPhaseView = snapshot.m_isPhaseView;
+	if(snapshot.m_isPhaseView)
+	{
+		frame.m_historyLayers.clear();
+		frame.m_newestHistoryBeatNumber = -1;
+		buildPhaseFrame(snapshot, frame);
+		return;
+	}
+
+	buildHistoryLayers(snapshot, frame);
+
+	frame.m_layers.resize(snapshot.m_layerBeats.size());
+	for(int layerIndex = 0; layerIndex < frame.m_layers.size(); ++layerIndex)
+	{
+		m_sources.clear();
+		const std::vector<int>& layerBeats = snapshot.m_layerBeats[layerIndex];
+		for(int i = 0; i < layerBeats.size(); ++i)
+		{
+			const Beat& beat = snapshot.m_beats[layerBeats[i]];
+			if(beat.m_samples.size() > 0)
+			{
+				WaveformBuilder::Source source;
+				source.m_pBeatBuffer = beat.m_samples.data();
+				source.m_numBeatSamples = (int)beat.m_samples.size();
+				source.m_delaySamples = beat.m_delaySamples;
+				source.m_sampleSign = beat.m_sampleSign;
+				m_sources.push_back(source);
+			}
+		}
+
+		Layer& layer = frame.m_layers[layerIndex];
+		layer.m_isVisible = m_sources.size() > 0;
+		if(!layer.m_isVisible)
+			continue;
+
+		// combined layers are summed once per snapshot and then resampled like any other beat
+		const WaveformBuilder::Source source = (m_sources.size() == 1) ? m_sources[0] : WaveformBuilder::sumSources(m_sources.data(), (int)m_sources.size(), m_summedSamples);
+
+		layer.m_curve.resize(m_numPoints);
+		WaveformBuilder::buildCurve(source, snapshot.m_viewStartRatio, snapshot.m_viewEndRatio, layer.m_curve.data(), m_numPoints);
+
+		layer.m_vertices.resize(2 * m_numPoints);
+		WaveformBuilder::buildStripVertices(layer.m_curve.data(), m_numPoints, snapshot.m_edgeOffset, layerIndex, layer.m_vertices.data());
+	}
+
+	frame.m_viewStartRatio = snapshot.m_viewStartRatio;
+	frame.m_viewEndRatio = snapshot.m_viewEndRatio;
+	frame.m_frameNumber = ++m_numFramesBuilt;
+}
+
+
+void WaveformProducer::buildPhaseFrame(const Snapshot& snapshot, Frame& frame)
+{
+	// only beats captured again since the last frame are transformed, the rest reuse their spectra
+	m_analyser.prepare(snapshot.m_sampleRate);
+	for(int i = 0; i < snapshot.m_beats.size(); ++i)
+	{
+		const Beat& beat = snapshot.m_beats[i];
+		m_analyser.updateBeat(i, beat.m_sourceId, beat.m_beatNumber, beat.m_samples.data(), (int)beat.m_samples.size());
+	}
+
+	const bool hasReference = snapshot.m_beats.size() > 0 && snapshot.m_beats[0].m_samples.size() > 0;
+	frame.m_layers.resize(snapshot.m_layerBeats.size());
+	for(int layerIndex = 0; layerIndex < frame.m_layers.size(); ++layerIndex)
+	{
+		const std::vector<int>& layerBeats = snapshot.m_layerBeats[layerIndex];
+		Layer& layer = frame.m_layers[layerIndex];
+		layer.m_isVisible = false;
+		layer.m_curve.resize(m_numPoints);
+
+		// a lone remote beat draws its phase difference, the reference with others draws the first one's coherence
+		int compareBeatIndex = -1;
+		if(layerBeats.size() == 1 && layerBeats[0] != 0)
+			compareBeatIndex = layerBeats[0];
+		else if(layerBeats.size() > 1 && layerBeats[0] == 0)
+			compareBeatIndex = layerBeats[1];
+
+		if(!hasReference || compareBeatIndex < 0 || snapshot.m_beats[compareBeatIndex].m_samples.empty())
+			continue;
+
+		const Beat& reference = snapshot.m_beats[0];
+		const Beat& compare = snapshot.m_beats[compareBeatIndex];
+		const PhaseSpectrumAnalyser::Placement local = { 0, reference.m_delaySamples, reference.m_sampleSign };
+		const PhaseSpectrumAnalyser::Placement remote = { compareBeatIndex, compare.m_delaySamples, compare.m_sampleSign };
+		const bool isCoherence = layerBeats[0] == 0;
+		layer.m_isVisible = m_analyser.buildCurves(local, remote, isCoherence ? nullptr : layer.m_curve.data(), isCoherence ? layer.m_curve.data() : nullptr, m_numPoints);
+		if(!layer.m_isVisible)
+			continue;
+
+		layer.m_vertices.resize(2 * m_numPoints);
+		WaveformBuilder::buildStripVertices(layer.m_curve.data(), m_numPoints, snapshot.m_edgeOffset, layerIndex, layer.m_vertices.data());
+	}
+
+	frame.m_viewStartRatio = snapshot.m_viewStartRatio;
+	frame.m_viewEndRatio = snapshot.m_viewEndRatio;
+	frame.m_frameNumber = ++m_numFramesBuilt;
+}
+
+
+void WaveformProducer::buildHistoryLayers(const Snapshot& snapshot, Frame& frame)
+{
+	// the beats come in slot order, so sort what's there by beat number to find their ages
+	m_historyOrder.clear();
+	for(int i = 0; i < snapshot.m_historyBeats.size(); ++i)
+		if(snapshot.m_historyBeats[i].m_beatNumber >= 0 && snapshot.m_historyBeats[i].m_samples.size() > 0)
+			m_historyOrder.push_back(i);
+
+	const std::vector<Beat>& beats = snapshot.m_historyBeats;
+	std::sort(m_historyOrder.begin(), m_historyOrder.end(), [&beats](int a, int b) { return beats[a].m_beatNumber < beats[b].m_beatNumber; });
+
+	frame.m_newestHistoryBeatNumber = m_historyOrder.empty() ? -1 : beats[m_historyOrder.back()].m_beatNumber;
+	frame.m_historyDelaySamples = m_historyOrder.empty() ? 0 : beats[m_historyOrder.back()].m_delaySamples;
+	frame.m_historySampleSign = m_historyOrder.empty() ? 1.0f : beats[m_historyOrder.back()].m_sampleSign;
+	frame.m_historyLayers.resize(m_historyOrder.empty() ? 0 : m_historyOrder.size() - 1);
+	for(int i = 0; i < frame.m_historyLayers.size(); ++i)
+	{
+		const Beat& beat = beats[m_historyOrder[i]];
+		HistoryLayer& layer = frame.m_historyLayers[i];
+		layer.m_beatNumber = beat.m_beatNumber;
+		layer.m_age = (int)(frame.m_newestHistoryBeatNumber - beat.m_beatNumber);
+
+		WaveformBuilder::Source source;
+		source.m_pBeatBuffer = beat.m_samples.data();
+		source.m_numBeatSamples = (int)beat.m_samples.size();
+		source.m_delaySamples = beat.m_delaySamples;
+		source.m_sampleSign = beat.m_sampleSign;
+
+		layer.m_curve.resize(m_numPoints);
+		WaveformBuilder::buildCurve(source, snapshot.m_viewStartRatio, snapshot.m_viewEndRatio, layer.m_curve.data(), m_numPoints);
+
+		layer.m_vertices.resize(2 * m_numPoints);
+		WaveformBuilder::buildStripVertices(layer.m_curve.data(), m_numPoints, snapshot.m_edgeOffset, snapshot.m_historyLayerStart + layer.m_age, layer.m_vertices.data());
+	}
+}
\ No newline at end of file
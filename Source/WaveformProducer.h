@@ -0,0 +1,135 @@
+#pragma once
+
+
+#include "JuceHeader.h"
+#include "WaveformBuilder.h"
+#include "PhaseSpectrumAnalyser.h"
+#include <vector>
+
+
+// Builds display frames on a worker thread so rendering only has to upload and draw. The message thread
+// captures a snapshot of every beat buffer and submits it, the worker turns the latest snapshot into curves
+// and strip vertices in whichever of its two staging frames isn't published and then publishes it.
+// Snapshots submitted while the worker is busy replace each other, so it never falls behind. The phase view is
+// built the same way from the analyser's curves, so no FFT work ever happens on a render thread. Earlier beats
+// can come along too and are built oldest first, each tagged with its age so renderers can fade it.
+class WaveformProducer : private Thread
+{
+public:
+	class Listener
+	{
+	public:
+		virtual ~Listener() {}
+
+		// called on the worker thread once a new frame can be read, along with how long it took to build
+		virtual void waveformFramePublished(double buildMilliseconds) = 0;
+	};
+
+	// the source and beat number tell the phase view when a beat has been captured again
+	struct Beat
+	{
+		std::vector<float> m_samples;
+		int m_delaySamples;
+		float m_sampleSign;
+		int m_sourceId;
+		int64 m_beatNumber;
+	};
+
+	// each layer sums the beats it lists, a layer with no beats that have samples isn't visible. In the phase
+	// view beat 0 is the reference, a layer listing one other beat shows that beat's phase difference to it and
+	// a layer listing beat 0 with others shows the coherence of the first of them.
+	struct Snapshot
+	{
+		std::vector<Beat> m_beats;
+		std::vector<std::vector<int>> m_layerBeats;
+		float m_viewStartRatio;
+		float m_viewEndRatio;
+		float m_edgeOffset;
+		bool m_isPhaseView;
+		double m_sampleRate;
+
+		// earlier beats in any order, placed like the latest one. Their vertices use the layer index at the start
+		// plus their age, the latest of them being age 0 and left out as it's what the layers already show.
+		std::vector<Beat> m_historyBeats;
+		int m_historyLayerStart;
+	};
+
+	struct Layer
+	{
+		bool m_isVisible;
+		std::vector<float> m_curve;
+		std::vector<WaveformBuilder::StripVertex> m_vertices;
+	};
+
+	struct HistoryLayer
+	{
+		int64 m_beatNumber;
+		int m_age;
+		std::vector<float> m_curve;
+		std::vector<WaveformBuilder::StripVertex> m_vertices;
+	};
+
+	// history layers are oldest first, the newest beat number is the one of the age 0 beat that was left out
+	struct Frame
+	{
+		std::vector<Layer> m_layers;
+		std::vector<HistoryLayer> m_historyLayers;
+		int64 m_newestHistoryBeatNumber;
+		int m_historyDelaySamples;
+		float m_historySampleSign;
+		float m_viewStartRatio;
+		float m_viewEndRatio;
+		bool m_isPhaseView;
+		int64 m_frameNumber;
+	};
+
+	// holds the published frame, the worker can't publish over it until the reader goes away
+	class FrameReader
+	{
+	public:
+		FrameReader(WaveformProducer& producer);
+
+		const Frame* getFrame() const;
+
+	private:
+		const ScopedLock m_lock;
+		const Frame* m_pFrame;
+
+		JUCE_DECLARE_NON_COPYABLE(FrameReader)
+	};
+
+	WaveformProducer(int numPoints);
+	~WaveformProducer();
+
+	void startProducing(Listener* pListener);
+	void stopProducing();
+
+	// the snapshot is swapped with a spent one so the caller can reuse its storage
+	void submitSnapshot(Snapshot& snapshot);
+
+private:
+	void run() override;
+	void buildFrame(const Snapshot& snapshot, Frame& frame);
+	void buildPhaseFrame(const Snapshot& snapshot, Frame& frame);
+	void buildHistoryLayers(const Snapshot& snapshot, Frame& frame);
+
+	const int m_numPoints;
+	Listener* m_pListener;
+
+	CriticalSection m_snapshotLock;
+	Snapshot m_pendingSnapshot;
+	Snapshot m_buildSnapshot;
+	bool m_hasPendingSnapshot;
+
+	CriticalSection m_frameLock;
+	Frame m_frames[2];
+	int m_publishedFrameIndex;
+	bool m_hasPublishedFrame;
+	int64 m_numFramesBuilt;
+	std::vector<WaveformBuilder::Source> m_sources;
+	std::vector<float> m_summedSamples;
+	std::vector<int> m_historyOrder;
+	PhaseSpectrumAnalyser m_analyser;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformProducer)
+};
\ No newline at end of file